@@ -0,0 +1,95 @@
+#ifndef AUTOTILER_H
+#define AUTOTILER_H
+
+#include "ThreadPool.h"
+#include "TileGrid.h"
+#include "TileSource.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Neighbor bits of an autotile mask, set where the neighbor has the same terrain type
+const int AUTOTILE_NORTH = 1;
+const int AUTOTILE_EAST = 2;
+const int AUTOTILE_SOUTH = 4;
+const int AUTOTILE_WEST = 8;
+const int AUTOTILE_VARIANTS = 16;
+
+// Turns a grid of terrain types into the tile IDs that are drawn. A terrain type with
+// border variants registered is drawn as variant (first + mask), where the 4-neighbor
+// mask says which sides continue the same terrain, so edges get a border and blend
+// into their surroundings. Other types are drawn as themselves. Neighbors beyond the
+// map count as the same terrain.
+//
+// The drawn IDs are computed once for the whole map, a chunk per work item; an edit
+// then only recomputes the 3x3 tiles around it.
+class AutoTiler : public TileSource {
+public:
+    explicit AutoTiler(TileGrid& terrain)
+        : m_terrain(terrain), m_tiles(terrain.getWidth(), terrain.getHeight()), m_firstVariant(256, 0) {}
+
+    // Draws terrain type as variants firstVariant .. firstVariant + AUTOTILE_VARIANTS - 1
+    void setVariants(TileId type, TileId firstVariant) { m_firstVariant[type] = firstVariant; }
+
+    void build(ThreadPool& pool) {
+        int chunksX = getChunksX();
+        pool.parallelFor(static_cast<std::size_t>(chunksX) * getChunksY(), [&](std::size_t chunk) {
+            int cx = static_cast<int>(chunk % chunksX), cy = static_cast<int>(chunk / chunksX);
+            int endX = std::min((cx + 1) * CHUNK_SIZE, getWidth()), endY = std::min((cy + 1) * CHUNK_SIZE, getHeight());
+            for (int y = cy * CHUNK_SIZE; y < endY; ++y)
+                for (int x = cx * CHUNK_SIZE; x < endX; ++x)
+                    m_tiles.set(x, y, resolve(x, y));
+        });
+    }
+
+    int getWidth() const override { return m_terrain.getWidth(); }
+    int getHeight() const override { return m_terrain.getHeight(); }
+
+    const TileId* chunkData(int cx, int cy) const override { return m_tiles.chunkData(cx, cy); }
+
+    TileId getTerrain(int x, int y) const { return m_terrain.get(x, y); }
+
+    // Changes one terrain tile and recomputes its 3x3 neighborhood. The chunks holding
+    // a tile whose drawn ID changed are appended to changedChunks as (cx, cy).
+    void setTerrain(int x, int y, TileId type, std::vector<std::pair<int, int>>& changedChunks) {
+        if (m_terrain.get(x, y) == type)
+            return;
+        m_terrain.set(x, y, type);
+
+        for (int ny = std::max(0, y - 1); ny <= std::min(getHeight() - 1, y + 1); ++ny) {
+            for (int nx = std::max(0, x - 1); nx <= std::min(getWidth() - 1, x + 1); ++nx) {
+                TileId tile = resolve(nx, ny);
+                if (tile == m_tiles.get(nx, ny))
+                    continue;
+                m_tiles.set(nx, ny, tile);
+                std::pair<int, int> chunk(nx / CHUNK_SIZE, ny / CHUNK_SIZE);
+                if (std::find(changedChunks.begin(), changedChunks.end(), chunk) == changedChunks.end())
+                    changedChunks.push_back(chunk);
+            }
+        }
+    }
+
+private:
+    TileId resolve(int x, int y) const {
+        TileId type = m_terrain.get(x, y);
+        if (m_firstVariant[type] == 0)
+            return type;
+        int mask = 0;
+        if (y == 0 || m_terrain.get(x, y - 1) == type)
+            mask |= AUTOTILE_NORTH;
+        if (x == getWidth() - 1 || m_terrain.get(x + 1, y) == type)
+            mask |= AUTOTILE_EAST;
+        if (y == getHeight() - 1 || m_terrain.get(x, y + 1) == type)
+            mask |= AUTOTILE_SOUTH;
+        if (x == 0 || m_terrain.get(x - 1, y) == type)
+            mask |= AUTOTILE_WEST;
+        return static_cast<TileId>(m_firstVariant[type] + mask);
+    }
+
+    TileGrid& m_terrain;
+    TileGrid m_tiles;                   // Drawn tile IDs
+    std::vector<TileId> m_firstVariant; // Per terrain type, 0 for none
+};
+
+#endif
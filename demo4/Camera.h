@@ -0,0 +1,80 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+
+// Scrolling and zooming view over the map. WASD/arrow keys scroll, the mouse wheel
+// zooms around the cursor. Scroll speed follows the zoom so it feels the same at any scale.
+class Camera {
+public:
+    Camera(sf::Vector2f viewSize, sf::FloatRect worldBounds)
+        : m_view(sf::FloatRect(0, 0, viewSize.x, viewSize.y)), m_baseSize(viewSize), m_world(worldBounds),
+          m_zoom(1.0f) {
+        // Zoomed out far enough, the whole map fits on screen
+        m_maxZoom = std::max(1.0f, std::max(worldBounds.width / viewSize.x, worldBounds.height / viewSize.y));
+        clampToWorld();
+    }
+
+    void handleEvent(const sf::Event& event, const sf::RenderWindow& window) {
+        if (event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+            sf::Vector2i pixel(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+            sf::Vector2f before = window.mapPixelToCoords(pixel, m_view);
+            setZoom(m_zoom * (event.mouseWheelScroll.delta > 0 ? 0.8f : 1.25f));
+            // Keep the point under the cursor fixed while zooming
+            sf::Vector2f after = window.mapPixelToCoords(pixel, m_view);
+            m_view.move(before - after);
+            clampToWorld();
+        }
+        if (event.type == sf::Event::Resized) {
+            m_baseSize = sf::Vector2f(static_cast<float>(event.size.width), static_cast<float>(event.size.height));
+            setZoom(m_zoom);
+        }
+    }
+
+    void update(float seconds) {
+        const float speed = 1000.0f * m_zoom * seconds;
+        sf::Vector2f move(0.0f, 0.0f);
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::A) || sf::Keyboard::isKeyPressed(sf::Keyboard::Left))
+            move.x -= speed;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::D) || sf::Keyboard::isKeyPressed(sf::Keyboard::Right))
+            move.x += speed;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::W) || sf::Keyboard::isKeyPressed(sf::Keyboard::Up))
+            move.y -= speed;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::S) || sf::Keyboard::isKeyPressed(sf::Keyboard::Down))
+            move.y += speed;
+        m_view.move(move);
+        clampToWorld();
+    }
+
+    const sf::View& getView() const { return m_view; }
+    float getZoom() const { return m_zoom; }
+
+private:
+    void setZoom(float zoom) {
+        m_zoom = std::clamp(zoom, 0.25f, m_maxZoom);
+        m_view.setSize(m_baseSize * m_zoom);
+        clampToWorld();
+    }
+
+    void clampToWorld() {
+        sf::Vector2f half = m_view.getSize() / 2.0f;
+        sf::Vector2f center = m_view.getCenter();
+        // When the view is larger than the world along an axis, center the world instead
+        center.x = half.x * 2 >= m_world.width ? m_world.left + m_world.width / 2
+                                               : std::clamp(center.x, m_world.left + half.x,
+                                                            m_world.left + m_world.width - half.x);
+        center.y = half.y * 2 >= m_world.height ? m_world.top + m_world.height / 2
+                                                : std::clamp(center.y, m_world.top + half.y,
+                                                             m_world.top + m_world.height - half.y);
+        m_view.setCenter(center);
+    }
+
+    sf::View m_view;
+    sf::Vector2f m_baseSize;
+    sf::FloatRect m_world;
+    float m_zoom;
+    float m_maxZoom;
+};
+
+#endif
@@ -0,0 +1,850 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "ThreadPool.h"
+#include "WalkabilityGrid.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Tiles per side of a pathfinding cluster
+const int CLUSTER_SIZE = 32;
+// Clusters per side of a region, the second level of the hierarchy
+const int REGION_CLUSTERS = 8;
+// Portals whose distances to every other portal give A* its lower bounds
+const int PATH_LANDMARKS = 16;
+
+struct TilePoint {
+    int x;
+    int y;
+
+    bool operator==(const TilePoint& other) const { return x == other.x && y == other.y; }
+};
+
+// Hierarchical path-finding (HPA*) over a WalkabilityGrid with 4-connected moves of
+// cost 1, in two levels.
+//
+// The map is cut into CLUSTER_SIZE x CLUSTER_SIZE clusters. Wherever two neighboring
+// clusters share a run of walkable border tiles there is an entrance: one pair of
+// transition tiles for a short run, one at each end of a long one. Transition tiles are
+// the nodes of an abstract graph, linked across borders with cost 1 and, inside a
+// cluster, with the length of the shortest path between them.
+//
+// Clusters are grouped into regions of REGION_CLUSTERS x REGION_CLUSTERS, and the nodes
+// on a region's border are its portals. Each region keeps a table of the distance from
+// every one of its nodes to every one of its portals, and edges between its portals
+// with the distance inside the region, so a query links start and goal to the portals
+// of their regions with a few table lookups and runs A* over portals alone: a path
+// across the map passes a few dozen regions instead of thousands of nodes. A* is guided by landmarks, portals whose distance to every other portal is
+// precomputed: by the triangle inequality they bound what is left of a path from below
+// far more tightly than the Manhattan distance when water is in the way. Paths are
+// near-optimal: the detour through transition tiles is usually a few percent.
+//
+// After tiles change walkability, update() rebuilds only the regions around them.
+// Landmark distances are then kept where their portals still exist; walls only make
+// them more cautious, but ground opened since the last build() can make the paths
+// through it come out longer than the shortest.
+//
+// Queries reuse internal buffers, so one PathFinder serves one thread at a time.
+class PathFinder {
+public:
+    explicit PathFinder(const WalkabilityGrid& grid)
+        : m_grid(grid), m_clustersX((grid.getWidth() + CLUSTER_SIZE - 1) / CLUSTER_SIZE),
+          m_clustersY((grid.getHeight() + CLUSTER_SIZE - 1) / CLUSTER_SIZE),
+          m_regionsX((m_clustersX + REGION_CLUSTERS - 1) / REGION_CLUSTERS),
+          m_regionsY((m_clustersY + REGION_CLUSTERS - 1) / REGION_CLUSTERS) {}
+
+    // Builds both levels and the landmarks. Intra-cluster distances, the bulk of the
+    // work, are computed one region per work item.
+    void build(ThreadPool& pool) {
+        m_regions.assign(static_cast<std::size_t>(m_regionsX) * m_regionsY, Region());
+        pool.parallelFor(m_regions.size(), [&](std::size_t region) { buildRegion(static_cast<std::uint32_t>(region)); });
+        pool.parallelFor(m_regions.size(), [&](std::size_t region) { linkRegion(static_cast<std::uint32_t>(region)); });
+        indexPortals();
+        buildLandmarks(pool);
+    }
+
+    // Rebuilds the regions whose graph depends on the given tiles, after their
+    // walkability changed in the grid. Costs a few milliseconds per region.
+    void update(const std::vector<TilePoint>& tiles, ThreadPool& pool) {
+        // A tile on a cluster edge also decides the entrances of the cluster across
+        std::vector<std::uint32_t> rebuilt, relinked;
+        for (const TilePoint& tile : tiles) {
+            const TilePoint around[5] = {tile, {tile.x, tile.y - 1}, {tile.x + 1, tile.y}, {tile.x, tile.y + 1},
+                                         {tile.x - 1, tile.y}};
+            for (const TilePoint& p : around)
+                if (p.x >= 0 && p.y >= 0 && p.x < m_grid.getWidth() && p.y < m_grid.getHeight())
+                    addUnique(rebuilt, regionOf(p));
+        }
+        // Links into a rebuilt region name its portals by index, so its neighbors relink
+        for (std::uint32_t region : rebuilt) {
+            int rx = static_cast<int>(region) % m_regionsX, ry = static_cast<int>(region) / m_regionsX;
+            addUnique(relinked, region);
+            if (rx > 0)
+                addUnique(relinked, region - 1);
+            if (rx + 1 < m_regionsX)
+                addUnique(relinked, region + 1);
+            if (ry > 0)
+                addUnique(relinked, region - m_regionsX);
+            if (ry + 1 < m_regionsY)
+                addUnique(relinked, region + m_regionsX);
+        }
+        pool.parallelFor(rebuilt.size(), [&](std::size_t i) { buildRegion(rebuilt[i]); });
+        pool.parallelFor(relinked.size(), [&](std::size_t i) { linkRegion(relinked[i]); });
+        indexPortals();
+    }
+
+    std::size_t getNodeCount() const {
+        std::size_t count = 0;
+        for (const Region& region : m_regions)
+            count += region.nodes.size();
+        return count;
+    }
+
+    std::size_t getEdgeCount() const {
+        std::size_t count = 0;
+        for (const Region& region : m_regions)
+            count += region.edges.size();
+        return count;
+    }
+
+    std::size_t getPortalCount() const { return m_portalRegion.size(); }
+    std::size_t getRegionCount() const { return m_regions.size(); }
+
+    // Finds a path and returns its length in moves, or -1 if the goal cannot be reached.
+    // If waypoints is given it receives start, the transition tiles passed and goal;
+    // consecutive waypoints lie in one cluster or are adjacent, see refine().
+    int findPath(TilePoint start, TilePoint goal, std::vector<TilePoint>* waypoints = nullptr) {
+        if (waypoints)
+            waypoints->clear();
+        if (!m_grid.isWalkable(start.x, start.y) || !m_grid.isWalkable(goal.x, goal.y))
+            return -1;
+
+        int startCluster = clusterOf(start), goalCluster = clusterOf(goal);
+        if (startCluster == goalCluster) {
+            // Usually connected inside the cluster; otherwise fall through to the graph
+            searchCluster(startCluster, start, m_distance, nullptr);
+            std::uint16_t d = m_distance[localIndex(startCluster, goal)];
+            if (d != UNREACHED) {
+                if (waypoints)
+                    *waypoints = {start, goal};
+                return d;
+            }
+        }
+
+        // Nodes of the start and goal clusters with their distance to start and goal
+        std::uint32_t startRegion = regionOf(start), goalRegion = regionOf(goal);
+        const Region& from = m_regions[startRegion];
+        const Region& to = m_regions[goalRegion];
+        clusterSeeds(start, m_startSeeds);
+        clusterSeeds(goal, m_goalSeeds);
+
+        // A path inside one region is found there directly, and bounds the search below
+        std::uint32_t best = NO_PATH, bestNode = NO_NODE;
+        if (startRegion == goalRegion) {
+            searchRegion(from, m_startSeeds, NO_NODE, m_search);
+            for (const auto& [node, d] : m_goalSeeds) {
+                if (m_search.stamp[node] == m_search.query && m_search.cost[node] + d < best) {
+                    best = m_search.cost[node] + d;
+                    bestNode = node;
+                }
+            }
+        }
+
+        // Distances from start to the portals of its region and from those of goal's
+        // region to goal. If none of the first shares a component with one of the
+        // second, the search would only exhaust the graph, so it is skipped.
+        portalCosts(from, m_startSeeds, m_startCost, m_startVia);
+        portalCosts(to, m_goalSeeds, m_goalCost, m_goalVia);
+        bool connected = false;
+        for (std::size_t i = 0; i < m_startCost.size() && !connected; ++i) {
+            if (m_startCost[i] == NO_PATH)
+                continue;
+            for (std::size_t j = 0; j < m_goalCost.size(); ++j)
+                connected |= m_goalCost[j] != NO_PATH &&
+                             m_component[m_portalBase[startRegion] + i] == m_component[m_portalBase[goalRegion] + j];
+        }
+
+        // Each landmark's distance to goal, through the portals of goal's region
+        for (int l = 0; l < PATH_LANDMARKS; ++l) {
+            m_goalLandmarks[l] = NO_PATH;
+            for (std::size_t j = 0; j < m_goalCost.size(); ++j) {
+                std::uint32_t d = to.landmarks[j * PATH_LANDMARKS + l];
+                if (m_goalCost[j] != NO_PATH && d != NO_PATH)
+                    m_goalLandmarks[l] = std::min(m_goalLandmarks[l], d + m_goalCost[j]);
+            }
+        }
+
+        // A* over portals. The goal is an extra node, reached from the portals of its
+        // region; those of start's region are seeded with their distance to start.
+        const std::uint32_t goalNode = static_cast<std::uint32_t>(m_portalRegion.size());
+        ++m_query;
+        m_open.clear();
+        for (std::size_t i = 0; connected && i < m_startCost.size(); ++i)
+            if (m_startCost[i] != NO_PATH)
+                push(m_portalBase[startRegion] + static_cast<std::uint32_t>(i), m_startCost[i], NO_NODE, goal, best);
+
+        bool throughPortals = false;
+        while (!m_open.empty()) {
+            std::pop_heap(m_open.begin(), m_open.end(), std::greater<OpenEntry>());
+            OpenEntry entry = m_open.back();
+            m_open.pop_back();
+            if (entry.cost != m_cost[entry.node])
+                continue; // Superseded by a cheaper entry
+            if (entry.priority >= best)
+                break; // Nothing left can beat the path inside the region
+            if (entry.node == goalNode) {
+                best = entry.cost;
+                throughPortals = true;
+                break;
+            }
+            std::uint32_t region = m_portalRegion[entry.node];
+            std::uint32_t portal = entry.node - m_portalBase[region];
+            if (region == goalRegion && m_goalCost[portal] != NO_PATH)
+                push(goalNode, entry.cost + m_goalCost[portal], entry.node, goal, best);
+            forEachNeighbor(entry.node, [&](std::uint32_t next, std::uint32_t cost) {
+                push(next, entry.cost + cost, entry.node, goal, best);
+            });
+        }
+
+        if (best == NO_PATH)
+            return -1;
+        if (waypoints) {
+            waypoints->push_back(start);
+            if (throughPortals) {
+                std::vector<std::uint32_t> portals;
+                for (std::uint32_t node = m_parent[goalNode]; node != NO_NODE; node = m_parent[node])
+                    portals.push_back(node);
+                std::reverse(portals.begin(), portals.end());
+                std::uint32_t first = portals.front() - m_portalBase[startRegion];
+                appendRegionPath(from, m_startVia[first], from.portals[first], *waypoints);
+                for (std::size_t i = 1; i < portals.size(); ++i) {
+                    std::uint32_t region = m_portalRegion[portals[i]];
+                    const Region& next = m_regions[region];
+                    std::uint32_t node = next.portals[portals[i] - m_portalBase[region]];
+                    if (m_portalRegion[portals[i - 1]] == region) {
+                        std::uint32_t previous = next.portals[portals[i - 1] - m_portalBase[region]];
+                        appendRegionPath(next, previous, node, *waypoints);
+                    } else {
+                        appendWaypoint(next.nodes[node].position, *waypoints); // Across a region border
+                    }
+                }
+                std::uint32_t last = portals.back() - m_portalBase[goalRegion];
+                appendRegionPath(to, to.portals[last], m_goalVia[last], *waypoints);
+            } else {
+                // The path inside the region, still in the search from start's cluster
+                std::vector<TilePoint> reversed;
+                for (std::uint32_t node = bestNode; node != NO_NODE; node = m_search.parent[node])
+                    reversed.push_back(from.nodes[node].position);
+                for (auto it = reversed.rbegin(); it != reversed.rend(); ++it)
+                    appendWaypoint(*it, *waypoints);
+            }
+            appendWaypoint(goal, *waypoints);
+        }
+        return static_cast<int>(best);
+    }
+
+    // Expands waypoints from findPath into every tile along the path
+    std::vector<TilePoint> refine(const std::vector<TilePoint>& waypoints) {
+        std::vector<TilePoint> path;
+        if (waypoints.empty())
+            return path;
+        path.push_back(waypoints.front());
+        for (std::size_t i = 1; i < waypoints.size(); ++i) {
+            TilePoint from = waypoints[i - 1], to = waypoints[i];
+            if (from == to)
+                continue;
+            if (std::abs(from.x - to.x) + std::abs(from.y - to.y) == 1) {
+                path.push_back(to); // Across a cluster border
+                continue;
+            }
+            int cluster = clusterOf(from);
+            searchCluster(cluster, to, m_distance, &m_cellParent);
+            // Walk back from `from` along the search tree rooted at `to`
+            int local = localIndex(cluster, from);
+            int left = (cluster % m_clustersX) * CLUSTER_SIZE, top = (cluster / m_clustersX) * CLUSTER_SIZE;
+            int width = clusterWidth(cluster);
+            while (m_distance[local] != 0) {
+                local = m_cellParent[local];
+                path.push_back(TilePoint{left + local % width, top + local / width});
+            }
+        }
+        return path;
+    }
+
+private:
+    static constexpr std::uint16_t UNREACHED = std::numeric_limits<std::uint16_t>::max();
+    static constexpr std::uint32_t NO_PATH = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t NO_NODE = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node {
+        TilePoint position;
+        std::uint32_t firstEdge;
+    };
+
+    struct Edge {
+        std::uint32_t to;
+        std::uint32_t cost;
+    };
+
+    // From a portal to the portal across a region border
+    struct Link {
+        std::uint32_t region;
+        std::uint32_t portal;
+    };
+
+    // The transition tiles of a region's clusters, by index within the region, with
+    // the edges between them and the tables that stand in for them between regions
+    struct Region {
+        std::vector<Node> nodes;
+        std::vector<Edge> edges;
+        std::vector<std::vector<std::uint32_t>> clusterNodes; // By cluster within the region, row by row
+        std::vector<std::uint32_t> portals;                   // Nodes with a link to another region
+        std::vector<Edge> portalEdges;                        // Between portals, inside the region
+        std::vector<std::uint32_t> firstPortalEdge;           // By portal, with one past the last
+        std::vector<std::uint16_t> toPortal;                  // Node to portal, nodes x portals
+        std::vector<Link> links;
+        std::vector<std::uint32_t> firstLink;                 // By portal, with one past the last
+        std::vector<std::uint32_t> landmarks;                 // Portal to landmark, portals x PATH_LANDMARKS
+    };
+
+    // Dijkstra state over the nodes of one region. A node's cost and parent are only
+    // valid when its stamp matches the current query.
+    struct RegionSearch {
+        std::uint32_t query = 0;
+        std::vector<std::uint32_t> stamp;
+        std::vector<std::uint32_t> cost;
+        std::vector<std::uint32_t> parent;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> open; // (cost, node)
+    };
+
+    struct OpenEntry {
+        std::uint32_t priority;
+        std::uint32_t cost;
+        std::uint32_t node;
+
+        // Among equal priorities the entry furthest along comes first, which cuts the
+        // many ties of a Manhattan heuristic short
+        bool operator>(const OpenEntry& other) const {
+            return priority != other.priority ? priority > other.priority : cost < other.cost;
+        }
+    };
+
+    int clusterOf(TilePoint p) const { return (p.y / CLUSTER_SIZE) * m_clustersX + p.x / CLUSTER_SIZE; }
+
+    std::uint32_t regionOf(TilePoint p) const {
+        const int regionTiles = CLUSTER_SIZE * REGION_CLUSTERS;
+        return static_cast<std::uint32_t>((p.y / regionTiles) * m_regionsX + p.x / regionTiles);
+    }
+
+    // Index of p's cluster within its region
+    static int regionCluster(TilePoint p) {
+        return (p.y / CLUSTER_SIZE) % REGION_CLUSTERS * REGION_CLUSTERS + (p.x / CLUSTER_SIZE) % REGION_CLUSTERS;
+    }
+
+    int clusterWidth(int cluster) const {
+        return std::min(CLUSTER_SIZE, m_grid.getWidth() - (cluster % m_clustersX) * CLUSTER_SIZE);
+    }
+
+    int clusterHeight(int cluster) const {
+        return std::min(CLUSTER_SIZE, m_grid.getHeight() - (cluster / m_clustersX) * CLUSTER_SIZE);
+    }
+
+    int localIndex(int cluster, TilePoint p) const {
+        return (p.y % CLUSTER_SIZE) * clusterWidth(cluster) + p.x % CLUSTER_SIZE;
+    }
+
+    static std::size_t edgeEnd(const Region& region, std::uint32_t node) {
+        return node + 1 < region.nodes.size() ? region.nodes[node + 1].firstEdge : region.edges.size();
+    }
+
+    static void addUnique(std::vector<std::uint32_t>& list, std::uint32_t value) {
+        if (std::find(list.begin(), list.end(), value) == list.end())
+            list.push_back(value);
+    }
+
+    static void appendWaypoint(TilePoint p, std::vector<TilePoint>& waypoints) {
+        if (waypoints.empty() || !(waypoints.back() == p))
+            waypoints.push_back(p);
+    }
+
+    // Node for a transition tile, shared by every entrance that uses the tile
+    static std::uint32_t nodeAt(Region& region, TilePoint p, std::vector<std::vector<Edge>>& edges) {
+        std::vector<std::uint32_t>& nodes = region.clusterNodes[regionCluster(p)];
+        for (std::uint32_t node : nodes)
+            if (region.nodes[node].position == p)
+                return node;
+        region.nodes.push_back(Node{p, 0});
+        edges.emplace_back();
+        nodes.push_back(static_cast<std::uint32_t>(region.nodes.size() - 1));
+        return nodes.back();
+    }
+
+    // Calls link(a, b) for every pair of transition tiles on the east border of
+    // cluster (cx, cy), or its south border, with a inside the cluster
+    template <typename OnEntrance>
+    void scanBorder(int cx, int cy, bool east, OnEntrance link) const {
+        int left = cx * CLUSTER_SIZE, top = cy * CLUSTER_SIZE;
+        int right = std::min(left + CLUSTER_SIZE, m_grid.getWidth());
+        int bottom = std::min(top + CLUSTER_SIZE, m_grid.getHeight());
+        TilePoint first = east ? TilePoint{right - 1, top} : TilePoint{left, bottom - 1};
+        TilePoint step = east ? TilePoint{0, 1} : TilePoint{1, 0};
+        TilePoint across = east ? TilePoint{1, 0} : TilePoint{0, 1};
+        int length = east ? bottom - top : right - left;
+
+        auto open = [&](int i) {
+            int x = first.x + step.x * i, y = first.y + step.y * i;
+            return m_grid.isWalkable(x, y) && m_grid.isWalkable(x + across.x, y + across.y);
+        };
+        auto linkAt = [&](int i) {
+            TilePoint a{first.x + step.x * i, first.y + step.y * i};
+            link(a, TilePoint{a.x + across.x, a.y + across.y});
+        };
+
+        for (int i = 0; i < length;) {
+            if (!open(i)) {
+                ++i;
+                continue;
+            }
+            int runStart = i;
+            while (i < length && open(i))
+                ++i;
+            int runEnd = i - 1;
+            if (runEnd - runStart < 5) {
+                linkAt((runStart + runEnd) / 2);
+            } else {
+                linkAt(runStart);
+                linkAt(runEnd);
+            }
+        }
+    }
+
+    // Finds the transition tiles of a region's clusters and the paths between them,
+    // then its tables. Landmark distances are kept for portals that are still there.
+    // Only writes the region itself, so regions can be built in parallel.
+    void buildRegion(std::uint32_t index) {
+        Region& region = m_regions[index];
+        std::vector<TilePoint> oldPortals;
+        for (std::uint32_t node : region.portals)
+            oldPortals.push_back(region.nodes[node].position);
+        std::vector<std::uint32_t> oldLandmarks = std::move(region.landmarks);
+        region = Region();
+        region.clusterNodes.resize(REGION_CLUSTERS * REGION_CLUSTERS);
+
+        // Entrances on the east and south border of every cluster of the region, and on
+        // the borders with the regions to the west and north. Tiles across a region
+        // border belong to the region there, which finds the same entrances.
+        std::vector<std::vector<Edge>> edges;
+        std::vector<std::uint8_t> isPortal;
+        auto link = [&](TilePoint a, TilePoint b) {
+            bool hasA = regionOf(a) == index, hasB = regionOf(b) == index;
+            std::uint32_t nodeA = hasA ? nodeAt(region, a, edges) : NO_NODE;
+            std::uint32_t nodeB = hasB ? nodeAt(region, b, edges) : NO_NODE;
+            isPortal.resize(region.nodes.size(), 0);
+            if (hasA && hasB) {
+                edges[nodeA].push_back(Edge{nodeB, 1});
+                edges[nodeB].push_back(Edge{nodeA, 1});
+            } else {
+                isPortal[hasA ? nodeA : nodeB] = 1;
+            }
+        };
+        int firstX = static_cast<int>(index) % m_regionsX * REGION_CLUSTERS;
+        int firstY = static_cast<int>(index) / m_regionsX * REGION_CLUSTERS;
+        int endX = std::min(firstX + REGION_CLUSTERS, m_clustersX), endY = std::min(firstY + REGION_CLUSTERS, m_clustersY);
+        for (int cy = firstY; cy < endY; ++cy) {
+            for (int cx = firstX; cx < endX; ++cx) {
+                if (cx + 1 < m_clustersX)
+                    scanBorder(cx, cy, true, link);
+                if (cy + 1 < m_clustersY)
+                    scanBorder(cx, cy, false, link);
+            }
+            if (firstX > 0)
+                scanBorder(firstX - 1, cy, true, link);
+        }
+        for (int cx = firstX; firstY > 0 && cx < endX; ++cx)
+            scanBorder(cx, firstY - 1, false, link);
+
+        // Paths between the transition tiles of each cluster
+        std::vector<std::uint16_t> distance;
+        for (const std::vector<std::uint32_t>& nodes : region.clusterNodes) {
+            for (std::size_t i = 0; i < nodes.size(); ++i) {
+                TilePoint p = region.nodes[nodes[i]].position;
+                int cluster = clusterOf(p);
+                searchCluster(cluster, p, distance, nullptr);
+                for (std::size_t j = 0; j < nodes.size(); ++j) {
+                    std::uint16_t d = distance[localIndex(cluster, region.nodes[nodes[j]].position)];
+                    if (j != i && d != UNREACHED)
+                        edges[nodes[i]].push_back(Edge{nodes[j], d});
+                }
+            }
+        }
+
+        // Flatten into one edge array
+        for (std::size_t node = 0; node < region.nodes.size(); ++node) {
+            region.nodes[node].firstEdge = static_cast<std::uint32_t>(region.edges.size());
+            region.edges.insert(region.edges.end(), edges[node].begin(), edges[node].end());
+            if (isPortal[node])
+                region.portals.push_back(static_cast<std::uint32_t>(node));
+        }
+
+        // Distances inside the region from each portal to every node
+        std::size_t portalCount = region.portals.size();
+        region.toPortal.assign(region.nodes.size() * portalCount, UNREACHED);
+        std::vector<std::uint16_t> portalDistance(portalCount * portalCount, UNREACHED);
+        RegionSearch search;
+        for (std::size_t i = 0; i < portalCount; ++i) {
+            searchRegion(region, {{region.portals[i], 0}}, NO_NODE, search);
+            for (std::size_t node = 0; node < region.nodes.size(); ++node) {
+                if (search.stamp[node] == search.query)
+                    region.toPortal[node * portalCount + i] = static_cast<std::uint16_t>(search.cost[node]);
+            }
+            for (std::size_t j = 0; j < portalCount; ++j)
+                portalDistance[i * portalCount + j] = region.toPortal[region.portals[j] * portalCount + i];
+        }
+
+        // Edges between portals, leaving out those no shorter than going through a third
+        // portal: they add nothing but work for A*
+        for (std::size_t i = 0; i < portalCount; ++i) {
+            region.firstPortalEdge.push_back(static_cast<std::uint32_t>(region.portalEdges.size()));
+            const std::uint16_t* row = &portalDistance[i * portalCount];
+            for (std::size_t j = 0; j < portalCount; ++j) {
+                if (j == i || row[j] == UNREACHED)
+                    continue;
+                bool redundant = false;
+                for (std::size_t k = 0; k < portalCount && !redundant; ++k) {
+                    std::uint16_t via = portalDistance[k * portalCount + j];
+                    redundant = k != i && k != j && row[k] != UNREACHED && via != UNREACHED && row[k] + via == row[j];
+                }
+                if (!redundant)
+                    region.portalEdges.push_back(Edge{static_cast<std::uint32_t>(j), row[j]});
+            }
+        }
+        region.firstPortalEdge.push_back(static_cast<std::uint32_t>(region.portalEdges.size()));
+
+        region.landmarks.assign(portalCount * PATH_LANDMARKS, NO_PATH);
+        for (std::size_t i = 0; i < portalCount; ++i) {
+            auto old = std::find(oldPortals.begin(), oldPortals.end(), region.nodes[region.portals[i]].position);
+            if (old != oldPortals.end())
+                std::copy_n(&oldLandmarks[(old - oldPortals.begin()) * PATH_LANDMARKS], PATH_LANDMARKS,
+                            &region.landmarks[i * PATH_LANDMARKS]);
+        }
+    }
+
+    // Links each portal of a region to the portals next to it in other regions. Needs
+    // those regions built; only writes this one.
+    void linkRegion(std::uint32_t index) {
+        Region& region = m_regions[index];
+        region.links.clear();
+        region.firstLink.clear();
+        for (std::uint32_t node : region.portals) {
+            region.firstLink.push_back(static_cast<std::uint32_t>(region.links.size()));
+            TilePoint p = region.nodes[node].position;
+            const TilePoint around[4] = {{p.x, p.y - 1}, {p.x + 1, p.y}, {p.x, p.y + 1}, {p.x - 1, p.y}};
+            for (const TilePoint& q : around) {
+                if (q.x < 0 || q.y < 0 || q.x >= m_grid.getWidth() || q.y >= m_grid.getHeight() || regionOf(q) == index)
+                    continue;
+                const Region& other = m_regions[regionOf(q)];
+                for (std::size_t j = 0; j < other.portals.size(); ++j)
+                    if (other.nodes[other.portals[j]].position == q)
+                        region.links.push_back(Link{regionOf(q), static_cast<std::uint32_t>(j)});
+            }
+        }
+        region.firstLink.push_back(static_cast<std::uint32_t>(region.links.size()));
+    }
+
+    // Numbers the portals of all regions one after another, and sizes the query state
+    void indexPortals() {
+        m_portalBase.assign(m_regions.size(), 0);
+        m_portalRegion.clear();
+        for (std::size_t region = 0; region < m_regions.size(); ++region) {
+            m_portalBase[region] = static_cast<std::uint32_t>(m_portalRegion.size());
+            m_portalRegion.insert(m_portalRegion.end(), m_regions[region].portals.size(),
+                                  static_cast<std::uint32_t>(region));
+        }
+        m_stamp.assign(m_portalRegion.size() + 1, 0);
+        m_cost.assign(m_portalRegion.size() + 1, 0);
+        m_parent.assign(m_portalRegion.size() + 1, 0);
+        labelComponents();
+    }
+
+    // Calls visit(next, cost) for each portal one step from the given one
+    template <typename Visit>
+    void forEachNeighbor(std::uint32_t portal, Visit visit) const {
+        std::uint32_t index = m_portalRegion[portal];
+        const Region& region = m_regions[index];
+        std::uint32_t i = portal - m_portalBase[index];
+        for (std::uint32_t e = region.firstPortalEdge[i]; e < region.firstPortalEdge[i + 1]; ++e)
+            visit(m_portalBase[index] + region.portalEdges[e].to, region.portalEdges[e].cost);
+        for (std::uint32_t k = region.firstLink[i]; k < region.firstLink[i + 1]; ++k)
+            visit(m_portalBase[region.links[k].region] + region.links[k].portal, 1u);
+    }
+
+    // Labels the connected components of the portal graph, whose edges all go both ways
+    void labelComponents() {
+        const std::uint32_t unlabeled = std::numeric_limits<std::uint32_t>::max();
+        m_component.assign(m_portalRegion.size(), unlabeled);
+        std::vector<std::uint32_t> stack;
+        std::uint32_t component = 0;
+        for (std::uint32_t root = 0; root < m_portalRegion.size(); ++root) {
+            if (m_component[root] != unlabeled)
+                continue;
+            m_component[root] = component;
+            stack.push_back(root);
+            while (!stack.empty()) {
+                std::uint32_t portal = stack.back();
+                stack.pop_back();
+                forEachNeighbor(portal, [&](std::uint32_t next, std::uint32_t) {
+                    if (m_component[next] == unlabeled) {
+                        m_component[next] = component;
+                        stack.push_back(next);
+                    }
+                });
+            }
+            ++component;
+        }
+    }
+
+    // Picks landmarks around the edge of the map, where they bound the most paths, in
+    // the component with the most portals, then finds the distance from each to every
+    // portal, one landmark per work item
+    void buildLandmarks(ThreadPool& pool) {
+        std::vector<std::uint32_t> sizes;
+        for (std::uint32_t component : m_component) {
+            if (component >= sizes.size())
+                sizes.resize(component + 1, 0);
+            ++sizes[component];
+        }
+        if (sizes.empty())
+            return;
+        std::uint32_t largest = static_cast<std::uint32_t>(std::max_element(sizes.begin(), sizes.end()) - sizes.begin());
+
+        int width = m_grid.getWidth(), height = m_grid.getHeight();
+        std::vector<std::uint32_t> landmarks;
+        for (int l = 0; l < PATH_LANDMARKS; ++l) {
+            // Evenly spaced along the edge, clockwise from the top left corner
+            long long along = static_cast<long long>(l) * 2 * (width + height) / PATH_LANDMARKS;
+            TilePoint target = along < width                ? TilePoint{static_cast<int>(along), 0}
+                               : along < width + height     ? TilePoint{width - 1, static_cast<int>(along - width)}
+                               : along < 2 * width + height ? TilePoint{static_cast<int>(2 * width + height - along), height - 1}
+                                                            : TilePoint{0, static_cast<int>(2 * (width + height) - along)};
+            std::uint32_t nearest = NO_NODE;
+            int nearestDistance = std::numeric_limits<int>::max();
+            for (std::uint32_t portal = 0; portal < m_portalRegion.size(); ++portal) {
+                if (m_component[portal] != largest)
+                    continue;
+                TilePoint p = portalPosition(portal);
+                int d = std::abs(p.x - target.x) + std::abs(p.y - target.y);
+                if (d < nearestDistance) {
+                    nearestDistance = d;
+                    nearest = portal;
+                }
+            }
+            landmarks.push_back(nearest);
+        }
+
+        pool.parallelFor(landmarks.size(), [&](std::size_t l) {
+            std::vector<std::uint32_t> distance(m_portalRegion.size(), NO_PATH);
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> open;
+            distance[landmarks[l]] = 0;
+            open.emplace_back(0, landmarks[l]);
+            while (!open.empty()) {
+                std::pop_heap(open.begin(), open.end(), std::greater<std::pair<std::uint32_t, std::uint32_t>>());
+                auto [cost, portal] = open.back();
+                open.pop_back();
+                if (cost != distance[portal])
+                    continue;
+                forEachNeighbor(portal, [&](std::uint32_t next, std::uint32_t step) {
+                    if (cost + step < distance[next]) {
+                        distance[next] = cost + step;
+                        open.emplace_back(cost + step, next);
+                        std::push_heap(open.begin(), open.end(), std::greater<std::pair<std::uint32_t, std::uint32_t>>());
+                    }
+                });
+            }
+            // Each work item writes its own column
+            for (std::uint32_t portal = 0; portal < m_portalRegion.size(); ++portal) {
+                Region& region = m_regions[m_portalRegion[portal]];
+                region.landmarks[(portal - m_portalBase[m_portalRegion[portal]]) * PATH_LANDMARKS + l] = distance[portal];
+            }
+        });
+    }
+
+    TilePoint portalPosition(std::uint32_t portal) const {
+        const Region& region = m_regions[m_portalRegion[portal]];
+        return region.nodes[region.portals[portal - m_portalBase[m_portalRegion[portal]]]].position;
+    }
+
+    // Breadth-first search from `from` that stays inside its cluster. Fills the distance
+    // to every cell of the cluster by local index, and optionally each cell's parent.
+    void searchCluster(int cluster, TilePoint from, std::vector<std::uint16_t>& distance,
+                       std::vector<std::uint16_t>* parent) const {
+        int left = (cluster % m_clustersX) * CLUSTER_SIZE, top = (cluster / m_clustersX) * CLUSTER_SIZE;
+        int width = clusterWidth(cluster), height = clusterHeight(cluster);
+        distance.assign(static_cast<std::size_t>(width) * height, UNREACHED);
+        if (parent)
+            parent->resize(distance.size());
+
+        std::uint16_t queue[CLUSTER_SIZE * CLUSTER_SIZE];
+        int head = 0, tail = 0;
+        int start = (from.y - top) * width + (from.x - left);
+        distance[start] = 0;
+        queue[tail++] = static_cast<std::uint16_t>(start);
+        while (head < tail) {
+            int cell = queue[head++];
+            int x = cell % width, y = cell / width;
+            const int neighbors[4][2] = {{x, y - 1}, {x + 1, y}, {x, y + 1}, {x - 1, y}};
+            for (const auto& n : neighbors) {
+                if (n[0] < 0 || n[1] < 0 || n[0] >= width || n[1] >= height)
+                    continue;
+                int next = n[1] * width + n[0];
+                if (distance[next] != UNREACHED || !m_grid.isWalkable(left + n[0], top + n[1]))
+                    continue;
+                distance[next] = static_cast<std::uint16_t>(distance[cell] + 1);
+                if (parent)
+                    (*parent)[next] = static_cast<std::uint16_t>(cell);
+                queue[tail++] = static_cast<std::uint16_t>(next);
+            }
+        }
+    }
+
+    // Dijkstra over the nodes of a region from seeds of (node, cost), stopping early
+    // once target is settled if one is given
+    static void searchRegion(const Region& region, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& seeds,
+                             std::uint32_t target, RegionSearch& search) {
+        if (search.stamp.size() < region.nodes.size()) {
+            search.stamp.resize(region.nodes.size(), 0);
+            search.cost.resize(region.nodes.size());
+            search.parent.resize(region.nodes.size());
+        }
+        ++search.query;
+        search.open.clear();
+        auto push = [&](std::uint32_t node, std::uint32_t cost, std::uint32_t parent) {
+            if (search.stamp[node] == search.query && search.cost[node] <= cost)
+                return;
+            search.stamp[node] = search.query;
+            search.cost[node] = cost;
+            search.parent[node] = parent;
+            search.open.emplace_back(cost, node);
+            std::push_heap(search.open.begin(), search.open.end(), std::greater<std::pair<std::uint32_t, std::uint32_t>>());
+        };
+        for (const auto& [node, cost] : seeds)
+            push(node, cost, NO_NODE);
+        while (!search.open.empty()) {
+            std::pop_heap(search.open.begin(), search.open.end(), std::greater<std::pair<std::uint32_t, std::uint32_t>>());
+            auto [cost, node] = search.open.back();
+            search.open.pop_back();
+            if (cost != search.cost[node])
+                continue;
+            if (node == target)
+                return;
+            for (std::size_t e = region.nodes[node].firstEdge; e < edgeEnd(region, node); ++e)
+                push(region.edges[e].to, cost + region.edges[e].cost, node);
+        }
+    }
+
+    // The nodes of p's cluster that p reaches inside it, with their distance to p
+    void clusterSeeds(TilePoint p, std::vector<std::pair<std::uint32_t, std::uint32_t>>& seeds) {
+        int cluster = clusterOf(p);
+        const Region& region = m_regions[regionOf(p)];
+        searchCluster(cluster, p, m_distance, nullptr);
+        seeds.clear();
+        for (std::uint32_t node : region.clusterNodes[regionCluster(p)]) {
+            std::uint16_t d = m_distance[localIndex(cluster, region.nodes[node].position)];
+            if (d != UNREACHED)
+                seeds.emplace_back(node, d);
+        }
+    }
+
+    // Cheapest cost from the seeds to each portal of the region, and the seed it is from
+    static void portalCosts(const Region& region, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& seeds,
+                            std::vector<std::uint32_t>& cost, std::vector<std::uint32_t>& via) {
+        std::size_t count = region.portals.size();
+        cost.assign(count, NO_PATH);
+        via.assign(count, NO_NODE);
+        for (const auto& [node, d] : seeds) {
+            const std::uint16_t* row = region.toPortal.data() + node * count;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (row[i] != UNREACHED && d + row[i] < cost[i]) {
+                    cost[i] = d + row[i];
+                    via[i] = node;
+                }
+            }
+        }
+    }
+
+    // Appends the transition tiles on the shortest path inside a region between two of
+    // its nodes, both included
+    void appendRegionPath(const Region& region, std::uint32_t from, std::uint32_t to, std::vector<TilePoint>& waypoints) {
+        searchRegion(region, {{from, 0}}, to, m_search);
+        std::vector<TilePoint> reversed;
+        for (std::uint32_t node = to; node != NO_NODE; node = m_search.parent[node])
+            reversed.push_back(region.nodes[node].position);
+        for (auto it = reversed.rbegin(); it != reversed.rend(); ++it)
+            appendWaypoint(*it, waypoints);
+    }
+
+    // Manhattan distance to goal, or the landmark bound if that is larger: a portal
+    // d(l, p) from landmark l is at least |d(l, goal) - d(l, p)| from goal
+    std::uint32_t heuristic(std::uint32_t portal, TilePoint goal) const {
+        TilePoint p = portalPosition(portal);
+        std::uint32_t bound = static_cast<std::uint32_t>(std::abs(p.x - goal.x) + std::abs(p.y - goal.y));
+        const Region& region = m_regions[m_portalRegion[portal]];
+        const std::uint32_t* distance = &region.landmarks[(portal - m_portalBase[m_portalRegion[portal]]) * PATH_LANDMARKS];
+        for (int l = 0; l < PATH_LANDMARKS; ++l) {
+            if (distance[l] == NO_PATH || m_goalLandmarks[l] == NO_PATH)
+                continue;
+            bound = std::max(bound, distance[l] > m_goalLandmarks[l] ? distance[l] - m_goalLandmarks[l]
+                                                                     : m_goalLandmarks[l] - distance[l]);
+        }
+        return bound;
+    }
+
+    // Opens a portal, or the goal node, unless it is already open for less or cannot
+    // beat the bound
+    void push(std::uint32_t node, std::uint32_t cost, std::uint32_t parent, TilePoint goal, std::uint32_t bound) {
+        if (m_stamp[node] == m_query && m_cost[node] <= cost)
+            return;
+        std::uint32_t priority = cost + (node < m_portalRegion.size() ? heuristic(node, goal) : 0);
+        if (priority >= bound)
+            return;
+        m_stamp[node] = m_query;
+        m_cost[node] = cost;
+        m_parent[node] = parent;
+        m_open.push_back(OpenEntry{priority, cost, node});
+        std::push_heap(m_open.begin(), m_open.end(), std::greater<OpenEntry>());
+    }
+
+    const WalkabilityGrid& m_grid;
+    int m_clustersX;
+    int m_clustersY;
+    int m_regionsX;
+    int m_regionsY;
+    std::vector<Region> m_regions;
+    std::vector<std::uint32_t> m_portalBase;   // Number of the first portal of each region
+    std::vector<std::uint32_t> m_portalRegion; // Region of each portal
+    std::vector<std::uint32_t> m_component;    // Connected component of each portal
+
+    // Query state, reused between queries. A portal's cost and parent are only valid
+    // when its stamp matches the current query.
+    std::uint32_t m_query = 0;
+    std::vector<std::uint32_t> m_stamp;
+    std::vector<std::uint32_t> m_cost;
+    std::vector<std::uint32_t> m_parent;
+    std::vector<OpenEntry> m_open;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_startSeeds;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_goalSeeds;
+    std::vector<std::uint32_t> m_startCost; // By portal of start's region
+    std::vector<std::uint32_t> m_startVia;  // Likewise: the node of start's cluster the cost is through
+    std::vector<std::uint32_t> m_goalCost;  // By portal of goal's region
+    std::vector<std::uint32_t> m_goalVia;   // Likewise, for goal's cluster
+    std::uint32_t m_goalLandmarks[PATH_LANDMARKS];
+    RegionSearch m_search;
+    std::vector<std::uint16_t> m_distance;
+    std::vector<std::uint16_t> m_cellParent;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include "ThreadPool.h"
+#include "TileGrid.h"
+#include "TileSource.h"
+#include <cmath>
+#include <cstdint>
+
+// Tile types in tiles.png
+const TileId TILE_GRASS = 0;
+const TileId TILE_WATER = 1;
+const TileId TILE_WALL = 2;
+const TileId TILE_TREE = 3;
+
+// Seeded terrain generator. Every value is a pure function of (seed, tile coordinate):
+// noise gradients come from hashing lattice coordinates rather than from a random number
+// stream, so any chunk can be generated on its own, in any order and on any thread, and
+// always comes out the same. Nothing has to be stored to regenerate a chunk.
+//
+// Terrain is two layers of Perlin noise summed over a few octaves: elevation picks water,
+// land or rock (wall), and moisture picks where trees grow on land.
+class TerrainGenerator {
+public:
+    explicit TerrainGenerator(std::uint32_t seed) : m_seed(seed) {}
+
+    std::uint32_t getSeed() const { return m_seed; }
+
+    TileId tileAt(std::int32_t x, std::int32_t y) const {
+        float elevation = fractalNoise(m_seed, x, y);
+        if (elevation < -0.12f)
+            return TILE_WATER;
+        if (elevation > 0.3f)
+            return TILE_WALL;
+        float moisture = fractalNoise(m_seed ^ 0x5bd1e995u, x, y);
+        // Forests are dense in their middle and thin out towards the edges
+        if (moisture > 0.1f && (hash(m_seed + 1, x, y) & 0xff) < static_cast<std::uint32_t>(moisture * 700.0f))
+            return TILE_TREE;
+        return TILE_GRASS;
+    }
+
+    // Fills the CHUNK_TILES tiles of chunk (cx, cy), row by row
+    void generateChunk(TileId* tiles, int cx, int cy) const {
+        for (int i = 0; i < CHUNK_TILES; ++i)
+            tiles[i] = tileAt(cx * CHUNK_SIZE + i % CHUNK_SIZE, cy * CHUNK_SIZE + i / CHUNK_SIZE);
+    }
+
+    // Fills a whole grid, one chunk per work item
+    void generate(TileGrid& grid, ThreadPool& pool) const {
+        int chunksX = grid.getChunksX();
+        pool.parallelFor(static_cast<std::size_t>(chunksX) * grid.getChunksY(), [&](std::size_t chunk) {
+            int cx = static_cast<int>(chunk % chunksX), cy = static_cast<int>(chunk / chunksX);
+            generateChunk(grid.chunkData(cx, cy), cx, cy);
+        });
+    }
+
+private:
+    // Integer hash of a seed and a coordinate pair (a 32-bit finalizer over the mixed inputs)
+    static std::uint32_t hash(std::uint32_t seed, std::int32_t x, std::int32_t y) {
+        std::uint32_t h = seed * 0x9e3779b9u;
+        h ^= static_cast<std::uint32_t>(x) * 0x85ebca6bu;
+        h = (h << 13) | (h >> 19);
+        h ^= static_cast<std::uint32_t>(y) * 0xc2b2ae35u;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // Dot product of the lattice point's pseudo-random gradient with the offset (dx, dy)
+    static float gradient(std::uint32_t seed, std::int32_t x, std::int32_t y, float dx, float dy) {
+        switch (hash(seed, x, y) & 7) {
+            case 0: return dx + dy;
+            case 1: return dx - dy;
+            case 2: return -dx + dy;
+            case 3: return -dx - dy;
+            case 4: return dx;
+            case 5: return -dx;
+            case 6: return dy;
+            default: return -dy;
+        }
+    }
+
+    static float fade(float t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+    // Perlin noise with a lattice cell every 2^shift tiles. The cell and the offset within
+    // it come from integer tile coordinates, so results do not lose precision far from
+    // the origin and match exactly between chunks.
+    static float perlin(std::uint32_t seed, std::int32_t x, std::int32_t y, int shift) {
+        std::int32_t cellX = x >> shift, cellY = y >> shift;
+        std::int32_t mask = (1 << shift) - 1;
+        float scale = 1.0f / static_cast<float>(1 << shift);
+        float fx = (static_cast<float>(x & mask) + 0.5f) * scale;
+        float fy = (static_cast<float>(y & mask) + 0.5f) * scale;
+
+        float n00 = gradient(seed, cellX, cellY, fx, fy);
+        float n10 = gradient(seed, cellX + 1, cellY, fx - 1.0f, fy);
+        float n01 = gradient(seed, cellX, cellY + 1, fx, fy - 1.0f);
+        float n11 = gradient(seed, cellX + 1, cellY + 1, fx - 1.0f, fy - 1.0f);
+        float u = fade(fx), v = fade(fy);
+        float top = n00 + u * (n10 - n00);
+        float bottom = n01 + u * (n11 - n01);
+        return top + v * (bottom - top);
+    }
+
+    // Octaves from 128-tile features down to 16-tile detail, roughly in [-1, 1]
+    static float fractalNoise(std::uint32_t seed, std::int32_t x, std::int32_t y) {
+        float sum = 0.0f, amplitude = 1.0f, total = 0.0f;
+        for (int octave = 0; octave < 4; ++octave) {
+            sum += amplitude * perlin(seed + static_cast<std::uint32_t>(octave) * 0x68e31da4u, x, y, 7 - octave);
+            total += amplitude;
+            amplitude *= 0.5f;
+        }
+        return sum / total;
+    }
+
+    std::uint32_t m_seed;
+};
+
+// Tile source that generates each chunk when it is asked for and keeps nothing, for
+// worlds too large to store. The returned chunk is only valid until the next call.
+class TerrainSource : public TileSource {
+public:
+    TerrainSource(int width, int height, std::uint32_t seed)
+        : m_width(width), m_height(height), m_generator(seed) {}
+
+    int getWidth() const override { return m_width; }
+    int getHeight() const override { return m_height; }
+
+    const TileId* chunkData(int cx, int cy) const override {
+        m_generator.generateChunk(m_scratch, cx, cy);
+        return m_scratch;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    TerrainGenerator m_generator;
+    mutable TileId m_scratch[CHUNK_TILES];
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+// Where a packed image ended up: the atlas page and its pixel rectangle there. An
+// animation's frames sit side by side, frame n at rect.left + n * frameStride.
+struct AtlasRegion {
+    unsigned page = 0;
+    sf::IntRect rect; // First frame
+    int frameStride = 0;
+    sf::Color averageColor; // Mean of the first frame's pixels
+};
+
+// Packs many small images into as few textures ("pages") as possible at load time, so
+// everything drawn from the atlas can share one texture and be batched.
+//
+// Images are placed on shelves, tallest first. Each page starts at 64x64 and doubles
+// until everything fits or the size limit is reached, then a new page is started. Every
+// image (and every frame of an animation) is surrounded by a border of copies of its edge
+// pixels: with mipmaps, a tile shrunk to a few pixels then still samples its own colors
+// instead of its neighbours'.
+class TextureAtlas {
+public:
+    explicit TextureAtlas(unsigned maxPageSize = 2048, unsigned padding = 4)
+        : m_maxPageSize(maxPageSize), m_padding(padding) {}
+
+    // Queues the source rectangle of an image for packing and returns its region index.
+    // With several frames, source is the first and the rest follow it to the right.
+    std::size_t add(const sf::Image& image, const sf::IntRect& source, int frames = 1) {
+        // Frames are copied with extruded gutters between them; the outer border is
+        // added when the strip is placed on a page
+        int stride = source.width + 2 * static_cast<int>(m_padding);
+        sf::Image copy;
+        copy.create(static_cast<unsigned>(stride * (frames - 1) + source.width), static_cast<unsigned>(source.height));
+        for (int y = 0; y < source.height; ++y) {
+            for (int x = 0; x < static_cast<int>(copy.getSize().x); ++x) {
+                int frame = x / stride, frameX = x % stride;
+                if (frameX >= source.width) {
+                    // Gutter: the left half repeats this frame's last column, the right half the next frame's first
+                    if (frameX < source.width + static_cast<int>(m_padding)) {
+                        frameX = source.width - 1;
+                    } else {
+                        ++frame;
+                        frameX = 0;
+                    }
+                }
+                copy.setPixel(x, y, image.getPixel(source.left + frame * source.width + frameX, source.top + y));
+            }
+        }
+        unsigned long long sum[4] = {0, 0, 0, 0};
+        for (int y = 0; y < source.height; ++y) {
+            for (int x = 0; x < source.width; ++x) {
+                sf::Color color = image.getPixel(source.left + x, source.top + y);
+                sum[0] += color.r;
+                sum[1] += color.g;
+                sum[2] += color.b;
+                sum[3] += color.a;
+            }
+        }
+        unsigned long long count = std::max(1ull, static_cast<unsigned long long>(source.width) * source.height);
+
+        // Position is filled in by build()
+        AtlasRegion region;
+        region.rect = sf::IntRect(0, 0, source.width, source.height);
+        region.frameStride = stride;
+        region.averageColor = sf::Color(static_cast<sf::Uint8>(sum[0] / count), static_cast<sf::Uint8>(sum[1] / count),
+                                        static_cast<sf::Uint8>(sum[2] / count), static_cast<sf::Uint8>(sum[3] / count));
+        m_regions.push_back(region);
+        m_pending.push_back(std::move(copy));
+        return m_pending.size() - 1;
+    }
+
+    // Packs every queued image, uploads the pages and generates their mipmaps
+    bool build() {
+        unsigned limit = std::min(m_maxPageSize, sf::Texture::getMaximumSize());
+        std::vector<std::size_t> order(m_pending.size());
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return m_pending[a].getSize().y > m_pending[b].getSize().y;
+        });
+
+        m_pages.clear();
+        std::size_t placed = 0;
+        while (placed < order.size()) {
+            // Smallest page that holds everything left, or as much as fits in the largest
+            unsigned size = 64;
+            std::size_t count = pack(order, placed, size, false);
+            while (placed + count < order.size() && size < limit) {
+                size *= 2;
+                count = pack(order, placed, size, false);
+            }
+            if (count == 0) {
+                std::cerr << "Atlas image larger than the maximum page size " << limit << std::endl;
+                return false;
+            }
+            pack(order, placed, size, true);
+            placed += count;
+        }
+        m_pending.clear();
+        return true;
+    }
+
+    const AtlasRegion& getRegion(std::size_t index) const { return m_regions[index]; }
+    std::size_t getRegionCount() const { return m_regions.size(); }
+
+    const sf::Texture& getPage(unsigned page) const { return *m_pages[page]; }
+    unsigned getPageCount() const { return static_cast<unsigned>(m_pages.size()); }
+
+private:
+    // Shelf-packs order[first..] into a size x size page and returns how many fit. With
+    // commit set, also creates the page, copies the images into it and records regions.
+    std::size_t pack(const std::vector<std::size_t>& order, std::size_t first, unsigned size, bool commit) {
+        sf::Image page;
+        unsigned pageIndex = static_cast<unsigned>(m_pages.size());
+        if (commit)
+            page.create(size, size, sf::Color::Transparent);
+
+        unsigned x = 0, y = 0, shelfHeight = 0;
+        std::size_t count = 0;
+        for (std::size_t i = first; i < order.size(); ++i) {
+            const sf::Image& image = m_pending[order[i]];
+            unsigned width = image.getSize().x + 2 * m_padding, height = image.getSize().y + 2 * m_padding;
+            if (x + width > size) {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            if (x + width > size || y + height > size)
+                break;
+
+            if (commit) {
+                blit(page, image, x + m_padding, y + m_padding);
+                AtlasRegion& region = m_regions[order[i]];
+                region.page = pageIndex;
+                region.rect.left = static_cast<int>(x + m_padding);
+                region.rect.top = static_cast<int>(y + m_padding);
+            }
+            x += width;
+            shelfHeight = std::max(shelfHeight, height);
+            ++count;
+        }
+
+        if (commit) {
+            auto texture = std::make_unique<sf::Texture>();
+            texture->loadFromImage(page);
+            texture->setSmooth(true);
+            texture->generateMipmap();
+            m_pages.push_back(std::move(texture));
+        }
+        return count;
+    }
+
+    // Copies image to (left, top) and extrudes its edges into the padding around it
+    void blit(sf::Image& page, const sf::Image& image, unsigned left, unsigned top) const {
+        int width = static_cast<int>(image.getSize().x), height = static_cast<int>(image.getSize().y);
+        int padding = static_cast<int>(m_padding);
+        for (int y = -padding; y < height + padding; ++y) {
+            for (int x = -padding; x < width + padding; ++x) {
+                int sourceX = std::clamp(x, 0, width - 1), sourceY = std::clamp(y, 0, height - 1);
+                page.setPixel(left + x, top + y, image.getPixel(sourceX, sourceY));
+            }
+        }
+    }
+
+    unsigned m_maxPageSize;
+    unsigned m_padding;
+    std::vector<sf::Image> m_pending; // Copies of the added images until build()
+    std::vector<AtlasRegion> m_regions;
+    std::vector<std::unique_ptr<sf::Texture>> m_pages;
+};
+
+#endif
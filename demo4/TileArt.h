@@ -0,0 +1,79 @@
+#ifndef TILEART_H
+#define TILEART_H
+
+#include <SFML/Graphics.hpp>
+#include "AutoTiler.h"
+#include <algorithm>
+#include <cmath>
+
+// Tile images derived from existing ones at load time, for sheets that only hold a
+// single still image per tile. Each function returns a strip of frames side by side,
+// ready for TileFactory::addAnimatedTile with firstFrame at (0, 0).
+
+// Frames of the tile scrolling horizontally by one tile width over the animation
+inline sf::Image scrollingFrames(const sf::Image& sheet, const sf::IntRect& tile, int frames) {
+    sf::Image strip;
+    strip.create(static_cast<unsigned>(tile.width * frames), static_cast<unsigned>(tile.height));
+    for (int frame = 0; frame < frames; ++frame) {
+        int shift = frame * tile.width / frames;
+        for (int y = 0; y < tile.height; ++y)
+            for (int x = 0; x < tile.width; ++x)
+                strip.setPixel(frame * tile.width + x, y,
+                               sheet.getPixel(tile.left + (x + shift) % tile.width, tile.top + y));
+    }
+    return strip;
+}
+
+// Frames of the tile swaying sideways, most at the top and not at all at the bottom,
+// like a tree in the wind. Pixels pulled in from beyond the edge repeat the edge column.
+inline sf::Image swayingFrames(const sf::Image& sheet, const sf::IntRect& tile, int frames, float amplitude) {
+    sf::Image strip;
+    strip.create(static_cast<unsigned>(tile.width * frames), static_cast<unsigned>(tile.height));
+    for (int frame = 0; frame < frames; ++frame) {
+        float phase = std::sin(6.2831853f * static_cast<float>(frame) / static_cast<float>(frames));
+        for (int y = 0; y < tile.height; ++y) {
+            float height = 1.0f - static_cast<float>(y) / static_cast<float>(tile.height);
+            int shift = static_cast<int>(std::lround(amplitude * phase * height * height));
+            for (int x = 0; x < tile.width; ++x)
+                strip.setPixel(frame * tile.width + x, y,
+                               sheet.getPixel(tile.left + std::clamp(x - shift, 0, tile.width - 1), tile.top + y));
+        }
+    }
+    return strip;
+}
+
+// Autotile border variants of a tile, one row per neighbor mask (see AutoTiler.h) and one
+// column per frame of firstFrame's animation. Each side whose neighbor is a different
+// terrain fades into the border color over width pixels.
+inline sf::Image borderVariants(const sf::Image& sheet, const sf::IntRect& firstFrame, int frames, sf::Color border,
+                                int width) {
+    const int sides[4] = {AUTOTILE_NORTH, AUTOTILE_EAST, AUTOTILE_SOUTH, AUTOTILE_WEST};
+    sf::Image variants;
+    variants.create(static_cast<unsigned>(firstFrame.width * frames),
+                    static_cast<unsigned>(firstFrame.height * AUTOTILE_VARIANTS));
+    for (int mask = 0; mask < AUTOTILE_VARIANTS; ++mask) {
+        for (int frame = 0; frame < frames; ++frame) {
+            for (int y = 0; y < firstFrame.height; ++y) {
+                for (int x = 0; x < firstFrame.width; ++x) {
+                    // Distance to each edge, in the order of sides
+                    int distances[4] = {y, firstFrame.width - 1 - x, firstFrame.height - 1 - y, x};
+                    float blend = 0.0f;
+                    for (int side = 0; side < 4; ++side)
+                        if (!(mask & sides[side]) && distances[side] < width)
+                            blend = std::max(blend, 1.0f - static_cast<float>(distances[side]) / width);
+
+                    sf::Color color = sheet.getPixel(firstFrame.left + frame * firstFrame.width + x, firstFrame.top + y);
+                    auto mix = [blend](sf::Uint8 from, sf::Uint8 to) {
+                        return static_cast<sf::Uint8>(from + (to - from) * blend + 0.5f);
+                    };
+                    variants.setPixel(frame * firstFrame.width + x, mask * firstFrame.height + y,
+                                      sf::Color(mix(color.r, border.r), mix(color.g, border.g), mix(color.b, border.b),
+                                                mix(color.a, border.a)));
+                }
+            }
+        }
+    }
+    return variants;
+}
+
+#endif
@@ -2,33 +2,179 @@
 #define TILEFACTORY_H
 
 #include <SFML/Graphics.hpp>
-#include <unordered_map>
+#include "TextureAtlas.h"
+#include "TileSource.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
 
+// Number of distinct tile IDs; lookups are flat arrays of this size
+const int TILE_ID_COUNT = 256;
+
+// Owns the tile flyweights. Tiles are cut from any number of sprite sheets and packed
+// into a TextureAtlas by build(), after which each tile ID's atlas page, texture rect
+// and average color are plain array lookups. IDs that were never registered show a
+// magenta "missing" tile rather than reading out of bounds.
+//
+// Animated tiles are a run of frames laid side by side in the atlas; the frame shown at a
+// given time is the first frame's rect shifted by frame * stride.
 class TileFactory {
 public:
-    TileFactory(sf::Texture& texture) : m_texture(texture) {
-        // Preload sprites for each tile type
-        m_sprites[0] = createSprite(0, 0);     // Grass
-        m_sprites[1] = createSprite(64, 0);    // Water
-        m_sprites[2] = createSprite(128, 0);   // Wall
-        m_sprites[3] = createSprite(192, 0);   // Tree
+    explicit TileFactory(unsigned maxPageSize = 2048) : m_atlas(maxPageSize) {}
+
+    // Loads a sprite sheet to cut tiles from and returns its index, or -1 on failure
+    int addSheet(const std::string& filename) {
+        sf::Image sheet;
+        if (!sheet.loadFromFile(filename)) {
+            std::cerr << "Failed to load tile sheet: " << filename << std::endl;
+            return -1;
+        }
+        return addSheet(sheet);
     }
 
-    sf::Sprite getTile(int type) {
-        return m_sprites[type];
+    int addSheet(const sf::Image& sheet) {
+        m_sheets.push_back(sheet);
+        return static_cast<int>(m_sheets.size()) - 1;
     }
 
-private:
-    sf::Sprite createSprite(int x, int y) {
-        sf::Sprite sprite;
-        sprite.setTexture(m_texture);
-        sprite.setTextureRect(sf::IntRect(x, y, 64, 64));
-        return sprite;
+    // Sheets can be read to derive new tile images from them until build()
+    const sf::Image& getSheet(int sheet) const {
+        return m_sheets[sheet];
+    }
+
+    // Registers the next tile ID as the given rectangle of a sheet. Returns the ID, or -1
+    // once all TILE_ID_COUNT IDs are taken.
+    int addTile(int sheet, const sf::IntRect& rect) {
+        return addAnimatedTile(sheet, rect, 1, 0.0f);
+    }
+
+    // Registers the next tile ID as an animation of frameCount frames (1 to 255), the
+    // first at firstFrame and the rest to its right, each shown for frameSeconds.
+    // Returns the ID, or -1 on failure.
+    int addAnimatedTile(int sheet, const sf::IntRect& firstFrame, int frameCount, float frameSeconds) {
+        if (m_tileRegions.size() >= TILE_ID_COUNT) {
+            std::cerr << "Too many tile types, at most " << TILE_ID_COUNT << " are supported" << std::endl;
+            m_rejected = true;
+            return -1;
+        }
+        if (sheet < 0 || sheet >= static_cast<int>(m_sheets.size()) || frameCount < 1 || frameCount > 255) {
+            std::cerr << "Invalid tile: sheet " << sheet << ", " << frameCount << " frames" << std::endl;
+            m_rejected = true;
+            return -1;
+        }
+        m_tileRegions.push_back(m_atlas.add(m_sheets[sheet], firstFrame, frameCount));
+        m_tileAnimations.push_back(Animation{static_cast<std::uint8_t>(frameCount), 0, frameSeconds});
+        return static_cast<int>(m_tileRegions.size()) - 1;
+    }
+
+    // Packs every registered tile into the atlas and fills the lookup tables. Fails if
+    // a tile was rejected, so a tile set that does not fit is never drawn with the
+    // wrong IDs.
+    bool build() {
+        if (m_rejected)
+            return false;
+        sf::Image missing;
+        missing.create(8, 8, sf::Color::Magenta);
+        std::size_t missingRegion = m_atlas.add(missing, sf::IntRect(0, 0, 8, 8));
+        if (!m_atlas.build())
+            return false;
+        m_sheets.clear();
+
+        m_rects.assign(TILE_ID_COUNT, m_atlas.getRegion(missingRegion).rect);
+        m_pages.assign(TILE_ID_COUNT, static_cast<std::uint8_t>(m_atlas.getRegion(missingRegion).page));
+        m_colors.assign(TILE_ID_COUNT, sf::Color::Magenta);
+        m_animations.assign(TILE_ID_COUNT, Animation());
+        for (std::size_t id = 0; id < m_tileRegions.size(); ++id) {
+            const AtlasRegion& region = m_atlas.getRegion(m_tileRegions[id]);
+            m_rects[id] = region.rect;
+            m_pages[id] = static_cast<std::uint8_t>(region.page);
+            m_colors[id] = region.averageColor;
+            m_animations[id] = m_tileAnimations[id];
+            m_animations[id].stride = region.frameStride;
+        }
+
+        m_sprites.clear();
+        for (int id = 0; id < TILE_ID_COUNT; ++id)
+            m_sprites.emplace_back(m_atlas.getPage(m_pages[id]), m_rects[id]);
+        return true;
+    }
+
+    const sf::Sprite& getTile(int type) const {
+        return m_sprites[static_cast<TileId>(type)];
+    }
+
+    // Region of its atlas page used by a tile type (the first frame if animated), for
+    // batched rendering
+    const sf::IntRect& getTextureRect(TileId type) const {
+        return m_rects[type];
     }
 
-    sf::Texture& m_texture;
-    std::unordered_map<int, sf::Sprite> m_sprites;
+    bool isAnimated(TileId type) const {
+        return m_animations[type].frames > 1;
+    }
+
+    int getFrameCount(TileId type) const {
+        return m_animations[type].frames;
+    }
+
+    // Horizontal distance in texels from one frame to the next
+    int getFrameStride(TileId type) const {
+        return m_animations[type].stride;
+    }
+
+    float getFrameSeconds(TileId type) const {
+        return m_animations[type].seconds;
+    }
+
+    // Frame of a tile's animation showing at the given time
+    int getFrame(TileId type, float seconds) const {
+        const Animation& animation = m_animations[type];
+        if (animation.frames <= 1 || animation.seconds <= 0.0f)
+            return 0;
+        return static_cast<int>(seconds / animation.seconds) % animation.frames;
+    }
+
+    unsigned getPage(TileId type) const {
+        return m_pages[type];
+    }
+
+    const sf::Texture& getTexture(unsigned page = 0) const {
+        return m_atlas.getPage(page);
+    }
+
+    unsigned getPageCount() const {
+        return m_atlas.getPageCount();
+    }
+
+    // Mean color of a tile's pixels, for drawing it as a single texel when zoomed out
+    const sf::Color& getAverageColor(TileId type) const {
+        return m_colors[type];
+    }
+
+    int getTileTypeCount() const {
+        return static_cast<int>(m_tileRegions.size());
+    }
+
+private:
+    struct Animation {
+        std::uint8_t frames = 1;
+        int stride = 0;
+        float seconds = 0.0f;
+    };
+
+    TextureAtlas m_atlas;
+    std::vector<sf::Image> m_sheets; // Only kept until build()
+    std::vector<std::size_t> m_tileRegions; // Atlas region of each registered tile ID
+    std::vector<Animation> m_tileAnimations; // Frames of each registered tile ID, stride set by build()
+    bool m_rejected = false; // A tile could not be registered
+
+    // Indexed by tile ID
+    std::vector<sf::IntRect> m_rects;
+    std::vector<std::uint8_t> m_pages;
+    std::vector<sf::Color> m_colors;
+    std::vector<Animation> m_animations;
+    std::vector<sf::Sprite> m_sprites;
 };
 
 #endif
-
@@ -0,0 +1,49 @@
+#ifndef TILEGRID_H
+#define TILEGRID_H
+
+#include "TileSource.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense grid of tile IDs, one byte per tile. Storage is chunk-major: the
+// CHUNK_SIZE x CHUNK_SIZE tiles of a chunk are contiguous, so building or
+// generating a chunk touches one small block of memory.
+class TileGrid : public TileSource {
+public:
+    TileGrid(int width, int height)
+        : m_width(width), m_height(height),
+          m_chunksX((width + CHUNK_SIZE - 1) / CHUNK_SIZE), m_chunksY((height + CHUNK_SIZE - 1) / CHUNK_SIZE),
+          m_tiles(static_cast<std::size_t>(m_chunksX) * m_chunksY * CHUNK_TILES, 0) {
+    }
+
+    int getWidth() const override { return m_width; }
+    int getHeight() const override { return m_height; }
+
+    TileId get(int x, int y) const { return m_tiles[index(x, y)]; }
+    void set(int x, int y, TileId id) { m_tiles[index(x, y)] = id; }
+
+    // The CHUNK_TILES tiles of a chunk, row by row
+    const TileId* chunkData(int cx, int cy) const override {
+        return &m_tiles[(static_cast<std::size_t>(cy) * m_chunksX + cx) * CHUNK_TILES];
+    }
+    TileId* chunkData(int cx, int cy) {
+        return &m_tiles[(static_cast<std::size_t>(cy) * m_chunksX + cx) * CHUNK_TILES];
+    }
+
+    std::size_t memoryBytes() const { return m_tiles.capacity() * sizeof(TileId); }
+
+private:
+    std::size_t index(int x, int y) const {
+        std::size_t chunk = static_cast<std::size_t>(y / CHUNK_SIZE) * m_chunksX + x / CHUNK_SIZE;
+        return chunk * CHUNK_TILES + (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE;
+    }
+
+    int m_width;
+    int m_height;
+    int m_chunksX;
+    int m_chunksY;
+    std::vector<TileId> m_tiles;
+};
+
+#endif
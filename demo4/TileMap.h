@@ -0,0 +1,563 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <SFML/Graphics.hpp>
+#include "TileFactory.h"
+#include "TileSource.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Size of one tile in world coordinates; atlas tiles are scaled to it
+const int TILE_SIZE = 64;
+
+// Zoom (world pixels per screen pixel) from which the map is drawn from low-detail
+// pages instead of chunks; tiles are then under 8 screen pixels wide
+const float LOD_ZOOM = 8.0f;
+// Chunks per side of one low-detail page, which has one texel per tile
+const int LOD_PAGE_CHUNKS = 16;
+
+// Default memory budget for built chunks and pages
+const std::size_t DEFAULT_CACHE_BYTES = 64 * 1024 * 1024;
+
+// Default GPU memory budget for chunks prerendered into textures, and the texels per
+// tile side in those textures, matching the tile sheet
+const std::size_t DEFAULT_TEXTURE_CACHE_BYTES = 128 * 1024 * 1024;
+const int CHUNK_TEXELS_PER_TILE = 32;
+
+// Picks an animated tile's frame on the GPU. The animation is packed into the vertex
+// color (see TileMap::animationColor), so the vertices never change after being built
+// and advancing every animation on screen is a single uniform update.
+const char* const ANIMATION_VERTEX_SHADER = R"(
+uniform float time;
+
+void main() {
+    vec4 packed = floor(gl_Color * 255.0 + 0.5);
+    float frames = packed.r;
+    float frameSeconds = packed.g / 100.0;
+    float stride = packed.b * 256.0 + packed.a;
+    float frame = mod(floor(time / frameSeconds), frames);
+
+    vec4 texCoord = gl_MultiTexCoord0;
+    texCoord.x += frame * stride;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+    gl_TexCoord[0] = gl_TextureMatrix[0] * texCoord;
+    gl_FrontColor = vec4(1.0);
+}
+)";
+
+const char* const ANIMATION_FRAGMENT_SHADER = R"(
+uniform sampler2D texture;
+
+void main() {
+    gl_FragColor = gl_Color * texture2D(texture, gl_TexCoord[0].xy);
+}
+)";
+
+// Renders a TileSource split into CHUNK_SIZE x CHUNK_SIZE chunks. Each chunk holds a
+// static vertex array of textured quads for each TileFactory atlas page it uses (usually
+// just one), so drawing a chunk is one draw call no matter how many tiles it has. Chunks
+// are built the first time they become visible, and only chunks that intersect the view
+// are drawn.
+// Tile IDs are resolved to the factory's flyweights only while a chunk is being built.
+//
+// Zoomed far out, drawing chunks would touch every tile on screen, so the map switches to
+// page textures holding each tile's average color (see buildLevelOfDetail).
+//
+// Animated tiles go into a separate vertex array per chunk. A shader selects their frame
+// from a time uniform; without shader support only those arrays' texture coordinates are
+// rewritten, and only when a frame actually changes.
+//
+// Built chunks and pages share an LRU cache bounded by a memory budget, so the map can be
+// far larger than memory: whatever scrolls out of view is eventually evicted and rebuilt
+// from the source if it comes back.
+//
+// A chunk's static tiles are also rendered once into a texture, after which the chunk
+// is drawn as a single quad with the animated tiles on top. These textures live in a
+// second LRU cache with its own budget for GPU memory; a chunk that does not fit is
+// drawn from its vertex arrays instead. Both caches only drop a chunk when it is
+// evicted or one of its tiles changes.
+class TileMap : public sf::Drawable {
+public:
+    TileMap(TileFactory& factory, const TileSource& source, std::size_t cacheBudget = DEFAULT_CACHE_BYTES)
+        : m_factory(factory), m_source(source), m_chunksX(source.getChunksX()), m_chunksY(source.getChunksY()),
+          m_pagesX((m_chunksX + LOD_PAGE_CHUNKS - 1) / LOD_PAGE_CHUNKS),
+          m_pagesY((m_chunksY + LOD_PAGE_CHUNKS - 1) / LOD_PAGE_CHUNKS), m_cacheBudget(cacheBudget),
+          m_currentFrames(TILE_ID_COUNT, 0) {
+        setAnimationShader(true);
+    }
+
+    // Statistics of the last draw()
+    unsigned getLastDrawCalls() const { return m_lastDrawCalls; }
+    unsigned getLastBuilds() const { return m_lastBuilds; }
+    // Current cache contents
+    std::size_t getCachedCount() const { return m_lru.size(); }
+    std::size_t getCacheBytes() const { return m_cacheBytes; }
+
+    unsigned getLastAnimatedTiles() const { return m_lastAnimatedTiles; }
+
+    void setCacheBudget(std::size_t bytes) { m_cacheBudget = bytes; }
+
+    // Chunks prerendered into textures, and the GPU memory they take
+    std::size_t getTextureCount() const { return m_textureLru.size(); }
+    std::size_t getTextureBytes() const { return m_textureBytes; }
+
+    // 0 disables prerendered chunks
+    void setTextureCacheBudget(std::size_t bytes) {
+        m_textureBudget = bytes;
+        while (m_textureBytes > m_textureBudget)
+            popTexture();
+    }
+
+    // Drops a chunk and the low-detail page holding it, so both are rebuilt from the
+    // source the next time they are drawn
+    void invalidateChunk(int cx, int cy) {
+        erase(cacheKey(CacheEntry::Chunk, cx, cy));
+        erase(cacheKey(CacheEntry::Page, cx / LOD_PAGE_CHUNKS, cy / LOD_PAGE_CHUNKS));
+        auto found = m_textureIndex.find(cacheKey(CacheEntry::Chunk, cx, cy));
+        if (found != m_textureIndex.end()) {
+            m_textureLru.splice(m_textureLru.end(), m_textureLru, found->second);
+            popTexture();
+        }
+    }
+
+    // Selects between the animation shader and rewriting texture coordinates on the CPU.
+    // Needs an OpenGL context. Returns whether the shader is in use, which it cannot be
+    // where shaders are unsupported.
+    bool setAnimationShader(bool enabled) {
+        bool loaded = enabled && sf::Shader::isAvailable() &&
+                      m_shader.loadFromMemory(ANIMATION_VERTEX_SHADER, ANIMATION_FRAGMENT_SHADER);
+        if (loaded)
+            m_shader.setUniform("texture", sf::Shader::CurrentTexture);
+        if (loaded != m_shaderLoaded) {
+            // Animated vertex colors depend on the mode
+            m_shaderLoaded = loaded;
+            clearCache();
+            setAnimationTime(m_animationTime);
+        }
+        return m_shaderLoaded;
+    }
+
+    bool usesAnimationShader() const { return m_shaderLoaded; }
+
+    // Advances animated tiles to the given time
+    void setAnimationTime(float seconds) {
+        m_animationTime = seconds;
+        if (m_shaderLoaded) {
+            m_shader.setUniform("time", seconds);
+            return;
+        }
+        bool changed = false;
+        for (int type = 0; type < TILE_ID_COUNT; ++type) {
+            int frame = m_factory.getFrame(static_cast<TileId>(type), seconds);
+            if (frame != m_currentFrames[type]) {
+                m_currentFrames[type] = frame;
+                changed = true;
+            }
+        }
+        if (changed)
+            ++m_animationVersion;
+    }
+
+    // Enables the low-detail pages used when zoomed out, colored with each tile's
+    // average color from the factory. Pages are built the first time they are visible.
+    void buildLevelOfDetail() {
+        m_tileColors.resize(TILE_ID_COUNT);
+        for (int type = 0; type < TILE_ID_COUNT; ++type)
+            m_tileColors[type] = m_factory.getAverageColor(static_cast<TileId>(type));
+    }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override {
+        // Visible area in world coordinates, from the target's current view
+        const sf::View& view = target.getView();
+        sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.0f;
+        sf::Vector2f bottomRight = view.getCenter() + view.getSize() / 2.0f;
+
+        ++m_frame;
+        m_lastDrawCalls = 0;
+        m_lastBuilds = 0;
+        m_lastAnimatedTiles = 0;
+        float zoom = view.getSize().x / static_cast<float>(target.getSize().x);
+        if (zoom >= LOD_ZOOM && !m_tileColors.empty()) {
+            drawLevelOfDetail(target, states, topLeft, bottomRight);
+        } else {
+            const float chunkPixels = static_cast<float>(CHUNK_SIZE * TILE_SIZE);
+            int firstX = std::max(0, static_cast<int>(std::floor(topLeft.x / chunkPixels)));
+            int firstY = std::max(0, static_cast<int>(std::floor(topLeft.y / chunkPixels)));
+            int lastX = std::min(m_chunksX - 1, static_cast<int>(std::floor(bottomRight.x / chunkPixels)));
+            int lastY = std::min(m_chunksY - 1, static_cast<int>(std::floor(bottomRight.y / chunkPixels)));
+
+            for (int cy = firstY; cy <= lastY; ++cy) {
+                for (int cx = firstX; cx <= lastX; ++cx) {
+                    CacheEntry& entry = fetch(CacheEntry::Chunk, cx, cy);
+                    if (!m_shaderLoaded && entry.animationVersion != m_animationVersion)
+                        updateAnimatedFrames(entry);
+                    const sf::Texture* prerendered = fetchTexture(entry);
+                    if (prerendered)
+                        drawTexture(target, states, entry, *prerendered);
+                    for (unsigned page = 0; page < entry.vertices.size(); ++page) {
+                        states.texture = &m_factory.getTexture(page);
+                        if (!prerendered && entry.vertices[page].getVertexCount() > 0) {
+                            target.draw(entry.vertices[page], states);
+                            ++m_lastDrawCalls;
+                        }
+                        if (entry.animated[page].getVertexCount() > 0) {
+                            sf::RenderStates animatedStates = states;
+                            if (m_shaderLoaded)
+                                animatedStates.shader = &m_shader;
+                            target.draw(entry.animated[page], animatedStates);
+                            m_lastAnimatedTiles += static_cast<unsigned>(entry.animatedTiles[page].size());
+                            ++m_lastDrawCalls;
+                        }
+                    }
+                }
+            }
+        }
+        evict();
+    }
+
+private:
+    struct CacheEntry {
+        enum Kind { Chunk, Page };
+
+        Kind kind;
+        int x;
+        int y;
+        std::vector<sf::VertexArray> vertices;          // Chunk, static tiles per atlas page
+        std::vector<sf::VertexArray> animated;          // Chunk, animated tiles per atlas page
+        std::vector<std::vector<TileId>> animatedTiles; // Chunk, tile of each animated quad
+        std::uint64_t animationVersion = 0;             // Frames the animated arrays show, without the shader
+        std::unique_ptr<sf::Texture> page;              // Page
+        std::size_t bytes = 0;
+        std::uint64_t lastFrame = 0;
+    };
+
+    // A chunk's static tiles rendered into a texture
+    struct ChunkTexture {
+        std::uint64_t key;
+        sf::RenderTexture texture;
+        std::size_t bytes = 0;
+        std::uint64_t lastFrame = 0;
+    };
+
+    typedef std::list<CacheEntry>::iterator CacheIterator;
+    typedef std::list<ChunkTexture>::iterator TextureIterator;
+
+    std::uint64_t cacheKey(CacheEntry::Kind kind, int x, int y) const {
+        int columns = kind == CacheEntry::Chunk ? m_chunksX : m_pagesX;
+        return (static_cast<std::uint64_t>(y) * columns + x) * 2 + kind;
+    }
+
+    // Returns the cached chunk or page, building it on a miss, and marks it as the
+    // most recently used
+    CacheEntry& fetch(CacheEntry::Kind kind, int x, int y) const {
+        std::uint64_t key = cacheKey(kind, x, y);
+        auto found = m_cacheIndex.find(key);
+        if (found != m_cacheIndex.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, found->second);
+        } else {
+            m_lru.push_front(CacheEntry{kind, x, y, {}, {}, {}, 0, nullptr});
+            if (kind == CacheEntry::Chunk)
+                buildChunk(m_lru.front());
+            else
+                buildPage(m_lru.front());
+            m_cacheBytes += m_lru.front().bytes;
+            m_cacheIndex[key] = m_lru.begin();
+            ++m_lastBuilds;
+        }
+        m_lru.front().lastFrame = m_frame;
+        return m_lru.front();
+    }
+
+    void clearCache() {
+        m_lru.clear();
+        m_cacheIndex.clear();
+        m_cacheBytes = 0;
+    }
+
+    void erase(std::uint64_t key) {
+        auto found = m_cacheIndex.find(key);
+        if (found == m_cacheIndex.end())
+            return;
+        m_cacheBytes -= found->second->bytes;
+        m_lru.erase(found->second);
+        m_cacheIndex.erase(found);
+    }
+
+    // Drops least recently used entries until the cache fits its budget. Entries drawn
+    // this frame are kept even over budget, since they would be rebuilt next frame.
+    void evict() const {
+        while (m_cacheBytes > m_cacheBudget && !m_lru.empty() && m_lru.back().lastFrame != m_frame) {
+            const CacheEntry& oldest = m_lru.back();
+            m_cacheBytes -= oldest.bytes;
+            m_cacheIndex.erase(cacheKey(oldest.kind, oldest.x, oldest.y));
+            m_lru.pop_back();
+        }
+    }
+
+    // Returns the chunk's prerendered texture, rendering it on a miss, or null if the
+    // chunk has no static tiles or its texture does not fit the budget
+    const sf::Texture* fetchTexture(const CacheEntry& entry) const {
+        std::uint64_t key = cacheKey(CacheEntry::Chunk, entry.x, entry.y);
+        auto found = m_textureIndex.find(key);
+        if (found != m_textureIndex.end()) {
+            m_textureLru.splice(m_textureLru.begin(), m_textureLru, found->second);
+            m_textureLru.front().lastFrame = m_frame;
+            return &m_textureLru.front().texture.getTexture();
+        }
+
+        bool hasStatic = false;
+        for (const sf::VertexArray& vertices : entry.vertices)
+            hasStatic |= vertices.getVertexCount() > 0;
+        if (!hasStatic)
+            return nullptr;
+
+        // Make room, but never by evicting a texture drawn this frame
+        int tilesX = std::min(CHUNK_SIZE, m_source.getWidth() - entry.x * CHUNK_SIZE);
+        int tilesY = std::min(CHUNK_SIZE, m_source.getHeight() - entry.y * CHUNK_SIZE);
+        unsigned width = static_cast<unsigned>(tilesX * CHUNK_TEXELS_PER_TILE);
+        unsigned height = static_cast<unsigned>(tilesY * CHUNK_TEXELS_PER_TILE);
+        std::size_t bytes = static_cast<std::size_t>(width) * height * 4 * 4 / 3; // With mipmaps
+        while (m_textureBytes + bytes > m_textureBudget && !m_textureLru.empty() &&
+               m_textureLru.back().lastFrame != m_frame)
+            popTexture();
+        if (m_textureBytes + bytes > m_textureBudget)
+            return nullptr;
+
+        m_textureLru.emplace_front();
+        ChunkTexture& chunk = m_textureLru.front();
+        if (!chunk.texture.create(width, height)) {
+            m_textureLru.pop_front();
+            m_textureBudget = 0; // Render textures are unsupported, stop trying
+            return nullptr;
+        }
+        float left = static_cast<float>(entry.x * CHUNK_SIZE * TILE_SIZE);
+        float top = static_cast<float>(entry.y * CHUNK_SIZE * TILE_SIZE);
+        chunk.texture.setView(sf::View(sf::FloatRect(left, top, static_cast<float>(tilesX * TILE_SIZE),
+                                                     static_cast<float>(tilesY * TILE_SIZE))));
+        chunk.texture.clear(sf::Color::Transparent);
+        for (unsigned page = 0; page < entry.vertices.size(); ++page)
+            if (entry.vertices[page].getVertexCount() > 0)
+                chunk.texture.draw(entry.vertices[page], sf::RenderStates(&m_factory.getTexture(page)));
+        chunk.texture.display();
+        chunk.texture.setSmooth(true);
+        chunk.texture.generateMipmap();
+
+        chunk.key = key;
+        chunk.bytes = bytes;
+        chunk.lastFrame = m_frame;
+        m_textureBytes += bytes;
+        m_textureIndex[key] = m_textureLru.begin();
+        return &chunk.texture.getTexture();
+    }
+
+    void popTexture() const {
+        m_textureBytes -= m_textureLru.back().bytes;
+        m_textureIndex.erase(m_textureLru.back().key);
+        m_textureLru.pop_back();
+    }
+
+    // Draws a prerendered chunk as one quad covering the chunk
+    void drawTexture(sf::RenderTarget& target, sf::RenderStates states, const CacheEntry& entry,
+                     const sf::Texture& texture) const {
+        sf::Vector2u size = texture.getSize();
+        float left = static_cast<float>(entry.x * CHUNK_SIZE * TILE_SIZE);
+        float top = static_cast<float>(entry.y * CHUNK_SIZE * TILE_SIZE);
+        float right = left + static_cast<float>(size.x / CHUNK_TEXELS_PER_TILE * TILE_SIZE);
+        float bottom = top + static_cast<float>(size.y / CHUNK_TEXELS_PER_TILE * TILE_SIZE);
+        float u = static_cast<float>(size.x), v = static_cast<float>(size.y);
+        sf::Vertex quad[6] = {
+                sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(0, 0)),
+                sf::Vertex(sf::Vector2f(right, top), sf::Vector2f(u, 0)),
+                sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(u, v)),
+                sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(0, 0)),
+                sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(u, v)),
+                sf::Vertex(sf::Vector2f(left, bottom), sf::Vector2f(0, v)),
+        };
+        states.texture = &texture;
+        target.draw(quad, 6, sf::Triangles, states);
+        ++m_lastDrawCalls;
+    }
+
+    void drawLevelOfDetail(sf::RenderTarget& target, sf::RenderStates states, sf::Vector2f topLeft,
+                           sf::Vector2f bottomRight) const {
+        const int pageTiles = LOD_PAGE_CHUNKS * CHUNK_SIZE;
+        const float pagePixels = static_cast<float>(pageTiles * TILE_SIZE);
+        int firstX = std::max(0, static_cast<int>(std::floor(topLeft.x / pagePixels)));
+        int firstY = std::max(0, static_cast<int>(std::floor(topLeft.y / pagePixels)));
+        int lastX = std::min(m_pagesX - 1, static_cast<int>(std::floor(bottomRight.x / pagePixels)));
+        int lastY = std::min(m_pagesY - 1, static_cast<int>(std::floor(bottomRight.y / pagePixels)));
+
+        for (int py = firstY; py <= lastY; ++py) {
+            for (int px = firstX; px <= lastX; ++px) {
+                float left = px * pagePixels, top = py * pagePixels;
+                float right = left + pagePixels, bottom = top + pagePixels;
+                float size = static_cast<float>(pageTiles);
+                sf::Vertex quad[6] = {
+                        sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(0, 0)),
+                        sf::Vertex(sf::Vector2f(right, top), sf::Vector2f(size, 0)),
+                        sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(size, size)),
+                        sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(0, 0)),
+                        sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(size, size)),
+                        sf::Vertex(sf::Vector2f(left, bottom), sf::Vector2f(0, size)),
+                };
+                states.texture = fetch(CacheEntry::Page, px, py).page.get();
+                target.draw(quad, 6, sf::Triangles, states);
+                ++m_lastDrawCalls;
+            }
+        }
+    }
+
+    void buildPage(CacheEntry& entry) const {
+        const int pageTiles = LOD_PAGE_CHUNKS * CHUNK_SIZE;
+        std::vector<sf::Uint8> pixels(static_cast<std::size_t>(pageTiles) * pageTiles * 4, 0);
+        int firstX = entry.x * LOD_PAGE_CHUNKS, firstY = entry.y * LOD_PAGE_CHUNKS;
+        for (int cy = firstY; cy < std::min(m_chunksY, firstY + LOD_PAGE_CHUNKS); ++cy) {
+            for (int cx = firstX; cx < std::min(m_chunksX, firstX + LOD_PAGE_CHUNKS); ++cx) {
+                const TileId* tiles = m_source.chunkData(cx, cy);
+                for (int i = 0; i < CHUNK_TILES; ++i) {
+                    int x = (cx - firstX) * CHUNK_SIZE + i % CHUNK_SIZE;
+                    int y = (cy - firstY) * CHUNK_SIZE + i / CHUNK_SIZE;
+                    const sf::Color& color = m_tileColors[tiles[i]];
+                    sf::Uint8* pixel = &pixels[(static_cast<std::size_t>(y) * pageTiles + x) * 4];
+                    pixel[0] = color.r;
+                    pixel[1] = color.g;
+                    pixel[2] = color.b;
+                    pixel[3] = color.a;
+                }
+            }
+        }
+        sf::Image image;
+        image.create(pageTiles, pageTiles, pixels.data());
+        entry.page = std::make_unique<sf::Texture>();
+        entry.page->loadFromImage(image);
+        entry.page->setSmooth(true);
+        entry.bytes = pixels.size();
+    }
+
+    // Splits a chunk's tiles into a static and an animated vertex array per atlas page
+    void buildChunk(CacheEntry& entry) const {
+        int beginX = entry.x * CHUNK_SIZE, endX = std::min(beginX + CHUNK_SIZE, m_source.getWidth());
+        int beginY = entry.y * CHUNK_SIZE, endY = std::min(beginY + CHUNK_SIZE, m_source.getHeight());
+        const TileId* tiles = m_source.chunkData(entry.x, entry.y);
+
+        // Size each array up front, then fill them in one pass
+        unsigned pages = m_factory.getPageCount();
+        std::vector<std::size_t> counts(pages * 2, 0);
+        for (int y = beginY; y < endY; ++y) {
+            for (int x = beginX; x < endX; ++x) {
+                TileId tile = tiles[(y - beginY) * CHUNK_SIZE + (x - beginX)];
+                counts[m_factory.getPage(tile) + (m_factory.isAnimated(tile) ? pages : 0)] += 6;
+            }
+        }
+        entry.vertices.resize(pages);
+        entry.animated.resize(pages);
+        entry.animatedTiles.resize(pages);
+        for (unsigned page = 0; page < pages; ++page) {
+            entry.vertices[page].setPrimitiveType(sf::Triangles);
+            entry.vertices[page].resize(counts[page]);
+            entry.animated[page].setPrimitiveType(sf::Triangles);
+            entry.animated[page].resize(counts[pages + page]);
+            entry.animatedTiles[page].reserve(counts[pages + page] / 6);
+            entry.bytes += (counts[page] + counts[pages + page]) * sizeof(sf::Vertex) + counts[pages + page] / 6;
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for (int y = beginY; y < endY; ++y) {
+            for (int x = beginX; x < endX; ++x) {
+                TileId tile = tiles[(y - beginY) * CHUNK_SIZE + (x - beginX)];
+                unsigned page = m_factory.getPage(tile);
+                sf::Vector2f position(static_cast<float>(x * TILE_SIZE), static_cast<float>(y * TILE_SIZE));
+                if (!m_factory.isAnimated(tile)) {
+                    writeQuad(entry.vertices[page], counts[page], position, m_factory.getTextureRect(tile),
+                              sf::Color::White);
+                } else {
+                    writeQuad(entry.animated[page], counts[pages + page], position, m_factory.getTextureRect(tile),
+                              m_shaderLoaded ? animationColor(tile) : sf::Color::White);
+                    entry.animatedTiles[page].push_back(tile);
+                }
+            }
+        }
+    }
+
+    static void writeQuad(sf::VertexArray& vertices, std::size_t& v, sf::Vector2f position, const sf::IntRect& rect,
+                          sf::Color color) {
+        float left = position.x, top = position.y;
+        float right = left + TILE_SIZE, bottom = top + TILE_SIZE;
+        float u0 = static_cast<float>(rect.left), v0 = static_cast<float>(rect.top);
+        float u1 = u0 + rect.width, v1 = v0 + rect.height;
+
+        vertices[v++] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u0, v0));
+        vertices[v++] = sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u1, v0));
+        vertices[v++] = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u1, v1));
+        vertices[v++] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u0, v0));
+        vertices[v++] = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u1, v1));
+        vertices[v++] = sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u0, v1));
+    }
+
+    // Packs a tile's animation into a vertex color for ANIMATION_VERTEX_SHADER: frame count,
+    // frame duration in hundredths of a second, and the frame stride as two bytes
+    sf::Color animationColor(TileId tile) const {
+        int centiseconds = std::clamp(static_cast<int>(m_factory.getFrameSeconds(tile) * 100.0f + 0.5f), 1, 255);
+        int stride = m_factory.getFrameStride(tile);
+        return sf::Color(static_cast<sf::Uint8>(m_factory.getFrameCount(tile)), static_cast<sf::Uint8>(centiseconds),
+                         static_cast<sf::Uint8>(stride >> 8), static_cast<sf::Uint8>(stride & 0xff));
+    }
+
+    // Without shaders, points an animated array's texture coordinates at the current frames
+    void updateAnimatedFrames(CacheEntry& entry) const {
+        for (std::size_t page = 0; page < entry.animated.size(); ++page) {
+            sf::VertexArray& vertices = entry.animated[page];
+            const std::vector<TileId>& tiles = entry.animatedTiles[page];
+            for (std::size_t quad = 0; quad < tiles.size(); ++quad) {
+                const sf::IntRect& rect = m_factory.getTextureRect(tiles[quad]);
+                float u0 = static_cast<float>(rect.left + m_currentFrames[tiles[quad]] * m_factory.getFrameStride(tiles[quad]));
+                float u1 = u0 + rect.width;
+                sf::Vertex* v = &vertices[quad * 6];
+                v[0].texCoords.x = u0;
+                v[1].texCoords.x = u1;
+                v[2].texCoords.x = u1;
+                v[3].texCoords.x = u0;
+                v[4].texCoords.x = u1;
+                v[5].texCoords.x = u0;
+            }
+        }
+        entry.animationVersion = m_animationVersion;
+    }
+
+    TileFactory& m_factory;
+    const TileSource& m_source;
+    int m_chunksX;
+    int m_chunksY;
+    int m_pagesX;
+    int m_pagesY;
+    std::vector<sf::Color> m_tileColors; // Average color per tile ID, empty until buildLevelOfDetail()
+
+    // Filled lazily in draw(), hence mutable
+    std::size_t m_cacheBudget;
+    mutable std::list<CacheEntry> m_lru; // Most recently used first
+    mutable std::unordered_map<std::uint64_t, CacheIterator> m_cacheIndex;
+    mutable std::size_t m_cacheBytes = 0;
+    mutable std::uint64_t m_frame = 0;
+    mutable unsigned m_lastDrawCalls = 0;
+    mutable unsigned m_lastBuilds = 0;
+    mutable unsigned m_lastAnimatedTiles = 0;
+
+    // Prerendered chunks, keyed like chunk cache entries
+    mutable std::size_t m_textureBudget = DEFAULT_TEXTURE_CACHE_BYTES;
+    mutable std::list<ChunkTexture> m_textureLru; // Most recently used first
+    mutable std::unordered_map<std::uint64_t, TextureIterator> m_textureIndex;
+    mutable std::size_t m_textureBytes = 0;
+
+    sf::Shader m_shader;
+    bool m_shaderLoaded = false;
+    float m_animationTime = 0.0f;
+    std::vector<int> m_currentFrames; // Per tile ID, without the shader
+    std::uint64_t m_animationVersion = 0; // Bumped whenever m_currentFrames changes
+};
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef TILEMAPFILE_H
+#define TILEMAPFILE_H
+
+#include "TileSource.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// On-disk tile map, read through a memory mapping so opening costs the same for any
+// map size and the OS pages chunk data, and the index, in and out as the camera reads it.
+//
+// Layout (little-endian):
+//   header      "TMAP", uint32 version, uint32 width, uint32 height, uint32 chunk size, uint32 reserved
+//   chunk index chunksX * chunksY entries of { uint64 offset, uint32 uniform, uint32 tile }
+//   chunk data  CHUNK_TILES bytes per stored chunk
+// A chunk made of a single tile type (open sea, say) is marked uniform and stores no data.
+class TileMapFile : public TileSource {
+public:
+    TileMapFile() = default;
+    TileMapFile(const TileMapFile&) = delete;
+    TileMapFile& operator=(const TileMapFile&) = delete;
+    ~TileMapFile() override { close(); }
+
+    bool open(const std::string& filename) {
+        close();
+        if (!map(filename))
+            return false;
+
+        if (m_size < sizeof(Header)) {
+            std::cerr << "Tile map file too small: " << filename << std::endl;
+            close();
+            return false;
+        }
+        std::memcpy(&m_header, m_data, sizeof(Header));
+        if (std::memcmp(m_header.magic, "TMAP", 4) != 0 || m_header.version != 1 ||
+            m_header.chunkSize != CHUNK_SIZE || m_header.width == 0 || m_header.height == 0 ||
+            m_header.width > 1u << 20 || m_header.height > 1u << 20) {
+            std::cerr << "Not a supported tile map file: " << filename << std::endl;
+            close();
+            return false;
+        }
+
+        std::size_t chunks = static_cast<std::size_t>(getChunksX()) * getChunksY();
+        if (m_size < sizeof(Header) + chunks * sizeof(IndexEntry)) {
+            std::cerr << "Truncated tile map index: " << filename << std::endl;
+            close();
+            return false;
+        }
+        // Index entries are checked as chunkData() reads them, so that opening does not
+        // page in the whole index
+        m_index = reinterpret_cast<const IndexEntry*>(m_data + sizeof(Header));
+        m_reportedCorrupt = false;
+
+        m_uniformChunks.resize(256 * CHUNK_TILES);
+        for (int tile = 0; tile < 256; ++tile)
+            std::fill_n(&m_uniformChunks[tile * CHUNK_TILES], CHUNK_TILES, static_cast<TileId>(tile));
+        return true;
+    }
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    int getWidth() const override { return static_cast<int>(m_header.width); }
+    int getHeight() const override { return static_cast<int>(m_header.height); }
+
+    // A stored chunk whose data would lie outside the file reads as tile 0, and is
+    // reported the first time
+    const TileId* chunkData(int cx, int cy) const override {
+        const IndexEntry& entry = m_index[static_cast<std::size_t>(cy) * getChunksX() + cx];
+        if (entry.uniform)
+            return &m_uniformChunks[(entry.tile & 0xff) * CHUNK_TILES];
+        if (entry.offset > m_size || m_size - entry.offset < CHUNK_TILES) {
+            if (!m_reportedCorrupt.exchange(true))
+                std::cerr << "Corrupt tile map index at chunk " << cx << ", " << cy << std::endl;
+            return &m_uniformChunks[0];
+        }
+        return reinterpret_cast<const TileId*>(m_data + entry.offset);
+    }
+
+    // Writes any tile source out in this format, one chunk at a time
+    static bool write(const std::string& filename, const TileSource& source) {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open tile map file for writing: " << filename << std::endl;
+            return false;
+        }
+
+        Header header{};
+        std::memcpy(header.magic, "TMAP", 4);
+        header.version = 1;
+        header.width = static_cast<std::uint32_t>(source.getWidth());
+        header.height = static_cast<std::uint32_t>(source.getHeight());
+        header.chunkSize = CHUNK_SIZE;
+
+        std::size_t chunks = static_cast<std::size_t>(source.getChunksX()) * source.getChunksY();
+        std::vector<IndexEntry> index(chunks);
+        std::uint64_t offset = sizeof(Header) + chunks * sizeof(IndexEntry);
+        for (int cy = 0; cy < source.getChunksY(); ++cy) {
+            for (int cx = 0; cx < source.getChunksX(); ++cx) {
+                const TileId* tiles = source.chunkData(cx, cy);
+                IndexEntry& entry = index[static_cast<std::size_t>(cy) * source.getChunksX() + cx];
+                bool uniform = std::all_of(tiles, tiles + CHUNK_TILES, [&](TileId id) { return id == tiles[0]; });
+                entry.uniform = uniform ? 1 : 0;
+                entry.tile = tiles[0];
+                entry.offset = uniform ? 0 : offset;
+                if (!uniform)
+                    offset += CHUNK_TILES;
+            }
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(chunks * sizeof(IndexEntry)));
+        for (std::size_t i = 0; i < chunks; ++i) {
+            if (!index[i].uniform) {
+                const TileId* tiles = source.chunkData(static_cast<int>(i % source.getChunksX()),
+                                                       static_cast<int>(i / source.getChunksX()));
+                file.write(reinterpret_cast<const char*>(tiles), CHUNK_TILES);
+            }
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t chunkSize;
+        std::uint32_t reserved; // Keeps the index 8-byte aligned
+    };
+    struct IndexEntry {
+        std::uint64_t offset;
+        std::uint32_t uniform;
+        std::uint32_t tile;
+    };
+    static_assert(sizeof(Header) == 24 && sizeof(IndexEntry) == 16, "tile map file layout");
+
+#ifdef _WIN32
+    bool map(const std::string& filename) {
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            std::cerr << "Failed to open tile map file: " << filename << std::endl;
+            return false;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(m_file, &size);
+        m_size = static_cast<std::size_t>(size.QuadPart);
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping != nullptr)
+            m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr) {
+            std::cerr << "Failed to map tile map file: " << filename << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+        m_index = nullptr;
+        m_size = 0;
+    }
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    bool map(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Failed to open tile map file: " << filename << std::endl;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            std::cerr << "Failed to read tile map file: " << filename << std::endl;
+            return false;
+        }
+        m_size = static_cast<std::size_t>(info.st_size);
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // The mapping keeps the file alive
+        if (data == MAP_FAILED) {
+            std::cerr << "Failed to map tile map file: " << filename << std::endl;
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const char*>(data);
+        return true;
+    }
+
+    void close() {
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_index = nullptr;
+        m_size = 0;
+    }
+#endif
+
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    Header m_header{};
+    const IndexEntry* m_index = nullptr;
+    std::vector<TileId> m_uniformChunks; // A CHUNK_TILES block of each tile type, for uniform chunks
+    mutable std::atomic<bool> m_reportedCorrupt{false};
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TILESOURCE_H
+#define TILESOURCE_H
+
+#include <cstdint>
+
+// Tiles per chunk side. Chunks are the unit of storage, generation and rendering.
+const int CHUNK_SIZE = 32;
+const int CHUNK_TILES = CHUNK_SIZE * CHUNK_SIZE;
+
+// A tile is just its type, which indexes the TileFactory's flyweights when drawn
+typedef std::uint8_t TileId;
+
+// Where a TileMap reads its tiles from: an in-memory TileGrid or a memory-mapped TileMapFile.
+// Tiles are handed out a chunk at a time, CHUNK_TILES IDs row by row.
+class TileSource {
+public:
+    virtual ~TileSource() = default;
+
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+    virtual const TileId* chunkData(int cx, int cy) const = 0;
+
+    int getChunksX() const { return (getWidth() + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+    int getChunksY() const { return (getHeight() + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+    TileId getTile(int x, int y) const {
+        return chunkData(x / CHUNK_SIZE, y / CHUNK_SIZE)[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+    }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef WALKABILITYGRID_H
+#define WALKABILITYGRID_H
+
+#include "ThreadPool.h"
+#include "TileGrid.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One bit per tile saying whether it can be walked on, derived from tile types. Rows
+// are packed into 64-bit words, so a 4096 x 4096 map takes 2 MB and a row of 64
+// tiles is tested with a single load.
+class WalkabilityGrid {
+public:
+    // Which tile IDs can be walked on
+    typedef std::array<bool, 256> WalkableTypes;
+
+    WalkabilityGrid(int width, int height)
+        : m_width(width), m_height(height), m_wordsPerRow((width + 63) / 64),
+          m_bits(static_cast<std::size_t>(m_wordsPerRow) * height, 0) {}
+
+    // Fills the grid from a tile grid, one row of chunks per work item so that no two
+    // threads write the same word. Takes a TileGrid rather than any TileSource because
+    // workers read chunks concurrently, and a generated source such as TerrainSource
+    // shares one scratch chunk between calls.
+    void build(const TileGrid& tiles, const WalkableTypes& walkable, ThreadPool& pool) {
+        int chunksX = tiles.getChunksX();
+        pool.parallelFor(static_cast<std::size_t>(tiles.getChunksY()), [&](std::size_t row) {
+            int cy = static_cast<int>(row);
+            int endY = std::min(m_height, (cy + 1) * CHUNK_SIZE);
+            for (int y = cy * CHUNK_SIZE; y < endY; ++y)
+                std::fill_n(&m_bits[static_cast<std::size_t>(y) * m_wordsPerRow], m_wordsPerRow, 0);
+            for (int cx = 0; cx < chunksX; ++cx) {
+                const TileId* chunk = tiles.chunkData(cx, cy);
+                int endX = std::min(m_width, (cx + 1) * CHUNK_SIZE);
+                for (int y = cy * CHUNK_SIZE; y < endY; ++y)
+                    for (int x = cx * CHUNK_SIZE; x < endX; ++x)
+                        if (walkable[chunk[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE]])
+                            m_bits[static_cast<std::size_t>(y) * m_wordsPerRow + x / 64] |= std::uint64_t(1) << (x % 64);
+            }
+        });
+    }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    // Tiles outside the map are not walkable
+    bool isWalkable(int x, int y) const {
+        if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+            return false;
+        return (m_bits[static_cast<std::size_t>(y) * m_wordsPerRow + x / 64] >> (x % 64)) & 1;
+    }
+
+    void setWalkable(int x, int y, bool walkable) {
+        std::uint64_t& word = m_bits[static_cast<std::size_t>(y) * m_wordsPerRow + x / 64];
+        std::uint64_t bit = std::uint64_t(1) << (x % 64);
+        word = walkable ? word | bit : word & ~bit;
+    }
+
+    std::size_t memoryBytes() const { return m_bits.capacity() * sizeof(std::uint64_t); }
+
+private:
+    int m_width;
+    int m_height;
+    int m_wordsPerRow;
+    std::vector<std::uint64_t> m_bits;
+};
+
+#endif
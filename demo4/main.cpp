@@ -1,33 +1,219 @@
 #include <SFML/Graphics.hpp>
-#include "Tile.h"
+#include "AutoTiler.h"
+#include "Camera.h"
+#include "PathFinder.h"
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+#include "TileArt.h"
 #include "TileFactory.h"
+#include "TileGrid.h"
+#include "TileMap.h"
+#include "TileMapFile.h"
+#include "WalkabilityGrid.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
-int main() {
+// Usage: demo4 [map.tmap] [--seed N] [--procedural size] [--cache-mb N] [--texture-cache-mb N] [--cpu-animation]
+//        demo4 --write map.tmap [size] [--seed N]
+// Without a map file a 4096 x 4096 terrain is generated in memory from the seed and
+// autotiled; clicking then paints water (left), wall (right) or grass (middle).
+// Ctrl+left click sets the start of a path over grass and Ctrl+right click its goal;
+// the path is found again after every edit.
+// --procedural generates chunks on demand instead, so the map can be any size.
+// --texture-cache-mb bounds the GPU memory for prerendered chunks, 0 turns them off.
+// --cpu-animation animates tiles by rewriting texture coordinates instead of in a shader.
+int main(int argc, char* argv[]) {
+    std::string mapFile;
+    std::string writeFile;
+    int mapSize = 4096;
+    bool procedural = false;
+    bool cpuAnimation = false;
+    std::uint32_t seed = 1;
+    std::size_t cacheBytes = DEFAULT_CACHE_BYTES;
+    std::size_t textureCacheBytes = DEFAULT_TEXTURE_CACHE_BYTES;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--write" && i + 1 < argc) {
+            writeFile = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                mapSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--procedural" && i + 1 < argc) {
+            procedural = true;
+            mapSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--cpu-animation") {
+            cpuAnimation = true;
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cacheBytes = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i]))) * 1024 * 1024;
+        } else if (arg == "--texture-cache-mb" && i + 1 < argc) {
+            textureCacheBytes = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i]))) * 1024 * 1024;
+        } else if (arg[0] != '-') {
+            mapFile = arg;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [map.tmap] [--seed N] [--procedural size] [--cache-mb N]"
+                      << " [--texture-cache-mb N] [--cpu-animation]"
+                      << " | --write map.tmap [size] [--seed N]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Terrain is generated one chunk per work item across all cores
+    TerrainGenerator generator(seed);
+    ThreadPool pool;
+    auto generate = [&](int size) {
+        auto grid = std::make_unique<TileGrid>(size, size);
+        sf::Clock clock;
+        generator.generate(*grid, pool);
+        std::cout << "Generated " << size << " x " << size << " tiles on " << pool.getThreadCount()
+                  << " threads in " << clock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+        return grid;
+    };
+
+    if (!writeFile.empty()) {
+        std::unique_ptr<TileGrid> grid = generate(mapSize);
+        if (!TileMapFile::write(writeFile, *grid))
+            return -1;
+        std::cout << "Wrote " << mapSize << " x " << mapSize << " tile map to " << writeFile << std::endl;
+        return 0;
+    }
+
+    // Tiles come from a memory-mapped file, a grid generated up front, or the generator itself
+    std::unique_ptr<TileSource> source;
+    std::unique_ptr<TileGrid> terrain;
+    if (!mapFile.empty()) {
+        auto file = std::make_unique<TileMapFile>();
+        if (!file->open(mapFile))
+            return -1;
+        source = std::move(file);
+    } else if (procedural) {
+        source = std::make_unique<TerrainSource>(mapSize, mapSize, seed);
+    } else {
+        terrain = generate(mapSize);
+    }
+
     // Set up the SFML window
     sf::RenderWindow window(sf::VideoMode(800, 600), "Flyweight Pattern Example");
 
-    // Load the sprite sheet texture
-    sf::Texture tileTexture;
-    if (!tileTexture.loadFromFile("resources/tiles.png")) {
+    // Cut the tiles out of the sprite sheet and pack them into the atlas. The sheet's
+    // 32x32 tiles are, left to right, grass, water, tree and wall. Water and trees are
+    // animated with frames derived from their still images.
+    TileFactory tileFactory;
+    int sheet = tileFactory.addSheet("resources/tiles.png");
+    if (sheet < 0) {
+        return -1;
+    }
+    int water = tileFactory.addSheet(scrollingFrames(tileFactory.getSheet(sheet), sf::IntRect(32, 0, 32, 32), 8));
+    int trees = tileFactory.addSheet(swayingFrames(tileFactory.getSheet(sheet), sf::IntRect(64, 0, 32, 32), 8, 2.0f));
+    tileFactory.addTile(sheet, sf::IntRect(0, 0, 32, 32));                     // 0 = grass
+    tileFactory.addAnimatedTile(water, sf::IntRect(0, 0, 32, 32), 8, 0.15f);   // 1 = water
+    tileFactory.addTile(sheet, sf::IntRect(96, 0, 32, 32));                    // 2 = wall
+    tileFactory.addAnimatedTile(trees, sf::IntRect(0, 0, 32, 32), 8, 0.2f);    // 3 = tree
+
+    // Autotile variants of water (sandy shores) and walls (dark edges), one per neighbor mask
+    int shores = tileFactory.addSheet(
+            borderVariants(tileFactory.getSheet(water), sf::IntRect(0, 0, 32, 32), 8, sf::Color(194, 178, 128), 6));
+    int wallEdges = tileFactory.addSheet(
+            borderVariants(tileFactory.getSheet(sheet), sf::IntRect(96, 0, 32, 32), 1, sf::Color(40, 40, 40), 4));
+    TileId firstShore = 0;
+    TileId firstWallEdge = 0;
+    for (int mask = 0; mask < AUTOTILE_VARIANTS; ++mask) {
+        int shore = tileFactory.addAnimatedTile(shores, sf::IntRect(0, mask * 32, 32, 32), 8, 0.15f);
+        firstShore = mask == 0 ? static_cast<TileId>(shore) : firstShore;
+    }
+    for (int mask = 0; mask < AUTOTILE_VARIANTS; ++mask) {
+        int wallEdge = tileFactory.addTile(wallEdges, sf::IntRect(0, mask * 32, 32, 32));
+        firstWallEdge = mask == 0 ? static_cast<TileId>(wallEdge) : firstWallEdge;
+    }
+    if (!tileFactory.build()) {
         return -1;
     }
 
-    // Create the TileFactory
-    TileFactory tileFactory(tileTexture);
+    // A map held in memory is autotiled, and can be edited with the mouse
+    AutoTiler* autoTiler = nullptr;
+    if (terrain) {
+        auto tiler = std::make_unique<AutoTiler>(*terrain);
+        tiler->setVariants(TILE_WATER, firstShore);
+        tiler->setVariants(TILE_WALL, firstWallEdge);
+        sf::Clock clock;
+        tiler->build(pool);
+        std::cout << "Autotiled in " << clock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+        autoTiler = tiler.get();
+        source = std::move(tiler);
+    }
+    std::vector<std::pair<int, int>> changedChunks;
+
+    // Paths over the grass of a map held in memory, kept up to date as it is edited
+    std::unique_ptr<WalkabilityGrid> walkability;
+    std::unique_ptr<PathFinder> pathFinder;
+    if (terrain) {
+        WalkabilityGrid::WalkableTypes walkable{};
+        walkable[TILE_GRASS] = true;
+        sf::Clock clock;
+        walkability = std::make_unique<WalkabilityGrid>(terrain->getWidth(), terrain->getHeight());
+        walkability->build(*terrain, walkable, pool);
+        pathFinder = std::make_unique<PathFinder>(*walkability);
+        pathFinder->build(pool);
+        std::cout << "Path graph built in " << clock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+    }
+    TilePoint pathStart{-1, -1};
+    TilePoint pathGoal{-1, -1};
+    int pathLength = -1;
+    sf::Int64 pathMicroseconds = 0;
+    sf::VertexArray pathLine(sf::LineStrip);
+    auto pathStats = [&]() -> std::string {
+        if (!pathFinder)
+            return "";
+        if (pathStart.x < 0 || pathGoal.x < 0)
+            return "\nPath: Ctrl+click to set start and goal";
+        if (pathLength < 0)
+            return "\nPath: unreachable";
+        return "\nPath: " + std::to_string(pathLength) + " moves, found in " + std::to_string(pathMicroseconds) + " us";
+    };
+    auto findPath = [&] {
+        pathLine.clear();
+        if (pathStart.x < 0 || pathGoal.x < 0)
+            return;
+        std::vector<TilePoint> waypoints;
+        sf::Clock clock;
+        pathLength = pathFinder->findPath(pathStart, pathGoal, &waypoints);
+        pathMicroseconds = clock.getElapsedTime().asMicroseconds();
+        for (const TilePoint& tile : pathFinder->refine(waypoints))
+            pathLine.append(sf::Vertex(sf::Vector2f((tile.x + 0.5f) * TILE_SIZE, (tile.y + 0.5f) * TILE_SIZE),
+                                       sf::Color::Red));
+    };
 
-    // Set up a grid of tiles
-    const int rows = 10;
-    const int cols = 10;
-    std::vector<Tile> tiles;
+    // Chunks are built as they come into view and kept within the cache budget
+    TileMap tileMap(tileFactory, *source, cacheBytes);
+    tileMap.buildLevelOfDetail();
+    tileMap.setTextureCacheBudget(textureCacheBytes);
+    if (cpuAnimation) {
+        tileMap.setAnimationShader(false);
+    }
 
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            // Randomly choose a tile type (0 = grass, 1 = water, 2 = wall, 3 = tree)
-            int tileType = rand() % 4;
-            tiles.emplace_back(tileFactory.getTile(tileType), sf::Vector2f(x * 64, y * 64));
-        }
+    // Scrolling, zooming camera over the whole map
+    Camera camera(sf::Vector2f(800, 600), sf::FloatRect(0, 0, static_cast<float>(source->getWidth()) * TILE_SIZE,
+                                                        static_cast<float>(source->getHeight()) * TILE_SIZE));
+
+    // Overlay with draw calls, frame time and cache usage
+    sf::Font font;
+    if (!font.loadFromFile("arial.ttf")) {
+        std::cerr << "Failed to load font!" << std::endl;
     }
+    sf::Text stats;
+    stats.setFont(font);
+    stats.setCharacterSize(14);
+    stats.setFillColor(sf::Color::White);
+    stats.setPosition(10, 10);
+
+    sf::Clock frameClock;
+    sf::Clock animationClock;
 
     // Main game loop
     while (window.isOpen()) {
@@ -35,17 +221,69 @@ int main() {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            camera.handleEvent(event, window);
+
+            // Left click paints water, right click wall, middle click grass; with Ctrl held,
+            // left and right click set the path's start and goal instead
+            if (autoTiler && event.type == sf::Event::MouseButtonPressed) {
+                sf::Vector2f world = window.mapPixelToCoords(sf::Vector2i(event.mouseButton.x, event.mouseButton.y),
+                                                             camera.getView());
+                int x = static_cast<int>(std::floor(world.x / TILE_SIZE));
+                int y = static_cast<int>(std::floor(world.y / TILE_SIZE));
+                bool control = sf::Keyboard::isKeyPressed(sf::Keyboard::LControl) ||
+                               sf::Keyboard::isKeyPressed(sf::Keyboard::RControl);
+                if (x >= 0 && y >= 0 && x < autoTiler->getWidth() && y < autoTiler->getHeight()) {
+                    if (control) {
+                        if (event.mouseButton.button == sf::Mouse::Left)
+                            pathStart = TilePoint{x, y};
+                        else if (event.mouseButton.button == sf::Mouse::Right)
+                            pathGoal = TilePoint{x, y};
+                        findPath();
+                    } else {
+                        TileId type = event.mouseButton.button == sf::Mouse::Left    ? TILE_WATER
+                                      : event.mouseButton.button == sf::Mouse::Right ? TILE_WALL
+                                                                                     : TILE_GRASS;
+                        changedChunks.clear();
+                        autoTiler->setTerrain(x, y, type, changedChunks);
+                        for (const auto& [cx, cy] : changedChunks)
+                            tileMap.invalidateChunk(cx, cy);
+                        if (walkability->isWalkable(x, y) != (type == TILE_GRASS)) {
+                            walkability->setWalkable(x, y, type == TILE_GRASS);
+                            pathFinder->update({TilePoint{x, y}}, pool);
+                            findPath();
+                        }
+                    }
+                }
+            }
         }
 
+        float frameSeconds = frameClock.restart().asSeconds();
+        float frameMs = frameSeconds * 1000.0f;
+        camera.update(frameSeconds);
+        tileMap.setAnimationTime(animationClock.getElapsedTime().asSeconds());
+
         window.clear();
 
-        // Draw all tiles
-        for (const auto& tile : tiles) {
-            window.draw(tile);
-        }
+        // Draw the visible part of the map through the camera, then the overlay in screen space
+        window.setView(camera.getView());
+        window.draw(tileMap);
+        window.draw(pathLine);
+        window.setView(window.getDefaultView());
+
+        stats.setString("Draw calls: " + std::to_string(tileMap.getLastDrawCalls()) +
+                        "\nFrame: " + std::to_string(frameMs) + " ms" +
+                        "\nZoom: " + std::to_string(camera.getZoom()) +
+                        "\nCached: " + std::to_string(tileMap.getCachedCount()) + " (" +
+                        std::to_string(tileMap.getCacheBytes() / (1024 * 1024)) + " MB), built " +
+                        std::to_string(tileMap.getLastBuilds()) + " this frame" +
+                        "\nPrerendered: " + std::to_string(tileMap.getTextureCount()) + " chunks (" +
+                        std::to_string(tileMap.getTextureBytes() / (1024 * 1024)) + " MB)" +
+                        "\nAnimated: " + std::to_string(tileMap.getLastAnimatedTiles()) + " tiles (" +
+                        (tileMap.usesAnimationShader() ? "shader" : "CPU") + ")" + pathStats());
+        window.draw(stats);
 
         window.display();
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+// tilemap_membench: memory per tile of the old Tile-per-sprite map vs the TileGrid.
+//
+// Usage: tilemap_membench [map side in tiles, default 8192]
+//
+// A Tile owns a full sf::Sprite, which allocates nothing on the heap, so its cost is
+// exactly sizeof(Tile) per element of the vector. A smaller Tile map is built to time
+// it; the full-size TileGrid is actually allocated and filled.
+
+#include <SFML/Graphics.hpp>
+#include "Tile.h"
+#include "TileFactory.h"
+#include "TileGrid.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const int side = argc > 1 ? std::atoi(argv[1]) : 8192;
+    const double tiles = static_cast<double>(side) * side;
+    const double mb = 1024.0 * 1024.0;
+
+    // No sheets: every ID maps to the factory's placeholder tile. Sprites only keep a
+    // pointer to the atlas page, so their size does not depend on what is loaded.
+    TileFactory factory;
+    factory.build();
+
+    // Old representation, built at a size that fits comfortably in memory
+    const int sampleSide = 512;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Tile> sprites;
+    sprites.reserve(static_cast<std::size_t>(sampleSide) * sampleSide);
+    for (int y = 0; y < sampleSide; ++y)
+        for (int x = 0; x < sampleSide; ++x)
+            sprites.emplace_back(factory.getTile(rand() % 4), sf::Vector2f(x * 64.0f, y * 64.0f));
+    double spriteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double spriteBytesPerTile = static_cast<double>(sprites.capacity() * sizeof(Tile)) / sprites.size();
+
+    // New representation at full size
+    start = std::chrono::steady_clock::now();
+    TileGrid grid(side, side);
+    for (int y = 0; y < side; ++y)
+        for (int x = 0; x < side; ++x)
+            grid.set(x, y, static_cast<TileId>(rand() % 4));
+    double gridSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double gridBytesPerTile = static_cast<double>(grid.memoryBytes()) / tiles;
+
+    std::cout << "Map: " << side << " x " << side << " = " << static_cast<long long>(tiles) << " tiles\n\n";
+    std::cout << "std::vector<Tile> (sf::Sprite per tile)\n"
+              << "  bytes per tile:   " << spriteBytesPerTile << "\n"
+              << "  full map:         " << spriteBytesPerTile * tiles / mb << " MB (extrapolated)\n"
+              << "  build time:       " << spriteSeconds * tiles / (double(sampleSide) * sampleSide)
+              << " s (extrapolated from " << sampleSide << " x " << sampleSide << ")\n\n";
+    std::cout << "TileGrid (uint8_t tile IDs)\n"
+              << "  bytes per tile:   " << gridBytesPerTile << "\n"
+              << "  full map:         " << grid.memoryBytes() / mb << " MB\n"
+              << "  build time:       " << gridSeconds << " s\n\n";
+    std::cout << "Reduction: " << spriteBytesPerTile / gridBytesPerTile << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,247 @@
+// tilemap_pathbench: path queries per second with HPA* on a generated tile map,
+// checked against plain A* over every tile.
+//
+// Usage: tilemap_pathbench [--size N] [--queries N] [--reference N] [--edits N] [--seed N] [--threads N]
+//
+// Grass is walkable; water, walls and trees are not. Start and goal pairs are random
+// walkable tiles anywhere on the map, so most queries cross it. The first --reference
+// pairs are also solved with tile-level A* to measure the speedup and how much longer
+// the hierarchical paths are. Then --edits random tiles are flipped between walkable
+// and not, each followed by PathFinder::update(), and the reference pairs are checked
+// again against tile-level A* on the edited map.
+
+#include "PathFinder.h"
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+#include "TileGrid.h"
+#include "WalkabilityGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<std::size_t>(p / 100.0 * (values.size() - 1) + 0.5))];
+}
+
+// Tile-level A* with 4-connected moves, for reference. Returns the path length or -1.
+class FlatAStar {
+public:
+    explicit FlatAStar(const WalkabilityGrid& grid)
+        : m_grid(grid), m_cost(static_cast<std::size_t>(grid.getWidth()) * grid.getHeight(), UNVISITED) {}
+
+    int findPath(TilePoint start, TilePoint goal) {
+        for (std::uint32_t cell : m_touched)
+            m_cost[cell] = UNVISITED;
+        m_touched.clear();
+        m_open.clear();
+
+        int width = m_grid.getWidth();
+        auto push = [&](int x, int y, std::uint32_t cost) {
+            std::uint32_t cell = static_cast<std::uint32_t>(y * width + x);
+            if (m_cost[cell] <= cost)
+                return;
+            if (m_cost[cell] == UNVISITED)
+                m_touched.push_back(cell);
+            m_cost[cell] = cost;
+            std::uint32_t heuristic = static_cast<std::uint32_t>(std::abs(x - goal.x) + std::abs(y - goal.y));
+            m_open.push_back(Entry{cost + heuristic, cost, cell});
+            std::push_heap(m_open.begin(), m_open.end(), std::greater<Entry>());
+        };
+
+        push(start.x, start.y, 0);
+        while (!m_open.empty()) {
+            std::pop_heap(m_open.begin(), m_open.end(), std::greater<Entry>());
+            Entry entry = m_open.back();
+            m_open.pop_back();
+            if (entry.cost != m_cost[entry.cell])
+                continue;
+            int x = static_cast<int>(entry.cell % width), y = static_cast<int>(entry.cell / width);
+            if (x == goal.x && y == goal.y)
+                return static_cast<int>(entry.cost);
+            const int neighbors[4][2] = {{x, y - 1}, {x + 1, y}, {x, y + 1}, {x - 1, y}};
+            for (const auto& n : neighbors)
+                if (m_grid.isWalkable(n[0], n[1]))
+                    push(n[0], n[1], entry.cost + 1);
+        }
+        return -1;
+    }
+
+private:
+    static constexpr std::uint32_t UNVISITED = 0xffffffffu;
+
+    struct Entry {
+        std::uint32_t priority;
+        std::uint32_t cost;
+        std::uint32_t cell;
+
+        bool operator>(const Entry& other) const { return priority > other.priority; }
+    };
+
+    const WalkabilityGrid& m_grid;
+    std::vector<std::uint32_t> m_cost;
+    std::vector<std::uint32_t> m_touched;
+    std::vector<Entry> m_open;
+};
+
+// Solves the first count pairs with tile-level A* and reports how much longer the HPA*
+// lengths are
+void compare(FlatAStar& flat, const std::vector<std::pair<TilePoint, TilePoint>>& pairs,
+             const std::vector<int>& lengths, int count) {
+    int compared = 0;
+    double extra = 0.0, worst = 0.0;
+    int mismatched = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < count; ++i) {
+        int optimal = flat.findPath(pairs[i].first, pairs[i].second);
+        if ((optimal < 0) != (lengths[i] < 0)) {
+            ++mismatched;
+        } else if (optimal > 0) {
+            double ratio = static_cast<double>(lengths[i]) / optimal - 1.0;
+            extra += ratio;
+            worst = std::max(worst, ratio);
+            ++compared;
+        }
+    }
+    double totalMs = elapsedMs(start);
+    std::cout << "Tile A* reference: " << count << " queries, " << count / (totalMs / 1000.0) << " queries/s\n";
+    std::cout << "HPA* path length vs optimal: +" << (compared ? 100.0 * extra / compared : 0.0) << "% mean, +"
+              << 100.0 * worst << "% worst";
+    if (mismatched)
+        std::cout << ", " << mismatched << " reachability mismatches";
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int size = 4096;
+    int queries = 10000;
+    int reference = 20;
+    int edits = 100;
+    std::uint32_t seed = 1;
+    unsigned threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            size = std::max(CLUSTER_SIZE, std::atoi(argv[++i]));
+        } else if (arg == "--queries" && hasValue) {
+            queries = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reference" && hasValue) {
+            reference = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--edits" && hasValue) {
+            edits = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--size N] [--queries N] [--reference N] [--edits N] [--seed N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    std::cout << std::fixed << std::setprecision(2);
+
+    auto start = Clock::now();
+    TileGrid terrain(size, size);
+    TerrainGenerator(seed).generate(terrain, pool);
+    std::cout << "Generated " << size << " x " << size << " map in " << elapsedMs(start) << " ms on "
+              << pool.getThreadCount() << " threads\n";
+
+    WalkabilityGrid::WalkableTypes walkable{};
+    walkable[TILE_GRASS] = true;
+    start = Clock::now();
+    WalkabilityGrid grid(size, size);
+    grid.build(terrain, walkable, pool);
+    std::cout << "Walkability layer: " << elapsedMs(start) << " ms, " << grid.memoryBytes() / 1024 << " KB\n";
+
+    start = Clock::now();
+    PathFinder finder(grid);
+    finder.build(pool);
+    std::cout << "HPA* graph: " << elapsedMs(start) << " ms, " << finder.getNodeCount() << " nodes, "
+              << finder.getEdgeCount() << " edges, " << finder.getPortalCount() << " portals in "
+              << finder.getRegionCount() << " regions\n";
+
+    // Random walkable start and goal pairs
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> coordinate(0, size - 1);
+    auto randomWalkable = [&] {
+        for (;;) {
+            TilePoint p{coordinate(generator), coordinate(generator)};
+            if (grid.isWalkable(p.x, p.y))
+                return p;
+        }
+    };
+    std::vector<std::pair<TilePoint, TilePoint>> pairs;
+    for (int i = 0; i < queries; ++i)
+        pairs.emplace_back(randomWalkable(), randomWalkable());
+
+    std::vector<int> lengths(pairs.size());
+    std::vector<double> microseconds;
+    int found = 0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        auto queryStart = Clock::now();
+        lengths[i] = finder.findPath(pairs[i].first, pairs[i].second);
+        microseconds.push_back(elapsedMs(queryStart) * 1000.0);
+        found += lengths[i] >= 0 ? 1 : 0;
+    }
+    double totalMs = elapsedMs(start);
+    std::cout << "HPA* queries: " << pairs.size() << " (" << found << " reachable), " << pairs.size() / (totalMs / 1000.0)
+              << " queries/s, p50 " << percentile(microseconds, 50) << " us, p99 " << percentile(microseconds, 99)
+              << " us\n";
+
+    // Same queries including expansion to every tile of the path
+    std::vector<TilePoint> waypoints;
+    std::size_t tiles = 0;
+    start = Clock::now();
+    for (const auto& pair : pairs) {
+        if (finder.findPath(pair.first, pair.second, &waypoints) >= 0)
+            tiles += finder.refine(waypoints).size();
+    }
+    totalMs = elapsedMs(start);
+    std::cout << "HPA* with refinement: " << pairs.size() / (totalMs / 1000.0) << " queries/s, "
+              << (found ? tiles / found : 0) << " tiles per path\n";
+
+    FlatAStar flat(grid);
+    if (reference > 0)
+        compare(flat, pairs, lengths, std::min(reference, queries));
+
+    if (edits > 0) {
+        // Flip random tiles, keeping the graph up to date after each
+        std::vector<double> editMs;
+        for (int i = 0; i < edits; ++i) {
+            TilePoint tile{coordinate(generator), coordinate(generator)};
+            grid.setWalkable(tile.x, tile.y, !grid.isWalkable(tile.x, tile.y));
+            auto editStart = Clock::now();
+            finder.update({tile}, pool);
+            editMs.push_back(elapsedMs(editStart));
+        }
+        std::cout << "Incremental updates: " << edits << " edits, p50 " << percentile(editMs, 50) << " ms, p99 "
+                  << percentile(editMs, 99) << " ms\n";
+        for (int i = 0; i < std::min(reference, queries); ++i)
+            lengths[i] = finder.findPath(pairs[i].first, pairs[i].second);
+        if (reference > 0) {
+            std::cout << "After the edits: ";
+            compare(flat, pairs, lengths, std::min(reference, queries));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,352 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Number of general purpose registers (r0 .. r15) available to a program
+constexpr std::size_t REGISTER_COUNT = 16;
+constexpr std::size_t MAX_OPERANDS = 4;
+
+enum class OpCode : std::uint8_t {
+    DRAW_RECTANGLE, // width height x y
+    DRAW_CIRCLE,    // radius x y
+    SET_COLOR,      // r g b
+    END,
+    LOAD,           // rD value          rD = value
+    ADD,            // rD a b            rD = a + b
+    SUB,            // rD a b            rD = a - b
+    MUL,            // rD a b            rD = a * b
+    DIV,            // rD a b            rD = a / b (0 when b == 0)
+    SIN,            // rD a              rD = sin(a)
+    COS,            // rD a              rD = cos(a)
+    LESS,           // rD a b            rD = a < b ? 1 : 0
+    FRAME_TIME,     // rD                rD = seconds since the program started
+    JUMP,           // target
+    JUMP_IF,        // a target          jump when a != 0
+    COUNT
+};
+
+constexpr std::size_t OPCODE_COUNT = static_cast<std::size_t>(OpCode::COUNT);
+
+struct OpCodeInfo {
+    const char* name;
+    std::uint8_t operandCount; // Value operands, not counting a jump target
+    bool writesRegister;       // Operand 0 is a destination register
+    bool hasJumpTarget;
+};
+
+inline const OpCodeInfo& opCodeInfo(OpCode opCode) {
+    static const std::array<OpCodeInfo, OPCODE_COUNT> table = {{
+        {"DRAW_RECTANGLE", 4, false, false},
+        {"DRAW_CIRCLE", 3, false, false},
+        {"SET_COLOR", 3, false, false},
+        {"END", 0, false, false},
+        {"LOAD", 2, true, false},
+        {"ADD", 3, true, false},
+        {"SUB", 3, true, false},
+        {"MUL", 3, true, false},
+        {"DIV", 3, true, false},
+        {"SIN", 2, true, false},
+        {"COS", 2, true, false},
+        {"LESS", 3, true, false},
+        {"FRAME_TIME", 1, true, false},
+        {"JUMP", 0, false, true},
+        {"JUMP_IF", 1, false, true},
+    }};
+    return table[static_cast<std::size_t>(opCode)];
+}
+
+inline bool parseOpCode(std::string_view name, OpCode& opCode) {
+    for (std::size_t i = 0; i < OPCODE_COUNT; ++i) {
+        if (name == opCodeInfo(static_cast<OpCode>(i)).name) {
+            opCode = static_cast<OpCode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fixed-size instruction so a program is one contiguous allocation.
+// Bit i of registerMask marks operands[i] as a register index instead of a literal.
+struct Instruction {
+    OpCode opCode = OpCode::END;
+    std::uint8_t operandCount = 0;
+    std::uint8_t registerMask = 0;
+    std::uint32_t jumpTarget = 0;
+    std::array<float, MAX_OPERANDS> operands{};
+
+    bool isRegister(std::size_t i) const { return (registerMask >> i) & 1u; }
+};
+
+// Parses "r3"/"R3" as register 3, returns false for anything else
+inline bool parseRegister(std::string_view token, std::size_t& index) {
+    if (token.size() < 2 || token.size() > 3 || (token[0] != 'r' && token[0] != 'R'))
+        return false;
+    std::size_t value = 0;
+    for (std::size_t i = 1; i < token.size(); ++i) {
+        if (token[i] < '0' || token[i] > '9')
+            return false;
+        value = value * 10 + static_cast<std::size_t>(token[i] - '0');
+    }
+    if (value >= REGISTER_COUNT)
+        return false;
+    index = value;
+    return true;
+}
+
+inline bool parseNumber(std::string_view token, float& value) {
+    // strtof needs a terminated string, tokens are short so copy onto the stack
+    char buffer[64];
+    if (token.empty() || token.size() >= sizeof(buffer))
+        return false;
+    token.copy(buffer, token.size());
+    buffer[token.size()] = '\0';
+    char* end = nullptr;
+    value = std::strtof(buffer, &end);
+    return end == buffer + token.size();
+}
+
+inline bool parseIndex(std::string_view token, std::uint32_t& value) {
+    if (token.empty() || token.size() > 9)
+        return false;
+    value = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + static_cast<std::uint32_t>(c - '0');
+    }
+    return true;
+}
+
+// Splits the next whitespace separated token off the front of line
+inline std::string_view nextToken(std::string_view& line) {
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    std::size_t begin = 0;
+    while (begin < line.size() && isSpace(line[begin]))
+        ++begin;
+    std::size_t end = begin;
+    while (end < line.size() && !isSpace(line[end]))
+        ++end;
+    std::string_view token = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return token;
+}
+
+enum class LineKind { Blank, Label, Instruction, Error };
+
+// Parses one line of the text format. For a Label, label is the label name. For an
+// Instruction whose jump target is a label rather than an index, label names it and
+// the caller resolves it once every label is known.
+inline LineKind parseLine(std::string_view line, Instruction& instruction, std::string_view& label,
+                          std::string& error) {
+    label = std::string_view();
+    std::string_view opCodeStr = nextToken(line);
+    if (opCodeStr.empty() || opCodeStr[0] == '#')
+        return LineKind::Blank;
+
+    if (opCodeStr.back() == ':') {
+        label = opCodeStr.substr(0, opCodeStr.size() - 1);
+        return LineKind::Label;
+    }
+
+    instruction = Instruction();
+    if (!parseOpCode(opCodeStr, instruction.opCode)) {
+        error = "Unknown OpCode in file: " + std::string(opCodeStr);
+        return LineKind::Error;
+    }
+    const OpCodeInfo& info = opCodeInfo(instruction.opCode);
+
+    // The original format allowed trailing operands, so only too few is an error
+    std::size_t expected = info.operandCount + (info.hasJumpTarget ? 1 : 0);
+    std::array<std::string_view, MAX_OPERANDS + 1> tokens;
+    for (std::size_t i = 0; i < expected; ++i) {
+        tokens[i] = nextToken(line);
+        if (tokens[i].empty()) {
+            error = std::string(info.name) + " expects " + std::to_string(expected) + " operands";
+            return LineKind::Error;
+        }
+    }
+
+    for (std::size_t i = 0; i < info.operandCount; ++i) {
+        std::size_t reg;
+        if (parseRegister(tokens[i], reg)) {
+            instruction.operands[i] = static_cast<float>(reg);
+            instruction.registerMask |= static_cast<std::uint8_t>(1u << i);
+        } else if (i == 0 && info.writesRegister) {
+            error = "destination must be a register, got " + std::string(tokens[i]);
+            return LineKind::Error;
+        } else if (!parseNumber(tokens[i], instruction.operands[i])) {
+            error = "bad operand " + std::string(tokens[i]);
+            return LineKind::Error;
+        }
+    }
+    instruction.operandCount = info.operandCount;
+
+    if (info.hasJumpTarget && !parseIndex(tokens[info.operandCount], instruction.jumpTarget))
+        label = tokens[info.operandCount];
+
+    return LineKind::Instruction;
+}
+
+// Patches jumps whose target was written as a label
+inline void resolveJumpLabels(std::vector<Instruction>& program,
+                              const std::unordered_map<std::string, std::uint32_t>& labels,
+                              const std::vector<std::pair<std::size_t, std::string>>& unresolvedJumps) {
+    for (const auto& [index, label] : unresolvedJumps) {
+        auto it = labels.find(label);
+        if (it == labels.end()) {
+            std::cerr << "Undefined jump label: " << label << std::endl;
+            // Jumping past the end terminates the program
+            program[index].jumpTarget = static_cast<std::uint32_t>(program.size());
+        } else {
+            program[index].jumpTarget = it->second;
+        }
+    }
+}
+
+// Text format: one instruction per line, "OPCODE operand...". Operands are numbers
+// or registers (r0..r15). "name:" on its own line defines a jump label, and JUMP /
+// JUMP_IF take a label or an instruction index as their last operand. Blank lines
+// and lines starting with '#' are ignored.
+inline std::vector<Instruction> loadProgramFromFile(const std::string& filename) {
+    std::vector<Instruction> program;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open bytecode file: " << filename << std::endl;
+        return program;
+    }
+
+    std::unordered_map<std::string, std::uint32_t> labels;
+    std::vector<std::pair<std::size_t, std::string>> unresolvedJumps;
+
+    std::string line;
+    std::string error;
+    std::size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        Instruction instruction;
+        std::string_view label;
+        switch (parseLine(line, instruction, label, error)) {
+            case LineKind::Blank:
+                break;
+            case LineKind::Label:
+                labels[std::string(label)] = static_cast<std::uint32_t>(program.size());
+                break;
+            case LineKind::Instruction:
+                if (!label.empty())
+                    unresolvedJumps.emplace_back(program.size(), std::string(label));
+                program.push_back(instruction);
+                break;
+            case LineKind::Error:
+                std::cerr << "Line " << lineNumber << ": " << error << std::endl;
+                break;
+        }
+    }
+
+    resolveJumpLabels(program, labels, unresolvedJumps);
+    return program;
+}
+
+// Writes a program back out in the text format, jump targets as instruction indices
+inline void writeProgramText(std::ostream& out, const std::vector<Instruction>& program) {
+    for (const auto& instruction : program) {
+        const OpCodeInfo& info = opCodeInfo(instruction.opCode);
+        out << info.name;
+        for (std::size_t i = 0; i < instruction.operandCount; ++i) {
+            if (instruction.isRegister(i))
+                out << " r" << static_cast<int>(instruction.operands[i]);
+            else
+                out << ' ' << instruction.operands[i];
+        }
+        if (info.hasJumpTarget)
+            out << ' ' << instruction.jumpTarget;
+        out << '\n';
+    }
+}
+
+// Binary format: "BCV1", a little-endian uint64 instruction count, then the Instruction
+// array as it sits in memory, so loading is a single read. Fields are checked on load
+// because a register index or opcode from the file is used to index arrays.
+constexpr char BINARY_MAGIC[4] = {'B', 'C', 'V', '1'};
+static_assert(sizeof(Instruction) == 24 && offsetof(Instruction, jumpTarget) == 4 &&
+                      offsetof(Instruction, operands) == 8,
+              "binary bytecode format relies on this Instruction layout");
+
+inline bool saveProgramBinary(const std::string& filename, const std::vector<Instruction>& program) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open bytecode file for writing: " << filename << std::endl;
+        return false;
+    }
+    std::uint64_t count = program.size();
+    file.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(program.data()), static_cast<std::streamsize>(count * sizeof(Instruction)));
+    return static_cast<bool>(file);
+}
+
+inline std::vector<Instruction> loadProgramBinary(const std::string& filename) {
+    std::vector<Instruction> program;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open bytecode file: " << filename << std::endl;
+        return program;
+    }
+
+    char magic[4];
+    std::uint64_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || !std::equal(magic, magic + 4, BINARY_MAGIC)) {
+        std::cerr << "Not a binary bytecode file: " << filename << std::endl;
+        return program;
+    }
+
+    // The header's count must fit in what is left of the file before it sizes anything
+    std::streampos start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::uint64_t remaining = static_cast<std::uint64_t>(file.tellg() - start);
+    file.seekg(start);
+    if (!file || count > remaining / sizeof(Instruction)) {
+        std::cerr << "Truncated binary bytecode file: " << filename << std::endl;
+        return program;
+    }
+
+    program.resize(count);
+    file.read(reinterpret_cast<char*>(program.data()), static_cast<std::streamsize>(count * sizeof(Instruction)));
+    if (!file) {
+        std::cerr << "Truncated binary bytecode file: " << filename << std::endl;
+        program.clear();
+        return program;
+    }
+
+    for (auto& instruction : program) {
+        bool valid = static_cast<std::size_t>(instruction.opCode) < OPCODE_COUNT &&
+                     instruction.operandCount <= MAX_OPERANDS;
+        for (std::size_t i = 0; valid && i < MAX_OPERANDS; ++i) {
+            if (instruction.isRegister(i) &&
+                !(instruction.operands[i] >= 0.0f && instruction.operands[i] < static_cast<float>(REGISTER_COUNT)))
+                valid = false;
+        }
+        if (valid && opCodeInfo(instruction.opCode).writesRegister && !instruction.isRegister(0))
+            valid = false;
+        if (!valid) {
+            std::cerr << "Corrupt instruction in binary bytecode file: " << filename << std::endl;
+            program.clear();
+            break;
+        }
+    }
+    return program;
+}
+
+#endif
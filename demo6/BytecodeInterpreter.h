@@ -0,0 +1,266 @@
+#ifndef BYTECODEINTERPRETER_H
+#define BYTECODEINTERPRETER_H
+
+#include <SFML/Graphics.hpp>
+#include "Bytecode.h"
+#include "ParallelLoader.h"
+#include "ProgramOptimizer.h"
+#include "Parallel.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Points used to approximate a circle, same as the sf::CircleShape default
+constexpr std::size_t CIRCLE_POINTS = 30;
+constexpr std::size_t CIRCLE_VERTICES = CIRCLE_POINTS * 3;
+constexpr std::size_t RECTANGLE_VERTICES = 6;
+
+struct FrameStats {
+    std::uint64_t instructionsExecuted = 0;
+    bool budgetExhausted = false;
+    bool reachedEnd = false;
+};
+
+class BytecodeInterpreter {
+public:
+    BytecodeInterpreter(const std::vector<Instruction>& program = {})
+            : program(program), animated(false), instructionBudget(10'000'000) {
+        for (const auto& instruction : program) {
+            if (instruction.opCode == OpCode::FRAME_TIME)
+                animated = true;
+        }
+        profile.fill(0);
+    }
+
+    // A program that never reads FRAME_TIME produces the same scene every frame,
+    // so the caller only needs to run it once
+    bool isAnimated() const { return animated; }
+
+    // Upper bound on instructions per run(), protects the frame from runaway loops
+    void setInstructionBudget(std::uint64_t budget) { instructionBudget = budget; }
+
+    // Replace the static prefix of the program (see staticPrefixLength) with an already
+    // resolved draw list. run() then resumes at resumeAt with the prefix's final color.
+    // Vertices are generated in parallel, each shape's slot is known from a prefix sum of vertex counts.
+    void setPrecompiledScene(const DrawCommand* commands, std::size_t count, std::size_t resumeAt,
+                             std::uint32_t color, unsigned threadCount = 1) {
+        std::vector<std::size_t> offsets(count + 1, 0);
+        for (std::size_t i = 0; i < count; ++i)
+            offsets[i + 1] = offsets[i] + vertexCount(commands[i]);
+        staticVertices.resize(offsets[count]);
+        parallelRanges(count, threadCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i)
+                writeCommand(&staticVertices[offsets[i]], commands[i]);
+        });
+        entryPoint = resumeAt;
+        entryColor = sf::Color(color);
+    }
+
+    // Resolve and optimize the static prefix once at load, instead of re-interpreting it every frame
+    OptimizationStats bakeStaticPrefix(const Bounds& screen, unsigned threadCount = 1) {
+        OptimizationStats stats;
+        std::size_t prefix = staticPrefixLength(program);
+        std::uint32_t color;
+        std::vector<DrawCommand> commands =
+                optimizeDrawList(decodeDrawListParallel(program, prefix, color, threadCount), screen, &stats);
+        setPrecompiledScene(commands.data(), commands.size(), prefix, color, threadCount);
+        return stats;
+    }
+
+    // Execute the program, rebuilding the dynamic part of the scene for this frame
+    FrameStats run(float frameTime) {
+        reset();
+        std::size_t pc = entryPoint;
+        return execute(program.data(), program.size(), pc, frameTime);
+    }
+
+    // Clears the registers, color and output for a fresh execution of the program
+    void reset() {
+        vertices.clear();
+        registers.fill(0.0f);
+        currentColor = entryColor;
+    }
+
+    // Executes code[pc, size) on top of the current registers, color and output, and
+    // leaves pc where execution stopped: at the instruction the budget ran out on, or at
+    // or past size. run() is built on this; streaming execution calls it once per window
+    // of a program.
+    FrameStats execute(const Instruction* code, std::size_t size, std::size_t& pc, float frameTime) {
+        FrameStats stats;
+        std::uint64_t executed = 0;
+
+        while (pc < size) {
+            if (executed == instructionBudget) {
+                stats.budgetExhausted = true;
+                break;
+            }
+            ++executed;
+
+            const Instruction& instruction = code[pc];
+            ++profile[static_cast<std::size_t>(instruction.opCode)];
+            ++pc;
+
+            switch (instruction.opCode) {
+                case OpCode::DRAW_RECTANGLE:
+                    writeRectangle(grow(RECTANGLE_VERTICES), operand(instruction, 0), operand(instruction, 1),
+                                   operand(instruction, 2), operand(instruction, 3), currentColor);
+                    break;
+                case OpCode::DRAW_CIRCLE:
+                    writeCircle(grow(CIRCLE_VERTICES), operand(instruction, 0), operand(instruction, 1),
+                                operand(instruction, 2), currentColor);
+                    break;
+                case OpCode::SET_COLOR:
+                    currentColor = sf::Color(toChannel(operand(instruction, 0)),
+                                             toChannel(operand(instruction, 1)),
+                                             toChannel(operand(instruction, 2)));
+                    break;
+                case OpCode::END:
+                    stats.reachedEnd = true;
+                    pc = size;
+                    break;
+                case OpCode::LOAD:
+                    destination(instruction) = operand(instruction, 1);
+                    break;
+                case OpCode::ADD:
+                    destination(instruction) = operand(instruction, 1) + operand(instruction, 2);
+                    break;
+                case OpCode::SUB:
+                    destination(instruction) = operand(instruction, 1) - operand(instruction, 2);
+                    break;
+                case OpCode::MUL:
+                    destination(instruction) = operand(instruction, 1) * operand(instruction, 2);
+                    break;
+                case OpCode::DIV: {
+                    float divisor = operand(instruction, 2);
+                    destination(instruction) = divisor != 0.0f ? operand(instruction, 1) / divisor : 0.0f;
+                    break;
+                }
+                case OpCode::SIN:
+                    destination(instruction) = std::sin(operand(instruction, 1));
+                    break;
+                case OpCode::COS:
+                    destination(instruction) = std::cos(operand(instruction, 1));
+                    break;
+                case OpCode::LESS:
+                    destination(instruction) = operand(instruction, 1) < operand(instruction, 2) ? 1.0f : 0.0f;
+                    break;
+                case OpCode::FRAME_TIME:
+                    destination(instruction) = frameTime;
+                    break;
+                case OpCode::JUMP:
+                    pc = instruction.jumpTarget;
+                    break;
+                case OpCode::JUMP_IF:
+                    if (operand(instruction, 0) != 0.0f)
+                        pc = instruction.jumpTarget;
+                    break;
+                default:
+                    std::cerr << "Unknown OpCode encountered!" << std::endl;
+                    pc = size;
+                    break;
+            }
+        }
+
+        stats.instructionsExecuted = executed;
+        return stats;
+    }
+
+    void render(sf::RenderTarget& target) const {
+        // The scene is at most two batched triangle lists: the baked prefix, then this frame's output
+        if (!staticVertices.empty())
+            target.draw(staticVertices.data(), staticVertices.size(), sf::Triangles);
+        if (!vertices.empty())
+            target.draw(vertices.data(), vertices.size(), sf::Triangles);
+    }
+
+    // Drops the current output once it has been drawn somewhere persistent
+    void clearOutput() { vertices.clear(); }
+
+    // Executions per opcode, accumulated over every run()
+    const std::array<std::uint64_t, OPCODE_COUNT>& getProfile() const { return profile; }
+
+    void printProfile(std::ostream& out) const {
+        out << "Opcode profile:\n";
+        for (std::size_t i = 0; i < OPCODE_COUNT; ++i) {
+            if (profile[i] != 0)
+                out << "  " << opCodeInfo(static_cast<OpCode>(i)).name << ": " << profile[i] << "\n";
+        }
+    }
+
+private:
+    float operand(const Instruction& instruction, std::size_t i) const {
+        float value = instruction.operands[i];
+        return instruction.isRegister(i) ? registers[static_cast<std::size_t>(value)] : value;
+    }
+
+    float& destination(const Instruction& instruction) {
+        return registers[static_cast<std::size_t>(instruction.operands[0])];
+    }
+
+    static sf::Uint8 toChannel(float value) {
+        return static_cast<sf::Uint8>(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value));
+    }
+
+    sf::Vertex* grow(std::size_t count) {
+        std::size_t size = vertices.size();
+        vertices.resize(size + count);
+        return &vertices[size];
+    }
+
+    static std::size_t vertexCount(const DrawCommand& command) {
+        return command.kind == DrawCommand::Rectangle ? RECTANGLE_VERTICES : CIRCLE_VERTICES;
+    }
+
+    static sf::Vertex* writeCommand(sf::Vertex* out, const DrawCommand& command) {
+        if (command.kind == DrawCommand::Rectangle)
+            return writeRectangle(out, command.a, command.b, command.c, command.d, sf::Color(command.color));
+        return writeCircle(out, command.a, command.b, command.c, sf::Color(command.color));
+    }
+
+    static sf::Vertex* writeRectangle(sf::Vertex* out, float width, float height, float x, float y,
+                                      sf::Color color) {
+        sf::Vector2f topLeft(x, y), topRight(x + width, y);
+        sf::Vector2f bottomLeft(x, y + height), bottomRight(x + width, y + height);
+        *out++ = sf::Vertex(topLeft, color);
+        *out++ = sf::Vertex(topRight, color);
+        *out++ = sf::Vertex(bottomRight, color);
+        *out++ = sf::Vertex(topLeft, color);
+        *out++ = sf::Vertex(bottomRight, color);
+        *out++ = sf::Vertex(bottomLeft, color);
+        return out;
+    }
+
+    static sf::Vertex* writeCircle(sf::Vertex* out, float radius, float x, float y, sf::Color color) {
+        static const std::array<sf::Vector2f, CIRCLE_POINTS + 1> unitCircle = [] {
+            std::array<sf::Vector2f, CIRCLE_POINTS + 1> points;
+            for (std::size_t i = 0; i <= CIRCLE_POINTS; ++i) {
+                float angle = static_cast<float>(i % CIRCLE_POINTS) * 2.0f * 3.14159265f / CIRCLE_POINTS;
+                points[i] = sf::Vector2f(std::cos(angle), std::sin(angle));
+            }
+            return points;
+        }();
+
+        // Position is the top-left of the bounding box, as with sf::CircleShape
+        sf::Vector2f center(x + radius, y + radius);
+        for (std::size_t i = 0; i < CIRCLE_POINTS; ++i) {
+            *out++ = sf::Vertex(center, color);
+            *out++ = sf::Vertex(center + unitCircle[i] * radius, color);
+            *out++ = sf::Vertex(center + unitCircle[i + 1] * radius, color);
+        }
+        return out;
+    }
+
+    std::vector<Instruction> program;
+    bool animated;
+    std::uint64_t instructionBudget;
+    std::array<float, REGISTER_COUNT> registers{};
+    sf::Color currentColor = sf::Color::White;
+    std::array<std::uint64_t, OPCODE_COUNT> profile;
+    std::vector<sf::Vertex> vertices;
+    std::vector<sf::Vertex> staticVertices;
+    std::size_t entryPoint = 0;
+    sf::Color entryColor = sf::Color::White;
+};
+
+#endif
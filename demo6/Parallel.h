@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+inline unsigned defaultThreadCount() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Splits [0, count) into one contiguous range per thread and calls
+// body(begin, end, rangeIndex) for each. Ranges are in order, so rangeIndex
+// can address per-range results that are combined afterwards.
+template <typename Body>
+void parallelRanges(std::size_t count, unsigned threadCount, Body body) {
+    std::size_t ranges = std::max<std::size_t>(1, std::min<std::size_t>(threadCount, count));
+    if (ranges == 1) {
+        body(std::size_t(0), count, std::size_t(0));
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(ranges - 1);
+    for (std::size_t r = 1; r < ranges; ++r) {
+        threads.emplace_back([=, &body] { body(count * r / ranges, count * (r + 1) / ranges, r); });
+    }
+    body(std::size_t(0), count / ranges, std::size_t(0));
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+#endif
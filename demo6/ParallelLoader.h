@@ -0,0 +1,170 @@
+#ifndef PARALLELLOADER_H
+#define PARALLELLOADER_H
+
+#include "Bytecode.h"
+#include "Parallel.h"
+#include "ProgramOptimizer.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Parses the text format on several threads. The text is split into one chunk per
+// thread at line boundaries; each chunk is parsed into its own instruction list with
+// chunk-local label and jump indices, which are rebased once the chunk sizes are known.
+inline std::vector<Instruction> parseProgramParallel(std::string_view text, unsigned threadCount) {
+    struct Chunk {
+        std::vector<Instruction> instructions;
+        std::vector<std::pair<std::string, std::size_t>> labels;
+        std::vector<std::pair<std::size_t, std::string>> jumps;
+        std::vector<std::pair<std::size_t, std::string>> errors; // Chunk-local line number
+        std::size_t lines = 0;
+    };
+
+    std::size_t chunkCount = std::max<std::size_t>(1, std::min<std::size_t>(threadCount, text.size() / 4096 + 1));
+    std::vector<std::size_t> boundaries(chunkCount + 1, text.size());
+    boundaries[0] = 0;
+    for (std::size_t i = 1; i < chunkCount; ++i) {
+        std::size_t newline = text.find('\n', std::max(text.size() * i / chunkCount, boundaries[i - 1]));
+        boundaries[i] = newline == std::string_view::npos ? text.size() : newline + 1;
+    }
+
+    std::vector<Chunk> chunks(chunkCount);
+    parallelRanges(chunkCount, threadCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t c = begin; c < end; ++c) {
+            Chunk& chunk = chunks[c];
+            std::string_view remaining = text.substr(boundaries[c], boundaries[c + 1] - boundaries[c]);
+            chunk.instructions.reserve(remaining.size() / 16);
+            std::string error;
+            while (!remaining.empty()) {
+                std::size_t newline = remaining.find('\n');
+                std::string_view line = remaining.substr(0, newline);
+                remaining.remove_prefix(newline == std::string_view::npos ? remaining.size() : newline + 1);
+                ++chunk.lines;
+
+                Instruction instruction;
+                std::string_view label;
+                switch (parseLine(line, instruction, label, error)) {
+                    case LineKind::Blank:
+                        break;
+                    case LineKind::Label:
+                        chunk.labels.emplace_back(std::string(label), chunk.instructions.size());
+                        break;
+                    case LineKind::Instruction:
+                        if (!label.empty())
+                            chunk.jumps.emplace_back(chunk.instructions.size(), std::string(label));
+                        chunk.instructions.push_back(instruction);
+                        break;
+                    case LineKind::Error:
+                        chunk.errors.emplace_back(chunk.lines, error);
+                        break;
+                }
+            }
+        }
+    });
+
+    std::vector<std::size_t> offsets(chunkCount + 1, 0);
+    for (std::size_t c = 0; c < chunkCount; ++c)
+        offsets[c + 1] = offsets[c] + chunks[c].instructions.size();
+
+    std::vector<Instruction> program(offsets[chunkCount]);
+    parallelRanges(chunkCount, threadCount, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::copy(chunks[c].instructions.begin(), chunks[c].instructions.end(), program.begin() + offsets[c]);
+            std::vector<Instruction>().swap(chunks[c].instructions);
+        }
+    });
+
+    std::unordered_map<std::string, std::uint32_t> labels;
+    std::vector<std::pair<std::size_t, std::string>> unresolvedJumps;
+    std::size_t firstLine = 1;
+    for (std::size_t c = 0; c < chunkCount; ++c) {
+        for (auto& [name, index] : chunks[c].labels)
+            labels[name] = static_cast<std::uint32_t>(offsets[c] + index);
+        for (auto& [index, name] : chunks[c].jumps)
+            unresolvedJumps.emplace_back(offsets[c] + index, std::move(name));
+        for (const auto& [line, error] : chunks[c].errors)
+            std::cerr << "Line " << firstLine + line - 1 << ": " << error << std::endl;
+        firstLine += chunks[c].lines;
+    }
+    resolveJumpLabels(program, labels, unresolvedJumps);
+    return program;
+}
+
+inline std::vector<Instruction> loadProgramParallel(const std::string& filename, unsigned threadCount) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open bytecode file: " << filename << std::endl;
+        return {};
+    }
+    std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+    return parseProgramParallel(text, threadCount);
+}
+
+// Parallel version of decodeDrawList. SET_COLOR is the only state carried between
+// instructions, so a first pass finds the last color each range sets and how many
+// shapes it draws; a prefix over those gives every range its starting color and
+// output slot, and the second pass fills the draw list in parallel.
+inline std::vector<DrawCommand> decodeDrawListParallel(const std::vector<Instruction>& program, std::size_t end,
+                                                       std::uint32_t& finalColor, unsigned threadCount) {
+    struct RangeSummary {
+        bool setsColor = false;
+        std::uint32_t lastColor = 0;
+        std::size_t shapes = 0;
+    };
+
+    std::size_t ranges = std::max<std::size_t>(1, std::min<std::size_t>(threadCount, end));
+    std::vector<RangeSummary> summaries(ranges);
+    parallelRanges(end, threadCount, [&](std::size_t begin, std::size_t rangeEnd, std::size_t r) {
+        RangeSummary& summary = summaries[r];
+        for (std::size_t i = begin; i < rangeEnd; ++i) {
+            const Instruction& instruction = program[i];
+            if (instruction.opCode == OpCode::SET_COLOR) {
+                summary.setsColor = true;
+                summary.lastColor = packColor(instruction.operands[0], instruction.operands[1], instruction.operands[2]);
+            } else if (instruction.opCode == OpCode::DRAW_RECTANGLE || instruction.opCode == OpCode::DRAW_CIRCLE) {
+                ++summary.shapes;
+            }
+        }
+    });
+
+    std::vector<std::uint32_t> startColors(ranges);
+    std::vector<std::size_t> offsets(ranges + 1, 0);
+    std::uint32_t color = DEFAULT_COLOR;
+    for (std::size_t r = 0; r < ranges; ++r) {
+        startColors[r] = color;
+        if (summaries[r].setsColor)
+            color = summaries[r].lastColor;
+        offsets[r + 1] = offsets[r] + summaries[r].shapes;
+    }
+    finalColor = color;
+
+    std::vector<DrawCommand> commands(offsets[ranges]);
+    parallelRanges(end, threadCount, [&](std::size_t begin, std::size_t rangeEnd, std::size_t r) {
+        std::uint32_t current = startColors[r];
+        DrawCommand* out = commands.data() + offsets[r];
+        for (std::size_t i = begin; i < rangeEnd; ++i) {
+            const Instruction& instruction = program[i];
+            const auto& op = instruction.operands;
+            switch (instruction.opCode) {
+                case OpCode::DRAW_RECTANGLE:
+                    *out++ = {DrawCommand::Rectangle, op[0], op[1], op[2], op[3], current};
+                    break;
+                case OpCode::DRAW_CIRCLE:
+                    *out++ = {DrawCommand::Circle, op[0], op[1], op[2], 0.0f, current};
+                    break;
+                case OpCode::SET_COLOR:
+                    current = packColor(op[0], op[1], op[2]);
+                    break;
+                default:
+                    break;
+            }
+        }
+    });
+    return commands;
+}
+
+#endif
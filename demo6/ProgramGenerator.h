@@ -0,0 +1,114 @@
+#ifndef PROGRAMGENERATOR_H
+#define PROGRAMGENERATOR_H
+
+#include "Bytecode.h"
+#include "ProgramOptimizer.h"
+#include <random>
+#include <vector>
+
+// Relative weights of each kind of instruction in a generated program. The arithmetic
+// weight stands for the whole animated section: arithmetic, loops and animated draws.
+struct OpCodeMix {
+    unsigned rectangles = 4;
+    unsigned circles = 2;
+    unsigned colors = 3;
+    unsigned arithmetic = 1;
+};
+
+// Loops in the animated section: each runs its body this many times
+constexpr int GENERATED_LOOP_COUNT = 4;
+constexpr std::size_t GENERATED_LOOP_BODY = 8;
+
+// Builds a synthetic program of about the given size for benchmarking, laid out like a
+// real scene: a long static section of literal draws and color changes first, which
+// bakeStaticPrefix() can resolve once, then an animated section that reads FRAME_TIME
+// and runs small counted loops (JUMP_IF back, JUMP over a skipped draw) of arithmetic,
+// SIN and draws placed from registers. The arithmetic weight sets the share of the
+// program in the animated section. Shapes land inside the demo window so culling does
+// not remove them wholesale, and the same seed always gives the same program.
+inline std::vector<Instruction> generateProgram(std::size_t size, const OpCodeMix& mix, unsigned seed = 1) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> x(0.0f, static_cast<float>(SCREEN_WIDTH));
+    std::uniform_real_distribution<float> y(0.0f, static_cast<float>(SCREEN_HEIGHT));
+    std::uniform_real_distribution<float> extent(1.0f, 60.0f);
+    std::uniform_int_distribution<int> channel(0, 255);
+
+    unsigned drawWeight = mix.rectangles + mix.circles + mix.colors;
+    unsigned totalWeight = drawWeight + mix.arithmetic;
+    std::size_t staticSize = totalWeight == 0 ? size : size * drawWeight / totalWeight;
+
+    std::vector<Instruction> program;
+    program.reserve(size + GENERATED_LOOP_BODY + 8);
+    auto emit = [&](OpCode opCode, std::uint8_t registerMask, float a = 0.0f, float b = 0.0f, float c = 0.0f,
+                    float d = 0.0f) -> Instruction& {
+        Instruction instruction;
+        instruction.opCode = opCode;
+        instruction.operandCount = opCodeInfo(opCode).operandCount;
+        instruction.registerMask = registerMask;
+        instruction.operands = {a, b, c, d};
+        program.push_back(instruction);
+        return program.back();
+    };
+
+    // Static section
+    if (drawWeight > 0) {
+        std::discrete_distribution<int> kind(
+                {static_cast<double>(mix.rectangles), static_cast<double>(mix.circles), static_cast<double>(mix.colors)});
+        while (program.size() < staticSize) {
+            switch (kind(generator)) {
+                case 0:
+                    emit(OpCode::DRAW_RECTANGLE, 0, extent(generator), extent(generator), x(generator), y(generator));
+                    break;
+                case 1:
+                    emit(OpCode::DRAW_CIRCLE, 0, extent(generator) / 2.0f, x(generator), y(generator));
+                    break;
+                default:
+                    emit(OpCode::SET_COLOR, 0, static_cast<float>(channel(generator)),
+                         static_cast<float>(channel(generator)), static_cast<float>(channel(generator)));
+                    break;
+            }
+        }
+    }
+
+    // Animated section. r0 holds the time, r1 the loop counter, r15 the loop condition
+    // and r2..r14 the loop bodies' values.
+    const float time = 0.0f, counter = 1.0f, condition = 15.0f;
+    std::uniform_int_distribution<int> value(2, 14);
+    std::uniform_int_distribution<int> source(0, 14);
+    std::uniform_int_distribution<int> bodyOp(0, 6);
+    const OpCode arithmeticOps[] = {OpCode::ADD, OpCode::SUB, OpCode::MUL, OpCode::LESS};
+    auto reg = [](int index) { return static_cast<float>(index); };
+    if (program.size() < size)
+        emit(OpCode::FRAME_TIME, 0b1, time);
+    while (program.size() < size) {
+        emit(OpCode::LOAD, 0b01, counter, 0.0f);
+        auto loopStart = static_cast<std::uint32_t>(program.size());
+        for (std::size_t i = 0; i < GENERATED_LOOP_BODY; ++i) {
+            int op = bodyOp(generator);
+            if (op < 4) {
+                emit(arithmeticOps[op], 0b011, reg(value(generator)), reg(source(generator)), extent(generator));
+            } else if (op == 4) {
+                emit(OpCode::SIN, 0b11, reg(value(generator)), reg(source(generator)));
+            } else if (op == 5) {
+                // Bobs up and down with a register
+                emit(OpCode::DRAW_RECTANGLE, 0b1000, extent(generator), extent(generator), x(generator),
+                     reg(value(generator)));
+            } else {
+                emit(OpCode::DRAW_CIRCLE, 0b010, extent(generator) / 2.0f, reg(value(generator)), y(generator));
+            }
+        }
+        emit(OpCode::ADD, 0b011, counter, counter, 1.0f);
+        emit(OpCode::LESS, 0b011, condition, counter, static_cast<float>(GENERATED_LOOP_COUNT));
+        emit(OpCode::JUMP_IF, 0b1, condition).jumpTarget = loopStart;
+        auto skipTo = static_cast<std::uint32_t>(program.size() + 2);
+        emit(OpCode::JUMP, 0).jumpTarget = skipTo;
+        emit(OpCode::DRAW_RECTANGLE, 0, extent(generator), extent(generator), x(generator), y(generator));
+    }
+
+    Instruction end;
+    end.opCode = OpCode::END;
+    program.push_back(end);
+    return program;
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef PROGRAMOPTIMIZER_H
+#define PROGRAMOPTIMIZER_H
+
+#include "Bytecode.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// One resolved shape of a static scene. Plain data without SFML types so it can be
+// emitted as C++ source by bytecode_compiler and compiled straight into the demo.
+struct DrawCommand {
+    enum Kind : std::uint8_t { Rectangle, Circle };
+
+    Kind kind;
+    float a, b, c, d;    // Rectangle: width height x y, Circle: radius x y (d unused)
+    std::uint32_t color; // RGBA as returned by sf::Color::toInteger
+};
+
+// Window size of the demo, the scene is culled against it
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+struct Bounds {
+    float left, top, right, bottom;
+
+    bool contains(const Bounds& other) const {
+        return other.left >= left && other.top >= top && other.right <= right && other.bottom <= bottom;
+    }
+    bool intersects(const Bounds& other) const {
+        return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+    }
+    bool empty() const { return right <= left || bottom <= top; }
+};
+
+const Bounds SCREEN_BOUNDS = {0.0f, 0.0f, static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT)};
+
+inline Bounds commandBounds(const DrawCommand& command) {
+    if (command.kind == DrawCommand::Circle) {
+        float size = 2.0f * command.a;
+        return {command.b, command.c, command.b + size, command.c + size};
+    }
+    return {std::min(command.c, command.c + command.a), std::min(command.d, command.d + command.b),
+            std::max(command.c, command.c + command.a), std::max(command.d, command.d + command.b)};
+}
+
+inline std::uint32_t packColor(float r, float g, float b) {
+    auto channel = [](float value) {
+        return static_cast<std::uint32_t>(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value));
+    };
+    return (channel(r) << 24) | (channel(g) << 16) | (channel(b) << 8) | 0xffu;
+}
+
+constexpr std::uint32_t DEFAULT_COLOR = 0xffffffffu; // Interpreter starts out drawing white
+
+// Length of the leading run of instructions that draws the same thing every frame:
+// only literal DRAW_*/SET_COLOR operands, and no jump anywhere lands inside it.
+inline std::size_t staticPrefixLength(const std::vector<Instruction>& program) {
+    std::size_t length = 0;
+    while (length < program.size()) {
+        const Instruction& instruction = program[length];
+        bool isSceneOp = instruction.opCode == OpCode::DRAW_RECTANGLE ||
+                         instruction.opCode == OpCode::DRAW_CIRCLE ||
+                         instruction.opCode == OpCode::SET_COLOR;
+        if (!isSceneOp || instruction.registerMask != 0)
+            break;
+        ++length;
+    }
+    for (const auto& instruction : program) {
+        if (opCodeInfo(instruction.opCode).hasJumpTarget)
+            length = std::min<std::size_t>(length, instruction.jumpTarget);
+    }
+    return length;
+}
+
+// True when the whole program is a fixed scene (everything up to END is static)
+inline bool isStaticScene(const std::vector<Instruction>& program) {
+    std::size_t prefix = staticPrefixLength(program);
+    return prefix == program.size() || program[prefix].opCode == OpCode::END;
+}
+
+// Resolves the color state of instructions [0, end) into a list of shapes.
+// Redundant SET_COLORs disappear here since only the color in effect at each draw is kept.
+inline std::vector<DrawCommand> decodeDrawList(const std::vector<Instruction>& program, std::size_t end,
+                                               std::uint32_t& finalColor) {
+    std::vector<DrawCommand> commands;
+    std::uint32_t color = DEFAULT_COLOR;
+    for (std::size_t i = 0; i < end; ++i) {
+        const Instruction& instruction = program[i];
+        const auto& op = instruction.operands;
+        switch (instruction.opCode) {
+            case OpCode::DRAW_RECTANGLE:
+                commands.push_back({DrawCommand::Rectangle, op[0], op[1], op[2], op[3], color});
+                break;
+            case OpCode::DRAW_CIRCLE:
+                commands.push_back({DrawCommand::Circle, op[0], op[1], op[2], 0.0f, color});
+                break;
+            case OpCode::SET_COLOR:
+                color = packColor(op[0], op[1], op[2]);
+                break;
+            default:
+                break;
+        }
+    }
+    finalColor = color;
+    return commands;
+}
+
+struct OptimizationStats {
+    std::size_t inputShapes = 0;
+    std::size_t culledOffscreen = 0;
+    std::size_t culledOccluded = 0;
+    std::size_t mergedRectangles = 0;
+    std::size_t outputShapes = 0;
+};
+
+// Removes shapes that are off-screen or completely covered by a later rectangle,
+// then merges runs of same-colored rectangles that share a full edge.
+// Every color is opaque (SET_COLOR has no alpha), so any covering rectangle hides what is under it.
+inline std::vector<DrawCommand> optimizeDrawList(const std::vector<DrawCommand>& commands, const Bounds& screen,
+                                                 OptimizationStats* stats = nullptr) {
+    OptimizationStats local;
+    local.inputShapes = commands.size();
+
+    // Occluders are bucketed by screen cell. A rectangle that contains a shape also
+    // contains its top-left corner, so only that corner's cell has to be searched.
+    constexpr int GRID = 16;
+    std::vector<std::vector<std::size_t>> cells(GRID * GRID);
+    float cellWidth = (screen.right - screen.left) / GRID;
+    float cellHeight = (screen.bottom - screen.top) / GRID;
+    auto cellX = [&](float x) { return std::clamp(static_cast<int>((x - screen.left) / cellWidth), 0, GRID - 1); };
+    auto cellY = [&](float y) { return std::clamp(static_cast<int>((y - screen.top) / cellHeight), 0, GRID - 1); };
+
+    std::vector<bool> visible(commands.size(), false);
+    for (std::size_t i = commands.size(); i-- > 0;) {
+        Bounds bounds = commandBounds(commands[i]);
+        if (bounds.empty() || !bounds.intersects(screen)) {
+            ++local.culledOffscreen;
+            continue;
+        }
+
+        const auto& candidates = cells[cellY(bounds.top) * GRID + cellX(bounds.left)];
+        bool occluded = std::any_of(candidates.begin(), candidates.end(), [&](std::size_t occluder) {
+            return commandBounds(commands[occluder]).contains(bounds);
+        });
+        if (occluded) {
+            ++local.culledOccluded;
+            continue;
+        }
+
+        visible[i] = true;
+        if (commands[i].kind == DrawCommand::Rectangle) {
+            for (int y = cellY(bounds.top); y <= cellY(bounds.bottom); ++y)
+                for (int x = cellX(bounds.left); x <= cellX(bounds.right); ++x)
+                    cells[y * GRID + x].push_back(i);
+        }
+    }
+
+    std::vector<DrawCommand> result;
+    result.reserve(commands.size() - local.culledOffscreen - local.culledOccluded);
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        if (!visible[i])
+            continue;
+        if (commands[i].kind != DrawCommand::Rectangle) {
+            result.push_back(commands[i]);
+            continue;
+        }
+
+        Bounds merged = commandBounds(commands[i]);
+        while (!result.empty() && result.back().kind == DrawCommand::Rectangle &&
+               result.back().color == commands[i].color) {
+            Bounds previous = commandBounds(result.back());
+            bool sameRow = previous.top == merged.top && previous.bottom == merged.bottom &&
+                           (previous.right == merged.left || merged.right == previous.left);
+            bool sameColumn = previous.left == merged.left && previous.right == merged.right &&
+                              (previous.bottom == merged.top || merged.bottom == previous.top);
+            if (!sameRow && !sameColumn)
+                break;
+            merged = {std::min(previous.left, merged.left), std::min(previous.top, merged.top),
+                      std::max(previous.right, merged.right), std::max(previous.bottom, merged.bottom)};
+            result.pop_back();
+            ++local.mergedRectangles;
+        }
+        result.push_back({DrawCommand::Rectangle, merged.right - merged.left, merged.bottom - merged.top,
+                          merged.left, merged.top, commands[i].color});
+    }
+
+    local.outputShapes = result.size();
+    if (stats)
+        *stats = local;
+    return result;
+}
+
+inline Instruction makeSetColor(std::uint32_t color) {
+    Instruction setColor;
+    setColor.opCode = OpCode::SET_COLOR;
+    setColor.operandCount = 3;
+    setColor.operands = {static_cast<float>(color >> 24), static_cast<float>((color >> 16) & 0xff),
+                         static_cast<float>((color >> 8) & 0xff), 0.0f};
+    return setColor;
+}
+
+// Re-emits a draw list as bytecode, with a SET_COLOR only where the color changes
+inline std::vector<Instruction> emitProgram(const std::vector<DrawCommand>& commands) {
+    std::vector<Instruction> program;
+    std::uint32_t color = DEFAULT_COLOR;
+    for (const auto& command : commands) {
+        if (command.color != color) {
+            program.push_back(makeSetColor(command.color));
+            color = command.color;
+        }
+        Instruction draw;
+        if (command.kind == DrawCommand::Rectangle) {
+            draw.opCode = OpCode::DRAW_RECTANGLE;
+            draw.operandCount = 4;
+            draw.operands = {command.a, command.b, command.c, command.d};
+        } else {
+            draw.opCode = OpCode::DRAW_CIRCLE;
+            draw.operandCount = 3;
+            draw.operands = {command.a, command.b, command.c, 0.0f};
+        }
+        program.push_back(draw);
+    }
+    return program;
+}
+
+// Optimization pass over a whole program: the static prefix is replaced by its optimized
+// draw list and the rest is kept, with jump targets shifted to match
+inline std::vector<Instruction> optimizeProgram(const std::vector<Instruction>& program, const Bounds& screen,
+                                                OptimizationStats* stats = nullptr) {
+    std::size_t prefix = staticPrefixLength(program);
+    std::uint32_t finalColor;
+    std::vector<Instruction> optimized =
+            emitProgram(optimizeDrawList(decodeDrawList(program, prefix, finalColor), screen, stats));
+
+    // The rest of the program expects the color the original prefix left behind
+    if (prefix < program.size() && finalColor != DEFAULT_COLOR) {
+        optimized.push_back(makeSetColor(finalColor));
+    }
+
+    std::size_t newPrefix = optimized.size();
+    for (std::size_t i = prefix; i < program.size(); ++i) {
+        Instruction instruction = program[i];
+        if (opCodeInfo(instruction.opCode).hasJumpTarget)
+            instruction.jumpTarget = static_cast<std::uint32_t>(instruction.jumpTarget - prefix + newPrefix);
+        optimized.push_back(instruction);
+    }
+    return optimized;
+}
+
+// FNV-1a over the program source, lets the demo check a precompiled scene
+// was built from the same bytecode file it is about to run
+inline std::uint64_t hashFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::uint64_t hash = 14695981039346656037ull;
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        for (std::streamsize i = 0; i < file.gcount(); ++i) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+#endif
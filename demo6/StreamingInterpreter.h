@@ -0,0 +1,227 @@
+#ifndef STREAMINGINTERPRETER_H
+#define STREAMINGINTERPRETER_H
+
+#include <SFML/Graphics.hpp>
+#include "Bytecode.h"
+#include "BytecodeInterpreter.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Runs a program of any length with bounded memory: instructions are read, executed and
+// rasterized a window at a time, and each window's shapes are drawn into a persistent
+// target (usually an sf::RenderTexture) and then dropped. Registers and the current
+// color carry over between windows.
+//
+// The last windowSize instructions read before the current one are kept, so loops and
+// other backward jumps work as long as they land within them; a jump further back stops
+// the stream with an error. A forward jump reads on until its target, by label or index,
+// has been read. FRAME_TIME reads the frameTime given to step(); like run() of the whole
+// program, a caller animating a program restarts it with a new time once it finishes.
+class StreamingInterpreter {
+public:
+    StreamingInterpreter(const std::string& filename, std::size_t windowSize = 4096)
+            : file(filename), windowSize(windowSize) {
+        if (!file.is_open()) {
+            std::cerr << "Failed to open bytecode file: " << filename << std::endl;
+            finished = true;
+        }
+        buffer.reserve(2 * windowSize);
+        interpreter.setInstructionBudget(windowSize); // One window's worth of work per step()
+    }
+
+    bool isFinished() const { return finished; }
+    // Whether the program has read FRAME_TIME so far, and so needs rerunning to animate
+    bool isAnimated() const { return animated; }
+    std::uint64_t instructionsExecuted() const { return executed; }
+    const BytecodeInterpreter& getInterpreter() const { return interpreter; }
+
+    // Runs the program again from its first instruction, with fresh registers
+    void restart() {
+        if (!file.is_open())
+            return;
+        file.clear();
+        file.seekg(0);
+        buffer.clear();
+        labels.clear();
+        unresolved.clear();
+        base = 0;
+        pc = 0;
+        seeking = false;
+        lineNumber = 0;
+        finished = false;
+        interpreter.reset();
+    }
+
+    // Reads ahead, then executes and draws up to a window of instructions into target.
+    // Returns false once the program has ended.
+    bool step(sf::RenderTarget& target, float frameTime) {
+        if (finished)
+            return false;
+
+        while (ahead() < windowSize && readInstruction()) {
+        }
+        if (ahead() == 0) {
+            // End of file: the program ran off its end, or jumped to a label that never came
+            // (or came too far back to be kept)
+            if (seeking)
+                std::cerr << "Undefined jump label: " << seekLabel << ", or defined more than " << windowSize
+                          << " instructions back" << std::endl;
+            finished = true;
+            return false;
+        }
+
+        FrameStats stats = interpreter.execute(buffer.data(), buffer.size(), pc, frameTime);
+        executed += stats.instructionsExecuted;
+        if (stats.reachedEnd) {
+            finished = true;
+        } else if (pc == DROPPED) {
+            std::cerr << "Line " << lineNumber << ": jump back past the last " << windowSize
+                      << " instructions, which streaming does not keep" << std::endl;
+            finished = true;
+        } else if (pc >= PENDING) {
+            // A jump to a label not read yet: read on until it is
+            std::uint64_t jump = base + (pc & ~PENDING);
+            for (const auto& entry : unresolved) {
+                if (entry.first == jump)
+                    seekLabel = entry.second;
+            }
+            seeking = true;
+        }
+
+        interpreter.render(target);
+        interpreter.clearOutput();
+        return !finished;
+    }
+
+private:
+    // Jump targets are kept relative to buffer[0]. Those at or above PENDING stand for
+    // a label not read yet, with the index of the jump itself below it; DROPPED for an
+    // instruction that has left the buffer.
+    static constexpr std::uint32_t PENDING = 0x80000000u;
+    static constexpr std::uint32_t DROPPED = 0xffffffffu;
+
+    // Instructions read ahead of pc, 0 while pc is past what has been read
+    std::size_t ahead() const { return !seeking && pc < buffer.size() ? buffer.size() - pc : 0; }
+
+    // Parses lines up to the next instruction and appends it to the buffer. Returns
+    // false at the end of the file.
+    bool readInstruction() {
+        std::string error;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            Instruction instruction;
+            std::string_view label;
+            switch (parseLine(line, instruction, label, error)) {
+                case LineKind::Blank:
+                    break;
+                case LineKind::Label:
+                    defineLabel(std::string(label));
+                    break;
+                case LineKind::Error:
+                    std::cerr << "Line " << lineNumber << ": " << error << std::endl;
+                    break;
+                case LineKind::Instruction:
+                    if (buffer.size() >= 2 * windowSize)
+                        compact();
+                    if (instruction.opCode == OpCode::FRAME_TIME)
+                        animated = true;
+                    if (opCodeInfo(instruction.opCode).hasJumpTarget)
+                        link(instruction, label);
+                    buffer.push_back(instruction);
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // Points a jump about to be appended at its target in the buffer
+    void link(Instruction& jump, std::string_view label) {
+        if (label.empty()) {
+            // An index: behind the buffer, or in or past it
+            jump.jumpTarget = jump.jumpTarget < base ? DROPPED : static_cast<std::uint32_t>(jump.jumpTarget - base);
+            return;
+        }
+        auto found = labels.find(std::string(label));
+        if (found != labels.end()) {
+            jump.jumpTarget = static_cast<std::uint32_t>(found->second - base);
+        } else {
+            unresolved.emplace_back(base + buffer.size(), std::string(label));
+            jump.jumpTarget = PENDING | static_cast<std::uint32_t>(buffer.size());
+        }
+    }
+
+    // A label at the end of the buffer: resolves the jumps waiting for it
+    void defineLabel(const std::string& name) {
+        labels[name] = base + buffer.size();
+        for (std::size_t i = 0; i < unresolved.size();) {
+            if (unresolved[i].second != name) {
+                ++i;
+                continue;
+            }
+            buffer[unresolved[i].first - base].jumpTarget = static_cast<std::uint32_t>(buffer.size());
+            unresolved[i] = std::move(unresolved.back());
+            unresolved.pop_back();
+        }
+        if (seeking && name == seekLabel) {
+            seeking = false;
+            pc = buffer.size();
+        }
+    }
+
+    // Drops all but the last windowSize instructions before pc, or before the end of
+    // the buffer while reading on to a jump's target
+    void compact() {
+        std::size_t cursor = ahead() > 0 ? pc : buffer.size();
+        if (cursor <= windowSize)
+            return;
+        std::size_t dropped = cursor - windowSize;
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(dropped));
+        base += dropped;
+        if (!seeking)
+            pc -= dropped;
+
+        for (Instruction& instruction : buffer) {
+            std::uint32_t& target = instruction.jumpTarget;
+            if (!opCodeInfo(instruction.opCode).hasJumpTarget || target == DROPPED)
+                continue;
+            if (target >= PENDING)
+                target -= static_cast<std::uint32_t>(dropped); // Still in the buffer, as is its jump
+            else
+                target = target >= dropped ? target - static_cast<std::uint32_t>(dropped) : DROPPED;
+        }
+        for (auto it = labels.begin(); it != labels.end();)
+            it = it->second < base ? labels.erase(it) : std::next(it);
+        for (std::size_t i = 0; i < unresolved.size();) {
+            if (unresolved[i].first < base) {
+                unresolved[i] = std::move(unresolved.back());
+                unresolved.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    std::ifstream file;
+    std::size_t windowSize;
+    bool finished = false;
+    bool animated = false;
+    std::size_t lineNumber = 0;
+    std::uint64_t executed = 0;
+    std::string line;
+    std::vector<Instruction> buffer; // Instructions [base, base + size) of the program
+    std::uint64_t base = 0;
+    std::size_t pc = 0;              // Into buffer
+    bool seeking = false;            // Reading on to seekLabel for a jump
+    std::string seekLabel;
+    std::unordered_map<std::string, std::uint64_t> labels;          // In the buffer or at its end
+    std::vector<std::pair<std::uint64_t, std::string>> unresolved; // Jumps in the buffer to labels not read yet
+    BytecodeInterpreter interpreter;
+};
+
+#endif
@@ -0,0 +1,193 @@
+// bytecode_bench: measures each phase of the demo6 bytecode pipeline on a synthetic program.
+//
+// Usage: bytecode_bench [--size N] [--mix rect,circle,color,arith] [--iterations N]
+//                       [--warmup N] [--threads N] [--seed N] [--json file]
+//
+// Phases are text parse (serial and parallel), binary load, execute, bake (static
+// scene optimization and vertex generation) and offscreen render. Each is run warmup +
+// iterations times; the results are printed as a table and written as JSON.
+
+#include <SFML/Graphics.hpp>
+#include "Bytecode.h"
+#include "BytecodeInterpreter.h"
+#include "ParallelLoader.h"
+#include "ProgramGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct PhaseResult {
+    std::string name;
+    std::vector<double> milliseconds; // Sorted
+    std::uint64_t instructions = 0;   // Handled per run, for the instr/s column; 0 for the program size
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+PhaseResult measure(const std::string& name, int warmup, int iterations, const std::function<void()>& body) {
+    for (int i = 0; i < warmup; ++i)
+        body();
+
+    PhaseResult result{name, {}};
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        result.milliseconds.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(result.milliseconds.begin(), result.milliseconds.end());
+    return result;
+}
+
+bool parseMix(const std::string& text, OpCodeMix& mix) {
+    std::istringstream iss(text);
+    char comma1, comma2, comma3;
+    return static_cast<bool>(iss >> mix.rectangles >> comma1 >> mix.circles >> comma2 >> mix.colors >> comma3 >>
+                             mix.arithmetic);
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t size = 100'000;
+    OpCodeMix mix;
+    int iterations = 20;
+    int warmup = 3;
+    unsigned threads = defaultThreadCount();
+    unsigned seed = 1;
+    std::string jsonPath = "bytecode_bench.json";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            size = std::stoull(argv[++i]);
+        } else if (arg == "--mix" && hasValue) {
+            if (!parseMix(argv[++i], mix)) {
+                std::cerr << "--mix expects four comma separated weights" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--iterations" && hasValue) {
+            iterations = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--size N] [--mix rect,circle,color,arith] [--iterations N]"
+                      << " [--warmup N] [--threads N] [--seed N] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Instruction> program = generateProgram(size, mix, seed);
+
+    auto tempDir = std::filesystem::temp_directory_path();
+    std::string textPath = (tempDir / "bytecode_bench.txt").string();
+    std::string binaryPath = (tempDir / "bytecode_bench.bin").string();
+    {
+        std::ofstream text(textPath);
+        writeProgramText(text, program);
+    }
+    saveProgramBinary(binaryPath, program);
+
+    std::vector<PhaseResult> results;
+    std::size_t checksum = 0; // Keeps the optimizer from discarding results
+
+    results.push_back(measure("text_parse", warmup, iterations, [&] {
+        checksum += loadProgramFromFile(textPath).size();
+    }));
+    results.push_back(measure("text_parse_parallel", warmup, iterations, [&] {
+        checksum += loadProgramParallel(textPath, threads).size();
+    }));
+    results.push_back(measure("binary_load", warmup, iterations, [&] {
+        checksum += loadProgramBinary(binaryPath).size();
+    }));
+
+    // The generated loops run every body GENERATED_LOOP_COUNT times
+    BytecodeInterpreter interpreter(program);
+    interpreter.setInstructionBudget(program.size() * GENERATED_LOOP_COUNT + 1);
+    std::uint64_t executed = interpreter.run(0.5f).instructionsExecuted;
+    results.push_back(measure("execute", warmup, iterations, [&] {
+        checksum += interpreter.run(0.5f).instructionsExecuted;
+    }));
+    results.back().instructions = executed;
+
+    std::size_t prefix = staticPrefixLength(program);
+    BytecodeInterpreter baked(program);
+    results.push_back(measure("bake", warmup, iterations, [&] {
+        checksum += baked.bakeStaticPrefix(SCREEN_BOUNDS, threads).outputShapes;
+    }));
+    results.back().instructions = prefix;
+
+    // Offscreen render of the executed scene. Timing covers draw submission and display(),
+    // the GPU may still be finishing the last frame when the clock stops.
+    sf::RenderTexture canvas;
+    if (canvas.create(SCREEN_WIDTH, SCREEN_HEIGHT)) {
+        interpreter.run(0.0f);
+        results.push_back(measure("render", warmup, iterations, [&] {
+            canvas.clear();
+            interpreter.render(canvas);
+            canvas.display();
+        }));
+    } else {
+        std::cerr << "No OpenGL context available, skipping render phase" << std::endl;
+    }
+
+    std::remove(textPath.c_str());
+    std::remove(binaryPath.c_str());
+
+    std::cout << "Program: " << program.size() << " instructions, mix " << mix.rectangles << "," << mix.circles
+              << "," << mix.colors << "," << mix.arithmetic << ", " << threads << " threads\n";
+    std::cout << "Static prefix (baked): " << prefix << " instructions, execute runs " << executed
+              << " instructions per frame\n";
+    std::cout << std::left << std::setw(22) << "phase" << std::right << std::setw(10) << "min ms" << std::setw(10)
+              << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(16) << "instr/s (p50)"
+              << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& result : results) {
+        double p50 = percentile(result.milliseconds, 50);
+        double instructions = static_cast<double>(result.instructions != 0 ? result.instructions : program.size());
+        std::cout << std::left << std::setw(22) << result.name << std::right << std::setw(10)
+                  << result.milliseconds.front() << std::setw(10) << p50 << std::setw(10)
+                  << percentile(result.milliseconds, 90) << std::setw(10) << percentile(result.milliseconds, 99)
+                  << std::setw(16) << std::setprecision(0) << (p50 > 0 ? instructions / (p50 / 1000.0) : 0.0)
+                  << std::setprecision(3) << "\n";
+    }
+
+    std::ofstream json(jsonPath);
+    json << std::setprecision(6) << std::fixed;
+    json << "{\n  \"instructions\": " << program.size() << ",\n  \"static_prefix\": " << prefix << ",\n  \"seed\": " << seed << ",\n  \"threads\": "
+         << threads << ",\n  \"warmup\": " << warmup << ",\n  \"iterations\": " << iterations
+         << ",\n  \"mix\": {\"rectangles\": " << mix.rectangles << ", \"circles\": " << mix.circles
+         << ", \"colors\": " << mix.colors << ", \"arithmetic\": " << mix.arithmetic << "},\n  \"phases\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& ms = results[i].milliseconds;
+        double mean = 0.0;
+        for (double value : ms)
+            mean += value / static_cast<double>(ms.size());
+        json << "    {\"name\": \"" << results[i].name << "\", \"min_ms\": " << ms.front()
+             << ", \"p50_ms\": " << percentile(ms, 50) << ", \"p90_ms\": " << percentile(ms, 90)
+             << ", \"p99_ms\": " << percentile(ms, 99) << ", \"max_ms\": " << ms.back() << ", \"mean_ms\": " << mean
+             << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ],\n  \"checksum\": " << checksum << "\n}\n";
+    std::cout << "Results written to " << jsonPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,51 @@
+// bytecode_compiler: ahead-of-time specialization of a bytecode program.
+// Resolves and optimizes the program's static prefix and writes it out as a C++ header
+// holding a native draw list, so the demo does not interpret it at startup.
+//
+// Usage: bytecode_compiler <bytecode.txt> <PrecompiledScene.h>
+
+#include "Bytecode.h"
+#include "ProgramOptimizer.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <bytecode file> <output header>" << std::endl;
+        return 1;
+    }
+
+    std::vector<Instruction> program = loadProgramFromFile(argv[1]);
+    std::size_t prefix = staticPrefixLength(program);
+    std::uint32_t finalColor;
+    OptimizationStats stats;
+    std::vector<DrawCommand> commands =
+            optimizeDrawList(decodeDrawList(program, prefix, finalColor), SCREEN_BOUNDS, &stats);
+
+    std::ofstream out(argv[2]);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open output file: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    out << "// Generated by bytecode_compiler from " << argv[1] << ", do not edit\n";
+    out << "#ifndef PRECOMPILEDSCENE_H\n#define PRECOMPILEDSCENE_H\n\n";
+    out << "#include \"ProgramOptimizer.h\"\n#include <array>\n\n";
+    out << "constexpr std::uint64_t PRECOMPILED_SOURCE_HASH = 0x" << std::hex << hashFile(argv[1]) << "ull;\n";
+    out << "constexpr std::uint32_t PRECOMPILED_END_COLOR = 0x" << finalColor << "u;\n" << std::dec;
+    out << "constexpr std::size_t PRECOMPILED_RESUME_AT = " << prefix << ";\n\n";
+    out << "constexpr std::array<DrawCommand, " << commands.size() << "> PRECOMPILED_SCENE = {{\n";
+    out << std::setprecision(9) << std::showpoint;
+    for (const auto& command : commands) {
+        out << "    {" << (command.kind == DrawCommand::Rectangle ? "DrawCommand::Rectangle" : "DrawCommand::Circle")
+            << ", " << command.a << "f, " << command.b << "f, " << command.c << "f, " << command.d << "f, 0x"
+            << std::hex << command.color << std::dec << "u},\n";
+    }
+    out << "}};\n\n#endif\n";
+
+    std::cout << "Precompiled " << prefix << " of " << program.size() << " instructions: " << stats.inputShapes
+              << " shapes -> " << stats.outputShapes << " (" << stats.culledOffscreen << " off-screen, "
+              << stats.culledOccluded << " occluded, " << stats.mergedRectangles << " merged)" << std::endl;
+    return 0;
+}
@@ -1,135 +1,124 @@
-// Updated Bytecode Interpreter example to maintain shapes across frames, ensuring they are persistently drawn on the SFML window.
+// Bytecode Interpreter example with registers, jumps and a FRAME_TIME input so programs can animate.
+// Static programs are executed once; animated ones are re-executed every frame into a batched vertex list.
 
 #include <SFML/Graphics.hpp>
+#include "Bytecode.h"
+#include "BytecodeInterpreter.h"
+#include "ParallelLoader.h"
+#include "ProgramOptimizer.h"
+#include "StreamingInterpreter.h"
+#include "MemoryUsage.h"
 #include <vector>
 #include <iostream>
-#include <memory>
-#include <fstream>
-#include <sstream>
-
-
-enum class OpCode {
-    DRAW_RECTANGLE,
-    DRAW_CIRCLE,
-    SET_COLOR,
-    END
-};
-
-struct Instruction {
-    OpCode opCode;
-    std::vector<float> operands;
-};
-
-class BytecodeInterpreter {
-public:
-    BytecodeInterpreter(const std::vector<Instruction>& program)
-            : program(program), currentIndex(0), currentColor(sf::Color::White) {}
-
-    void run() {
-        // Execute all instructions, storing the shapes
-        while (currentIndex < program.size()) {
-            executeInstruction();
+#include <string>
+
+#ifdef HAS_PRECOMPILED_SCENE
+#include "PrecompiledScene.h" // Generated at build time by bytecode_compiler
+#endif
+
+// Streams a program of any size into a persistent render texture, a window of instructions
+// at a time, spending a few milliseconds of each frame on it so the window stays responsive.
+// A program that reads FRAME_TIME is streamed again once it finishes, with the time the
+// new pass starts at, into a second texture that is shown once that pass is complete.
+int runStreaming(sf::RenderWindow& window, const std::string& filename) {
+    sf::RenderTexture canvases[2];
+    for (sf::RenderTexture& canvas : canvases) {
+        if (!canvas.create(SCREEN_WIDTH, SCREEN_HEIGHT)) {
+            std::cerr << "Failed to create render texture" << std::endl;
+            return -1;
         }
+        canvas.clear();
     }
+    int drawing = 0, shown = 0; // The first pass is shown as it is drawn
 
-    void render(sf::RenderWindow& window) {
-        // Render all stored shapes each frame
-        for (const auto& shape : shapes) {
-            window.draw(*shape);
+    StreamingInterpreter stream(filename);
+    sf::Clock total;
+    sf::Clock titleUpdate;
+    float passTime = 0.0f; // FRAME_TIME of the current pass
+    bool reported = false;
+    std::string status;
+
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
         }
-    }
 
-private:
-    void executeInstruction() {
-        const auto& instruction = program[currentIndex];
-        switch (instruction.opCode) {
-            case OpCode::DRAW_RECTANGLE: {
-                auto rectangle = std::make_unique<sf::RectangleShape>();
-                rectangle->setSize(sf::Vector2f(instruction.operands[0], instruction.operands[1]));
-                rectangle->setPosition(instruction.operands[2], instruction.operands[3]);
-                rectangle->setFillColor(currentColor);
-                shapes.push_back(std::move(rectangle));
-                break;
-            }
-            case OpCode::DRAW_CIRCLE: {
-                auto circle = std::make_unique<sf::CircleShape>();
-                circle->setRadius(instruction.operands[0]);
-                circle->setPosition(instruction.operands[1], instruction.operands[2]);
-                circle->setFillColor(currentColor);
-                shapes.push_back(std::move(circle));
-                break;
-            }
-            case OpCode::SET_COLOR: {
-                currentColor = sf::Color(static_cast<sf::Uint8>(instruction.operands[0]),
-                                         static_cast<sf::Uint8>(instruction.operands[1]),
-                                         static_cast<sf::Uint8>(instruction.operands[2]));
-                break;
+        sf::Clock frameWork;
+        while (!stream.isFinished() && frameWork.getElapsedTime() < sf::milliseconds(8)) {
+            stream.step(canvases[drawing], passTime);
+        }
+        canvases[drawing].display();
+
+        // The numbers are those of the first pass, frozen once it has finished
+        if (!reported) {
+            double seconds = total.getElapsedTime().asSeconds();
+            double rate = seconds > 0.0 ? stream.instructionsExecuted() / seconds : 0.0;
+            status = std::to_string(stream.instructionsExecuted()) + " instructions, " +
+                     std::to_string(static_cast<long long>(rate)) + " instr/s, peak RSS " +
+                     std::to_string(peakResidentSetBytes() / (1024 * 1024)) + " MB";
+            if (stream.isFinished()) {
+                std::cout << "Streamed " << filename << " in " << seconds << " s: " << status << std::endl;
+                reported = true;
             }
-            case OpCode::END:
-                currentIndex = program.size(); // End execution
-                return;
-            default:
-                std::cerr << "Unknown OpCode encountered!" << std::endl;
-                return;
         }
-        currentIndex++;
-    }
-
-    std::vector<Instruction> program;
-    size_t currentIndex;
-    sf::Color currentColor;
-    std::vector<std::unique_ptr<sf::Drawable>> shapes;
-};
-
-std::vector<Instruction> loadProgramFromFile(const std::string& filename) {
-    std::vector<Instruction> program;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open bytecode file: " << filename << std::endl;
-        return program;
-    }
-
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string opCodeStr;
-        iss >> opCodeStr;
-
-        OpCode opCode;
-        if (opCodeStr == "DRAW_RECTANGLE") {
-            opCode = OpCode::DRAW_RECTANGLE;
-        } else if (opCodeStr == "DRAW_CIRCLE") {
-            opCode = OpCode::DRAW_CIRCLE;
-        } else if (opCodeStr == "SET_COLOR") {
-            opCode = OpCode::SET_COLOR;
-        } else if (opCodeStr == "END") {
-            opCode = OpCode::END;
-        } else {
-            std::cerr << "Unknown OpCode in file: " << opCodeStr << std::endl;
-            continue;
+        if (titleUpdate.getElapsedTime() > sf::seconds(0.5f)) {
+            window.setTitle("Streaming " + filename + ": " + status);
+            titleUpdate.restart();
         }
-
-        std::vector<float> operands;
-        float operand;
-        while (iss >> operand) {
-            operands.push_back(operand);
+        if (stream.isFinished() && stream.isAnimated()) {
+            shown = drawing;
+            drawing = 1 - drawing;
+            canvases[drawing].clear();
+            passTime = total.getElapsedTime().asSeconds();
+            stream.restart();
         }
 
-        program.push_back({opCode, operands});
+        window.clear();
+        window.draw(sf::Sprite(canvases[shown].getTexture()));
+        window.display();
     }
 
-    return program;
+    stream.getInterpreter().printProfile(std::cout);
+    return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     // Create an SFML window
-    sf::RenderWindow window(sf::VideoMode(800, 600), "Bytecode Interpreter Example");
+    sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "Bytecode Interpreter Example");
 
-    // Load the bytecode program from an external file
-    std::vector<Instruction> program = loadProgramFromFile("bytecode.txt");
+    // demo6 --stream [file] runs a program of any length with constant memory
+    if (argc >= 2 && std::string(argv[1]) == "--stream") {
+        return runStreaming(window, argc >= 3 ? argv[2] : "bytecode.txt");
+    }
+
+    // Load the bytecode program from an external file, parsing large files on every core
+    unsigned threads = defaultThreadCount();
+    std::vector<Instruction> program = loadProgramParallel("bytecode.txt", threads);
 
     BytecodeInterpreter interpreter(program);
-    interpreter.run(); // Execute all instructions once to store shapes
+    interpreter.setInstructionBudget(1'000'000); // Keep a runaway loop from stalling the frame
+
+    // Use the draw list compiled into the executable when it was built from this same file,
+    // otherwise resolve the static part of the scene now
+    bool precompiled = false;
+#ifdef HAS_PRECOMPILED_SCENE
+    if (hashFile("bytecode.txt") == PRECOMPILED_SOURCE_HASH) {
+        interpreter.setPrecompiledScene(PRECOMPILED_SCENE.data(), PRECOMPILED_SCENE.size(), PRECOMPILED_RESUME_AT,
+                                        PRECOMPILED_END_COLOR, threads);
+        precompiled = true;
+    }
+#endif
+    if (!precompiled) {
+        OptimizationStats optimization = interpreter.bakeStaticPrefix(SCREEN_BOUNDS, threads);
+        std::cout << "Static scene: " << optimization.inputShapes << " shapes -> " << optimization.outputShapes
+                  << std::endl;
+    }
+
+    sf::Clock clock;
+    FrameStats stats = interpreter.run(0.0f); // Static programs only need this one execution
+    bool budgetWarningShown = false;
 
     // Main loop
     while (window.isOpen()) {
@@ -139,10 +128,21 @@ int main() {
                 window.close();
         }
 
+        if (interpreter.isAnimated()) {
+            stats = interpreter.run(clock.getElapsedTime().asSeconds());
+        }
+        if (stats.budgetExhausted && !budgetWarningShown) {
+            std::cerr << "Instruction budget exhausted after " << stats.instructionsExecuted
+                      << " instructions, frame truncated" << std::endl;
+            budgetWarningShown = true;
+        }
+
         window.clear();
-        interpreter.render(window); // Render all stored shapes each frame
+        interpreter.render(window); // Render the scene built by the last run
         window.display();
     }
 
+    interpreter.printProfile(std::cout);
+
     return 0;
-}
\ No newline at end of file
+}
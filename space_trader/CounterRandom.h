@@ -0,0 +1,38 @@
+#ifndef COUNTERRANDOM_H
+#define COUNTERRANDOM_H
+
+#include <cstdint>
+
+// Random numbers that are a pure function of (seed, stream, substream, counter): each
+// value is a hash of its position instead of the next state of a shared generator.
+// Every ship draws from its own stream, so the numbers it gets do not depend on how
+// many other ships drew before it, in what order, or on which thread. Unlike
+// std::rand() nothing is shared, so any number of threads can draw at once.
+class CounterRandom {
+public:
+    CounterRandom(std::uint64_t seed, std::uint64_t stream, std::uint64_t substream = 0)
+        : key(mix(seed + mix(stream + mix(substream + 0x632be59bd9b4e019ull)))) {}
+
+    std::uint32_t next() { return static_cast<std::uint32_t>(mix(key + ++counter * 0x9e3779b97f4a7c15ull) >> 32); }
+
+    // In [low, high)
+    float uniform(float low, float high) { return low + (high - low) * (next() >> 8) * (1.0f / 16777216.0f); }
+
+    // In [0, count)
+    std::uint32_t below(std::uint32_t count) {
+        return static_cast<std::uint32_t>((static_cast<std::uint64_t>(next()) * count) >> 32);
+    }
+
+private:
+    // SplitMix64's finalizer
+    static std::uint64_t mix(std::uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    std::uint64_t key;
+    std::uint64_t counter = 0;
+};
+
+#endif
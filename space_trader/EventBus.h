@@ -0,0 +1,274 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include "Fleet.h"
+#include "GalaxyPosition.h"
+#include "MpscRing.h"
+#include "TypeRegistry.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum Topic : std::uint8_t {
+    TOPIC_TRADE_OFFER,   // A station or ship offers commodity, quantity and price
+    TOPIC_CARGO_CHANGED, // A ship's cargo of commodity changed by quantity
+    TOPIC_COUNT
+};
+
+// Plain data, so events are copied through the ring without allocating
+struct Event {
+    Topic topic;
+    ShipId ship = NO_SHIP; // The ship the event is about, if any
+    TypeId commodity = 0;
+    std::int32_t quantity = 0;
+    std::int32_t price = 0;
+    float x = 0.0f, y = 0.0f; // Where it happened, from the corner of sector
+    SectorKey sector{0, 0};
+};
+
+class EventSubscriber {
+public:
+    virtual ~EventSubscriber() = default;
+
+    // A batch of events of one topic, in the order they were published
+    virtual void onEvents(const Event* events, std::size_t count) = 0;
+};
+
+typedef std::uint32_t SubscriptionId;
+
+// Side of the grid cells that regional subscriptions are indexed by, in world units,
+// rounded so that a whole number of them fit in a sector
+const float SUBSCRIPTION_CELL_SIZE = 256.0f;
+// Extra radius a regional subscription is indexed with, so that it can move this far
+// before it has to be indexed again
+const float SUBSCRIPTION_SLACK = 32.0f;
+
+// Replaces the synchronous NotificationCenter. Publishing only copies the event into a
+// lock-free ring, so it is cheap and safe from any thread; once per frame the game
+// thread calls dispatch(), which hands each subscriber that frame's events of the
+// topics it subscribed to, one call per topic. Nothing runs subscriber code while the
+// simulation is updating.
+//
+// A subscription covers a whole topic or only the events within a radius of a point,
+// such as trade offers in range of a ship. Regional subscriptions are indexed by the
+// grid cells their circle overlaps, so an event only reaches the subscribers of its
+// own cell instead of being broadcast to everyone. Positions are from the corner of a
+// sector, as ships' are, and the cells line up with the sector borders (see
+// GalaxyCells), so a circle reaches into the sectors next to its own. Subscriptions know their place in
+// every list that holds them, so unsubscribing swaps them out in constant time.
+class EventBus {
+public:
+    explicit EventBus(std::size_t capacity = 65536) : ring(capacity), grid(SUBSCRIPTION_CELL_SIZE) {}
+
+    // Safe from any thread. Returns false, and counts the event as dropped, if this
+    // frame's events already fill the ring.
+    bool publish(const Event& event) {
+        if (ring.push(event))
+            return true;
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // The rest is for the game thread only, and not from inside onEvents()
+
+    // Subscribes to every event of the topic
+    SubscriptionId subscribe(Topic topic, EventSubscriber* subscriber) {
+        SubscriptionId id = allocate(topic, subscriber, 0.0f);
+        subscriptions[id].slots.push_back(static_cast<std::uint32_t>(global[topic].size()));
+        global[topic].push_back(id);
+        return id;
+    }
+
+    // Subscribes to the topic's events within radius (> 0) of (x, y) from the corner
+    // of sector
+    SubscriptionId subscribe(Topic topic, EventSubscriber* subscriber, SectorKey sector, float x, float y,
+                             float radius) {
+        SubscriptionId id = allocate(topic, subscriber, radius);
+        insertInCells(id, sector, x, y);
+        return id;
+    }
+
+    // Moves a regional subscription. Only touches the cell index when the circle
+    // leaves the cells it is indexed in.
+    void moveSubscription(SubscriptionId id, SectorKey sector, float x, float y) {
+        Subscription& subscription = subscriptions[id];
+        if (subscription.cells.contains(cellRange(sector, x, y, subscription.radius))) {
+            subscription.sector = sector;
+            subscription.x = x;
+            subscription.y = y;
+            return;
+        }
+        removeFromCells(id);
+        insertInCells(id, sector, x, y);
+    }
+
+    void unsubscribe(SubscriptionId id) {
+        Subscription& subscription = subscriptions[id];
+        if (subscription.radius > 0.0f) {
+            removeFromCells(id);
+        } else {
+            std::vector<SubscriptionId>& list = global[subscription.topic];
+            removeAt(list, subscription.slots[0], id, [&](SubscriptionId moved) -> std::uint32_t& {
+                return subscriptions[moved].slots[0];
+            });
+        }
+        subscription.subscriber = nullptr;
+        subscription.slots.clear();
+        subscription.pending.clear();
+        freeIds.push_back(id);
+    }
+
+    // Delivers everything published since the last call, grouped by topic
+    void dispatch() {
+        lastCallbacks = 0;
+        Event event;
+        while (ring.pop(event))
+            batches[event.topic].push_back(event);
+        for (int topic = 0; topic < TOPIC_COUNT; ++topic) {
+            std::vector<Event>& batch = batches[topic];
+            if (batch.empty())
+                continue;
+            for (SubscriptionId id : global[topic])
+                subscriptions[id].subscriber->onEvents(batch.data(), batch.size());
+            lastCallbacks += global[topic].size();
+
+            // Regional subscribers collect the events in range, then get them in one call
+            if (!cells[topic].empty()) {
+                for (const Event& e : batch) {
+                    auto found = cells[topic].find(grid.cellOf(e.sector, e.x, e.y));
+                    if (found == cells[topic].end())
+                        continue;
+                    for (SubscriptionId id : found->second) {
+                        Subscription& subscription = subscriptions[id];
+                        float dx = e.x + e.sector.offsetX(subscription.sector) - subscription.x;
+                        float dy = e.y + e.sector.offsetY(subscription.sector) - subscription.y;
+                        if (dx * dx + dy * dy > subscription.radius * subscription.radius)
+                            continue;
+                        if (subscription.pending.empty())
+                            touched.push_back(id);
+                        subscription.pending.push_back(e);
+                    }
+                }
+                for (SubscriptionId id : touched) {
+                    Subscription& subscription = subscriptions[id];
+                    subscription.subscriber->onEvents(subscription.pending.data(), subscription.pending.size());
+                    subscription.pending.clear();
+                }
+                lastCallbacks += touched.size();
+                touched.clear();
+            }
+            batch.clear();
+        }
+    }
+
+    std::size_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Subscriber calls made by the last dispatch()
+    std::size_t getLastCallbacks() const { return lastCallbacks; }
+
+private:
+    // Cells a regional subscription's circle overlaps, inclusive
+    struct CellRange {
+        std::int64_t x0, y0, x1, y1;
+
+        bool contains(const CellRange& other) const {
+            return x0 <= other.x0 && y0 <= other.y0 && x1 >= other.x1 && y1 >= other.y1;
+        }
+        std::int64_t width() const { return x1 - x0 + 1; }
+    };
+
+    struct Subscription {
+        EventSubscriber* subscriber = nullptr;
+        Topic topic = TOPIC_TRADE_OFFER;
+        SectorKey sector{0, 0};
+        float x = 0.0f, y = 0.0f;
+        float radius = 0.0f; // 0 for the whole topic
+        CellRange cells{0, 0, -1, -1};
+        // Index in each list holding the subscription: the topic's global list, or the
+        // list of each cell in cells, row by row
+        std::vector<std::uint32_t> slots;
+        std::vector<Event> pending; // This dispatch's events in range
+    };
+
+    CellRange cellRange(SectorKey sector, float x, float y, float radius) const {
+        return CellRange{grid.cellOf(sector.x, x - radius), grid.cellOf(sector.y, y - radius),
+                         grid.cellOf(sector.x, x + radius), grid.cellOf(sector.y, y + radius)};
+    }
+
+    SubscriptionId allocate(Topic topic, EventSubscriber* subscriber, float radius) {
+        SubscriptionId id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = static_cast<SubscriptionId>(subscriptions.size());
+            subscriptions.emplace_back();
+        }
+        Subscription& subscription = subscriptions[id];
+        subscription.subscriber = subscriber;
+        subscription.topic = topic;
+        subscription.radius = radius;
+        return id;
+    }
+
+    void insertInCells(SubscriptionId id, SectorKey sector, float x, float y) {
+        Subscription& subscription = subscriptions[id];
+        subscription.sector = sector;
+        subscription.x = x;
+        subscription.y = y;
+        subscription.cells = cellRange(sector, x, y, subscription.radius + SUBSCRIPTION_SLACK);
+        subscription.slots.clear();
+        const CellRange& range = subscription.cells;
+        for (std::int64_t cy = range.y0; cy <= range.y1; ++cy) {
+            for (std::int64_t cx = range.x0; cx <= range.x1; ++cx) {
+                std::vector<SubscriptionId>& list = cells[subscription.topic][GalaxyCells::Cell{cx, cy}];
+                subscription.slots.push_back(static_cast<std::uint32_t>(list.size()));
+                list.push_back(id);
+            }
+        }
+    }
+
+    void removeFromCells(SubscriptionId id) {
+        Subscription& subscription = subscriptions[id];
+        auto& topicCells = cells[subscription.topic];
+        const CellRange& range = subscription.cells;
+        std::size_t slot = 0;
+        for (std::int64_t cy = range.y0; cy <= range.y1; ++cy) {
+            for (std::int64_t cx = range.x0; cx <= range.x1; ++cx, ++slot) {
+                auto found = topicCells.find(GalaxyCells::Cell{cx, cy});
+                removeAt(found->second, subscription.slots[slot], id, [&](SubscriptionId moved) -> std::uint32_t& {
+                    Subscription& other = subscriptions[moved];
+                    return other.slots[(cy - other.cells.y0) * other.cells.width() + (cx - other.cells.x0)];
+                });
+                if (found->second.empty())
+                    topicCells.erase(found);
+            }
+        }
+    }
+
+    // Removes id from list at index by moving the last entry into its place, and
+    // points the moved entry's slot at its new index
+    template <typename SlotOf>
+    static void removeAt(std::vector<SubscriptionId>& list, std::uint32_t index, SubscriptionId id, SlotOf slotOf) {
+        SubscriptionId moved = list.back();
+        list[index] = moved;
+        list.pop_back();
+        if (moved != id)
+            slotOf(moved) = index;
+    }
+
+    MpscRing<Event> ring;
+    GalaxyCells grid;
+    std::vector<Subscription> subscriptions; // By SubscriptionId
+    std::vector<SubscriptionId> freeIds;
+    std::vector<SubscriptionId> global[TOPIC_COUNT];
+    std::unordered_map<GalaxyCells::Cell, std::vector<SubscriptionId>, GalaxyCells::CellHash> cells[TOPIC_COUNT];
+    std::vector<Event> batches[TOPIC_COUNT]; // Reused every frame
+    std::vector<SubscriptionId> touched;
+    std::atomic<std::size_t> dropped{0};
+    std::size_t lastCallbacks = 0;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include "GalaxyPosition.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Constants
+const float PI = 3.14159f;
+const float MAX_THRUST = 100.0f;
+const float FRICTION = 0.98f;
+const float TURN_RATE = 0.1f;         // Fraction of the turn toward the target made per update
+const float ARRIVAL_DISTANCE = 10.0f; // A ship this close to its target stops
+const float APPROACH_RATE = 0.2f;     // Most of the distance to its target a ship covers per update
+const float SIDE_DRAG = 0.8f;         // Part of its sideways velocity a steering ship keeps per update
+const float CRUISE_SPEED = 100.0f;    // Distance per update of a ship moved by updateCoarse()
+
+typedef std::uint32_t ShipId;
+const ShipId NO_SHIP = 0xffffffffu; // No ship, such as a station
+
+// How far one run of the update kernel takes a ship: one update, or several at once
+// for ships that are updated less often. Several updates at once apply the thrust,
+// turning, drag and friction of all of them in a single step, which is close enough
+// for ships too far away to watch.
+struct StepRates {
+    float updates;
+    float thrust;   // Added to the velocity
+    float turn;     // Fraction of the turn toward the target made
+    float sideKeep; // Part of the sideways velocity kept
+    float friction;
+    float approach; // Most of the distance to the target covered, per update
+
+    explicit StepRates(float updates = 1.0f)
+        : updates(updates), thrust(MAX_THRUST * 0.1f * updates),
+          turn(updates == 1.0f ? TURN_RATE : 1.0f - std::pow(1.0f - TURN_RATE, updates)),
+          sideKeep(std::pow(SIDE_DRAG, updates)), friction(std::pow(FRICTION, updates)),
+          approach(std::min(1.0f, APPROACH_RATE * updates) / updates) {}
+};
+
+// Kinematics of every ship, one array per field, so that the update kernel streams
+// through contiguous floats and the compiler can vectorize it. Headings are unit
+// vectors instead of angles: steering toward a target, thrusting and drawing all work
+// with the vector directly, and no ship needs atan2, sin or cos per update.
+//
+// Every ship is in a sector, and its position and target are from that sector's
+// corner, so they keep their precision however far from the galaxy's origin it flies.
+// rehome() moves a ship that flew out of its sector into the one it is now in.
+class Fleet {
+public:
+    std::vector<float> x, y;
+    std::vector<float> velocityX, velocityY;
+    std::vector<float> headingX, headingY;
+    std::vector<float> targetX, targetY;
+    std::vector<std::uint8_t> hasTarget;
+    std::vector<SectorKey> sector;
+
+    ShipId add(float shipX, float shipY, SectorKey shipSector = SectorKey{0, 0}) {
+        x.push_back(shipX);
+        y.push_back(shipY);
+        velocityX.push_back(0.0f);
+        velocityY.push_back(0.0f);
+        headingX.push_back(1.0f);
+        headingY.push_back(0.0f);
+        targetX.push_back(shipX);
+        targetY.push_back(shipY);
+        hasTarget.push_back(0);
+        sector.push_back(shipSector);
+        return static_cast<ShipId>(x.size() - 1);
+    }
+
+    // Overwrites a ship with one of another Fleet, sector and all
+    void assign(ShipId ship, const Fleet& from, ShipId source) {
+        x[ship] = from.x[source];
+        y[ship] = from.y[source];
+        velocityX[ship] = from.velocityX[source];
+        velocityY[ship] = from.velocityY[source];
+        headingX[ship] = from.headingX[source];
+        headingY[ship] = from.headingY[source];
+        targetX[ship] = from.targetX[source];
+        targetY[ship] = from.targetY[source];
+        hasTarget[ship] = from.hasTarget[source];
+        sector[ship] = from.sector[source];
+    }
+
+    std::size_t size() const { return x.size(); }
+
+    void setTarget(ShipId ship, float tx, float ty) {
+        targetX[ship] = tx;
+        targetY[ship] = ty;
+        hasTarget[ship] = 1;
+    }
+
+    // Pushes a ship along its heading
+    void thrust(ShipId ship, float amount) {
+        velocityX[ship] += headingX[ship] * amount;
+        velocityY[ship] += headingY[ship] * amount;
+    }
+
+    // Turns a ship's heading by an angle in degrees, clockwise on screen
+    void turn(ShipId ship, float degrees) {
+        float c = std::cos(degrees * PI / 180), s = std::sin(degrees * PI / 180);
+        float hx = headingX[ship], hy = headingY[ship];
+        headingX[ship] = hx * c - hy * s;
+        headingY[ship] = hx * s + hy * c;
+    }
+
+    // Heading in degrees, for code that still wants an angle
+    float getRotation(ShipId ship) const { return std::atan2(headingY[ship], headingX[ship]) * 180 / PI; }
+
+    void update() { update(0, size()); }
+
+    // Steers ships [begin, end) toward their targets, applies thrust and friction and
+    // moves them
+    void update(std::size_t begin, std::size_t end, const StepRates& rates = StepRates()) {
+        step(ShipRange{begin}, end - begin, rates);
+    }
+
+    // Likewise for the listed ships only, such as those near enough to watch
+    void update(const std::vector<ShipId>& ships, const StepRates& rates = StepRates()) {
+        step(ships.data(), ships.size(), rates);
+    }
+
+    // Moves ships [begin, end) straight toward their targets at CRUISE_SPEED, as far as
+    // they would get in the given number of updates, with no steering or inertia. For
+    // ships nobody is close enough to watch, updated only now and then.
+    void updateCoarse(std::size_t begin, std::size_t end, float updates) {
+        float reach = CRUISE_SPEED * updates;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!hasTarget[i])
+                continue;
+            float dx = targetX[i] - x[i], dy = targetY[i] - y[i];
+            float distance = std::sqrt(dx * dx + dy * dy);
+            if (distance <= reach) {
+                x[i] = targetX[i];
+                y[i] = targetY[i];
+                hasTarget[i] = 0;
+            } else {
+                x[i] += dx / distance * reach;
+                y[i] += dy / distance * reach;
+                headingX[i] = dx / distance;
+                headingY[i] = dy / distance;
+            }
+            velocityX[i] = 0.0f;
+            velocityY[i] = 0.0f;
+        }
+    }
+
+    // Moves a ship that flew out of its sector into the sector it is in now: whole
+    // sectors go from its coordinates, and its target's, into its sector key. Returns
+    // the sectors it moved by, {0, 0} if it is still in its sector.
+    SectorKey rehome(ShipId ship) {
+        SectorKey step{static_cast<std::int32_t>(std::floor(x[ship] / SECTOR_SIZE)),
+                       static_cast<std::int32_t>(std::floor(y[ship] / SECTOR_SIZE))};
+        if (step.x != 0 || step.y != 0) {
+            float dx = static_cast<float>(step.x) * SECTOR_SIZE, dy = static_cast<float>(step.y) * SECTOR_SIZE;
+            x[ship] -= dx;
+            y[ship] -= dy;
+            targetX[ship] -= dx;
+            targetY[ship] -= dy;
+            sector[ship].x += step.x;
+            sector[ship].y += step.y;
+        }
+        return step;
+    }
+
+private:
+    // Ships begin, begin + 1, ..., indexed like a list of ShipIds
+    struct ShipRange {
+        std::size_t begin;
+        std::size_t operator[](std::size_t k) const { return begin + k; }
+    };
+
+    template <typename Ships>
+    void step(Ships ships, std::size_t count, const StepRates& rates) {
+        step(x.data(), y.data(), velocityX.data(), velocityY.data(), headingX.data(), headingY.data(), targetX.data(),
+             targetY.data(), hasTarget.data(), ships, count, rates);
+    }
+
+    // The update kernel. Every ship runs the same arithmetic, and whether it has a
+    // target only selects between results, so the loop has no branches. Together with
+    // the restrict-qualified arrays this lets the compiler vectorize it (see the
+    // compile options in CMakeLists.txt) when the ships are a range; a list of ships
+    // is gathered one by one.
+    template <typename Ships>
+    static void step(float* __restrict px, float* __restrict py, float* __restrict vx, float* __restrict vy,
+                     float* __restrict hx, float* __restrict hy, const float* __restrict tx,
+                     const float* __restrict ty, std::uint8_t* __restrict active, Ships ships, std::size_t count,
+                     const StepRates& rates) {
+        const float updates = rates.updates, thrust = rates.thrust, turn = rates.turn;
+        const float sideKeep = rates.sideKeep, friction = rates.friction, approach = rates.approach;
+
+        for (std::size_t k = 0; k < count; ++k) {
+            std::size_t i = ships[k];
+            float steering = static_cast<float>(active[i]);
+            float headX = hx[i], headY = hy[i];
+            float dx = tx[i] - px[i], dy = ty[i] - py[i];
+            float distanceSquared = dx * dx + dy * dy;
+            float inverse = 1.0f / std::sqrt(distanceSquared + 1e-12f);
+            float dirX = dx * inverse, dirY = dy * inverse;
+
+            // Turn part of the way toward the target. Blending two opposite vectors
+            // would not turn at all, so a target behind the ship is approached by
+            // turning toward the side it is on.
+            float behind = headX * dirX + headY * dirY < 0.0f ? 1.0f : 0.0f;
+            float side = headX * dirY - headY * dirX < 0.0f ? -1.0f : 1.0f;
+            float desiredX = dirX + behind * (-headY * side - dirX);
+            float desiredY = dirY + behind * (headX * side - dirY);
+            headX += (desiredX - headX) * turn * steering;
+            headY += (desiredY - headY) * turn * steering;
+            float length = 1.0f / std::sqrt(headX * headX + headY * headY);
+            headX *= length;
+            headY *= length;
+
+            // Arriving stops the ship dead
+            float arrived = distanceSquared < ARRIVAL_DISTANCE * ARRIVAL_DISTANCE ? steering : 0.0f;
+            float moving = 1.0f - arrived;
+            float newVelocityX = (vx[i] + headX * thrust * steering) * moving;
+            float newVelocityY = (vy[i] + headY * thrust * steering) * moving;
+
+            // Killing sideways drift and slowing down on approach, so that a ship
+            // cannot fall into an orbit around its target and does arrive
+            float along = newVelocityX * headX + newVelocityY * headY;
+            float keep = 1.0f + steering * (sideKeep - 1.0f);
+            newVelocityX = along * headX + (newVelocityX - along * headX) * keep;
+            newVelocityY = along * headY + (newVelocityY - along * headY) * keep;
+            float speed = std::sqrt(newVelocityX * newVelocityX + newVelocityY * newVelocityY);
+            float facing = std::max(0.0f, headX * dirX + headY * dirY);
+            float limit = distanceSquared * inverse * approach * facing;
+            float brake = 1.0f + steering * (std::min(1.0f, limit / (speed + 1e-6f)) - 1.0f);
+            newVelocityX *= brake;
+            newVelocityY *= brake;
+
+            // Apply velocity with inertia and friction
+            hx[i] = headX;
+            hy[i] = headY;
+            px[i] += newVelocityX * updates;
+            py[i] += newVelocityY * updates;
+            vx[i] = newVelocityX * friction;
+            vy[i] = newVelocityY * friction;
+            active[i] = static_cast<std::uint8_t>(steering - arrived);
+        }
+    }
+};
+
+#endif
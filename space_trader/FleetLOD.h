@@ -0,0 +1,312 @@
+#ifndef FLEETLOD_H
+#define FLEETLOD_H
+
+#include "Fleet.h"
+#include "Galaxy.h"
+#include "ShipAI.h"
+#include "SpatialGrid.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const float LOD_FULL_RADIUS = 1500.0f;    // Ships this close to the focus get the full update every frame...
+const float LOD_FULL_EXIT = 2000.0f;      // ...and keep it until they are this far
+const float LOD_REDUCED_RADIUS = 6000.0f; // Ships this close get it every LOD_REDUCED_INTERVAL frames...
+const float LOD_REDUCED_EXIT = 7000.0f;   // ...and keep it until they are this far
+const std::uint64_t LOD_REDUCED_INTERVAL = 4;
+const int LOD_ASSESS_INTERVAL = AI_DECISION_INTERVAL; // Frames between two assessments of one ship
+
+enum LODTier : std::uint8_t {
+    LOD_NONE,    // Not under LOD control
+    LOD_FULL,    // Fleet update every frame
+    LOD_REDUCED, // Fleet update of LOD_REDUCED_INTERVAL updates at once, every LOD_REDUCED_INTERVAL frames
+    LOD_ROUTE,   // Straight along its route at CRUISE_SPEED, worked out from the time alone
+    LOD_SECTOR,  // In a sector beyond NEAR_RADIUS of the focus: moved, or parked, by the Galaxy with its sector
+};
+
+// Level of detail for the simulation of ships: ships near the focus, usually the
+// player, get the full Fleet update every frame, ships further out get it a few
+// updates at a time, and the rest are not simulated at all. Where one of those is at
+// any frame follows from where it started on its route, and when; the Fleet is only
+// told in the frames it is assessed. The cost of a frame is then in the ships near
+// the focus, plus a fixed share of the fleet being assessed. getMoved() lists the
+// ships that moved in a frame, so that whatever is kept by position, such as a
+// SpatialGrid, need only be brought up to date for those.
+//
+// Each ship is assessed in the frames ShipAI decides for it, just before the AI
+// decides, and ships that come within LOD_FULL_RADIUS of the focus are promoted in
+// the first frame they do. A ship that changes tier is first brought up to date in
+// its old one, so it picks up where it was. The tiers overlap between their radius
+// and their exit, so that a ship on a border does not change tier back and forth.
+// Ships change tier well outside the view, so any difference in where the tiers
+// would have moved them is never seen.
+//
+// Distances to the focus are worked out across sectors, and a ship that a move takes
+// out of its sector is rehomed into the next, its route with it. A ship assessed in a
+// sector beyond NEAR_RADIUS of the focus's is handed to the Galaxy, up to date, and
+// moves with its sector's traffic from then on; it is taken back from the Galaxy once
+// it is assessed in a near sector again, and is not parked there.
+class FleetLOD {
+public:
+    FleetLOD() : reducedRates(static_cast<float>(LOD_REDUCED_INTERVAL)) {}
+
+    // Puts a ship under LOD control, at full detail until it is first assessed
+    void add(ShipId ship) {
+        if (ship >= tiers.size()) {
+            tiers.resize(ship + 1, LOD_NONE);
+            slots.resize(ship + 1);
+            phases.resize(ship + 1);
+            routes.resize(ship + 1);
+        }
+        tiers[ship] = LOD_FULL;
+        insert(full, ship);
+        slices[ship % LOD_ASSESS_INTERVAL].push_back(ship);
+    }
+
+    LODTier getTier(ShipId ship) const { return ship < tiers.size() ? tiers[ship] : LOD_NONE; }
+
+    std::size_t getCount(LODTier tier) const {
+        if (tier == LOD_FULL)
+            return full.size();
+        std::size_t reducedCount = 0;
+        for (const std::vector<ShipId>& phase : reduced)
+            reducedCount += phase.size();
+        if (tier == LOD_REDUCED)
+            return reducedCount;
+        if (tier == LOD_SECTOR)
+            return sectorCount;
+        std::size_t managed = 0;
+        for (const std::vector<ShipId>& slice : slices)
+            managed += slice.size();
+        return tier == LOD_ROUTE ? managed - full.size() - reducedCount - sectorCount : 0;
+    }
+
+    // Reassesses this frame's share of the ships, and any that came near the focus.
+    // Runs before the frame's AI decisions, and places the ships on routes that the AI
+    // decides for this frame. grid must hold the Fleet's positions, and galaxy be the
+    // Galaxy around focus, on the same Fleet.
+    void assess(std::uint64_t frame, Fleet& fleet, const SpatialGrid& grid, Galaxy& galaxy,
+                const GalaxyPosition& focus) {
+        // A ship on a route may be this much nearer than the grid last saw it
+        const float margin = CRUISE_SPEED * LOD_ASSESS_INTERVAL;
+        moved.clear();
+        nearby.clear();
+        grid.queryRadius(focus.sector, focus.x, focus.y, LOD_FULL_RADIUS + margin, nearby);
+        for (ShipId ship : nearby) {
+            if (ship < tiers.size() && tiers[ship] != LOD_NONE && tiers[ship] != LOD_FULL)
+                reassess(ship, frame, fleet, galaxy, focus, false);
+        }
+        for (ShipId ship : slices[frame % LOD_ASSESS_INTERVAL])
+            reassess(ship, frame, fleet, galaxy, focus, true);
+    }
+
+    // Moves the ships that are due this frame
+    void update(std::uint64_t frame, Fleet& fleet) {
+        const std::vector<ShipId>& due = reduced[frame % LOD_REDUCED_INTERVAL];
+        fleet.update(full);
+        fleet.update(due, reducedRates);
+        for (ShipId ship : full)
+            fleet.rehome(ship);
+        for (ShipId ship : due)
+            fleet.rehome(ship);
+        moved.insert(moved.end(), full.begin(), full.end());
+        moved.insert(moved.end(), due.begin(), due.end());
+    }
+
+    // The ships that may have moved in the Fleet since the last assess(): those placed
+    // or brought up to date by it and those update() moved. A ship may be listed twice.
+    const std::vector<ShipId>& getMoved() const { return moved; }
+
+private:
+    // Where a ship in LOD_ROUTE flies: straight from origin to target at CRUISE_SPEED,
+    // setting out after frame start. From the corner of the ship's sector, like the
+    // ship.
+    struct Route {
+        float originX = 0.0f, originY = 0.0f;
+        float targetX = 0.0f, targetY = 0.0f;
+        bool flying = false;
+        std::uint64_t start = 0;
+        std::uint64_t placed = 0; // Frame after which the ship was last placed in the Fleet
+    };
+
+    void reassess(ShipId ship, std::uint64_t frame, Fleet& fleet, Galaxy& galaxy, const GalaxyPosition& focus,
+                  bool due) {
+        // Every ship has been moved through the last frame, or can be. The Galaxy
+        // counts that as being up to date as of this frame.
+        std::uint64_t through = frame - 1;
+        bool near = fleet.sector[ship].distance(focus.sector) <= NEAR_RADIUS;
+        if (tiers[ship] == LOD_SECTOR) {
+            // Stays the Galaxy's until its sector is near, and comes back up to date
+            if (!near || !galaxy.releaseShip(ship, frame))
+                return;
+            moved.push_back(ship);
+            if (fleet.sector[ship].distance(focus.sector) > NEAR_RADIUS) {
+                // Catching up took it out of the near sectors again
+                galaxy.adoptShip(ship, frame);
+                return;
+            }
+        }
+        if (tiers[ship] == LOD_ROUTE && due)
+            place(ship, through, fleet);
+        float x = fleet.x[ship], y = fleet.y[ship];
+        SectorKey sector = fleet.sector[ship];
+        if (tiers[ship] == LOD_ROUTE && !due) {
+            locate(currentRoute(ship, fleet), through, x, y);
+            GalaxyPosition located{sector, x, y};
+            located.normalize();
+            near = located.sector.distance(focus.sector) <= NEAR_RADIUS;
+        }
+        float dx = x + sector.offsetX(focus.sector) - focus.x, dy = y + sector.offsetY(focus.sector) - focus.y;
+        LODTier next = near ? tierAt(tiers[ship], dx * dx + dy * dy) : LOD_SECTOR;
+        if (next != tiers[ship])
+            setTier(ship, next, through, fleet, galaxy);
+    }
+
+    static LODTier tierAt(LODTier tier, float distanceSquared) {
+        float fullRadius = tier == LOD_FULL ? LOD_FULL_EXIT : LOD_FULL_RADIUS;
+        float reducedRadius = tier == LOD_ROUTE || tier == LOD_SECTOR ? LOD_REDUCED_RADIUS : LOD_REDUCED_EXIT;
+        if (distanceSquared <= fullRadius * fullRadius)
+            return LOD_FULL;
+        if (distanceSquared <= reducedRadius * reducedRadius)
+            return LOD_REDUCED;
+        return LOD_ROUTE;
+    }
+
+    // Moves a ship, up to date through the given frame, from its tier to another
+    void setTier(ShipId ship, LODTier tier, std::uint64_t through, Fleet& fleet, Galaxy& galaxy) {
+        switch (tiers[ship]) {
+        case LOD_FULL:
+            remove(full, ship);
+            break;
+        case LOD_REDUCED: {
+            std::uint64_t behind = (through - phases[ship]) % LOD_REDUCED_INTERVAL;
+            if (behind > 0) {
+                fleet.update(ship, ship + 1, StepRates(static_cast<float>(behind)));
+                fleet.rehome(ship);
+                moved.push_back(ship);
+            }
+            remove(reduced[phases[ship]], ship);
+            break;
+        }
+        case LOD_SECTOR:
+            // Back from the Galaxy, already up to date: set off at cruise speed, as the
+            // coarse update flew it
+            --sectorCount;
+            fleet.velocityX[ship] = fleet.hasTarget[ship] ? fleet.headingX[ship] * CRUISE_SPEED : 0.0f;
+            fleet.velocityY[ship] = fleet.hasTarget[ship] ? fleet.headingY[ship] * CRUISE_SPEED : 0.0f;
+            break;
+        default:
+            // Set off at cruise speed, as it was flying
+            place(ship, through, fleet);
+            fleet.velocityX[ship] = fleet.hasTarget[ship] ? fleet.headingX[ship] * CRUISE_SPEED : 0.0f;
+            fleet.velocityY[ship] = fleet.hasTarget[ship] ? fleet.headingY[ship] * CRUISE_SPEED : 0.0f;
+            break;
+        }
+
+        tiers[ship] = tier;
+        if (tier == LOD_FULL) {
+            insert(full, ship);
+        } else if (tier == LOD_REDUCED) {
+            // Its first reduced update is a whole interval after this one
+            phases[ship] = static_cast<std::uint8_t>(through % LOD_REDUCED_INTERVAL);
+            insert(reduced[phases[ship]], ship);
+        } else if (tier == LOD_ROUTE) {
+            routes[ship] = Route{fleet.x[ship], fleet.y[ship], fleet.targetX[ship], fleet.targetY[ship],
+                                 fleet.hasTarget[ship] != 0, through, through};
+        } else {
+            ++sectorCount;
+            galaxy.adoptShip(ship, through + 1);
+        }
+    }
+
+    // The ship's route, started afresh from where it was last placed if its target has
+    // changed since. The AI only changes targets right after a ship is placed.
+    Route currentRoute(ShipId ship, const Fleet& fleet) const {
+        Route route = routes[ship];
+        bool flying = fleet.hasTarget[ship] != 0;
+        if (flying != route.flying ||
+            (flying && (fleet.targetX[ship] != route.targetX || fleet.targetY[ship] != route.targetY))) {
+            route = Route{fleet.x[ship], fleet.y[ship], fleet.targetX[ship], fleet.targetY[ship],
+                          flying, route.placed, route.placed};
+        }
+        return route;
+    }
+
+    // Where a ship on the route is after the given frame. Returns whether it is still
+    // on its way.
+    static bool locate(const Route& route, std::uint64_t through, float& x, float& y) {
+        float dx = route.targetX - route.originX, dy = route.targetY - route.originY;
+        float distance = std::sqrt(dx * dx + dy * dy);
+        float travelled = CRUISE_SPEED * static_cast<float>(through - route.start);
+        if (!route.flying || travelled >= distance) {
+            x = route.flying ? route.targetX : route.originX;
+            y = route.flying ? route.targetY : route.originY;
+            return false;
+        }
+        x = route.originX + dx / distance * travelled;
+        y = route.originY + dy / distance * travelled;
+        return true;
+    }
+
+    // Puts a ship in LOD_ROUTE where its route has it after the given frame
+    void place(ShipId ship, std::uint64_t through, Fleet& fleet) {
+        Route route = currentRoute(ship, fleet);
+        float x, y;
+        bool flying = locate(route, through, x, y);
+        if (x != fleet.x[ship] || y != fleet.y[ship])
+            moved.push_back(ship);
+        fleet.x[ship] = x;
+        fleet.y[ship] = y;
+        if (flying) {
+            float dx = route.targetX - route.originX, dy = route.targetY - route.originY;
+            float length = std::sqrt(dx * dx + dy * dy);
+            fleet.headingX[ship] = dx / length;
+            fleet.headingY[ship] = dy / length;
+        } else {
+            // Arrived: wait there
+            fleet.hasTarget[ship] = 0;
+            route = Route{x, y, x, y, false, through, through};
+        }
+        route.placed = through;
+
+        // Into the sector it reached, route and all, shifted exactly as the Fleet
+        // shifts its target so that currentRoute() still matches them
+        SectorKey step = fleet.rehome(ship);
+        if (step.x != 0 || step.y != 0) {
+            float dx = static_cast<float>(step.x) * SECTOR_SIZE, dy = static_cast<float>(step.y) * SECTOR_SIZE;
+            route.originX -= dx;
+            route.originY -= dy;
+            route.targetX -= dx;
+            route.targetY -= dy;
+        }
+        routes[ship] = route;
+    }
+
+    void insert(std::vector<ShipId>& list, ShipId ship) {
+        slots[ship] = static_cast<std::uint32_t>(list.size());
+        list.push_back(ship);
+    }
+
+    // Takes a ship out of a list by moving the list's last ship into its place
+    void remove(std::vector<ShipId>& list, ShipId ship) {
+        ShipId moved = list.back();
+        list[slots[ship]] = moved;
+        slots[moved] = slots[ship];
+        list.pop_back();
+    }
+
+    StepRates reducedRates;
+    std::vector<LODTier> tiers;       // By ShipId
+    std::vector<std::uint32_t> slots; // Likewise: where in its tier's list
+    std::vector<std::uint8_t> phases; // Likewise: which of the reduced lists, for LOD_REDUCED
+    std::vector<Route> routes;        // Likewise, for LOD_ROUTE
+    std::vector<ShipId> full;
+    std::vector<ShipId> reduced[LOD_REDUCED_INTERVAL]; // By the frame they are updated in
+    std::vector<ShipId> slices[LOD_ASSESS_INTERVAL];   // Every ship, by the frame it is assessed in
+    std::size_t sectorCount = 0; // Ships in LOD_SECTOR
+    std::vector<ShipId> nearby;
+    std::vector<ShipId> moved;
+};
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef GALAXY_H
+#define GALAXY_H
+
+#include "CounterRandom.h"
+#include "Fleet.h"
+#include "GalaxyPosition.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const int NEAR_RADIUS = 1;                    // Sectors this close to the focus are updated every frame
+const int LOAD_RADIUS = 3;                    // Sectors this close are kept loaded
+const int UNLOAD_RADIUS = 4;                  // Sectors this far are saved and dropped
+const std::uint64_t COARSE_INTERVAL = 30;     // Frames between updates of the other loaded sectors
+const std::uint32_t TRAFFIC_PER_SECTOR = 200; // Ships a new sector is generated with
+
+// One sector's traffic: ships that fly between random points of the sector, in
+// coordinates from the sector's corner. They stay in their sector, so sectors never
+// need each other to update.
+//
+// A sector being saved also holds the game's own ships that were in it, parked (see
+// Galaxy): their IDs in the game's Fleet, the frame each was last brought up to, and
+// their kinematics.
+class Sector {
+public:
+    SectorKey key;
+    Fleet traffic;
+    std::uint64_t updatedFrame = 0; // Frame the traffic was last brought up to
+    std::vector<ShipId> residentIds;
+    std::vector<std::uint64_t> residentFrames;
+    Fleet residents;
+
+    // A sector nobody has visited: its traffic comes from the sector's own random
+    // stream, so it is the same every time
+    static std::unique_ptr<Sector> generate(std::uint64_t seed, SectorKey key, std::uint64_t frame) {
+        auto sector = std::make_unique<Sector>();
+        sector->key = key;
+        sector->updatedFrame = frame;
+        CounterRandom random(seed, key.hash());
+        for (std::uint32_t i = 0; i < TRAFFIC_PER_SECTOR; ++i)
+            sector->traffic.add(random.uniform(0.0f, SECTOR_SIZE), random.uniform(0.0f, SECTOR_SIZE), key);
+        return sector;
+    }
+
+    // Gives ships that arrived a new target within the sector. Random numbers come
+    // from a stream for the sector and the frame.
+    void retarget(std::uint64_t seed, std::uint64_t frame) {
+        CounterRandom random(seed, key.hash(), frame);
+        for (ShipId ship = 0; ship < traffic.size(); ++ship) {
+            if (!traffic.hasTarget[ship])
+                traffic.setTarget(ship, random.uniform(0.0f, SECTOR_SIZE), random.uniform(0.0f, SECTOR_SIZE));
+        }
+    }
+
+    // Layout (little-endian):
+    //   header     "SECT", uint32 version, int32 x, int32 y, uint64 updated frame, uint32 ships, uint32 residents
+    //   ships      one array per Fleet field, in field order, but for the sector
+    //   residents  uint32 IDs, uint64 frames, then their Fleet fields as for ships
+    // Version 1 files, from before the game's ships were parked with their sector, have
+    // no residents and 0 for their count. Written to a temporary file that then
+    // replaces the old one, so a crash while saving never leaves a half-written sector
+    // behind.
+    bool write(const std::string& filename) const {
+        std::string temporary = filename + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            if (!out) {
+                std::cerr << "Failed to write sector file: " << temporary << std::endl;
+                return false;
+            }
+            Header header{{'S', 'E', 'C', 'T'}, 2, key.x, key.y, updatedFrame,
+                          static_cast<std::uint32_t>(traffic.size()), static_cast<std::uint32_t>(residentIds.size())};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            writeFleet(out, traffic);
+            out.write(reinterpret_cast<const char*>(residentIds.data()), residentIds.size() * sizeof(ShipId));
+            out.write(reinterpret_cast<const char*>(residentFrames.data()),
+                      residentFrames.size() * sizeof(std::uint64_t));
+            writeFleet(out, residents);
+            if (!out) {
+                std::cerr << "Failed to write sector file: " << temporary << std::endl;
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, filename, error);
+        if (error) {
+            std::cerr << "Failed to replace sector file: " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Returns nullptr if the file is missing or not a sector file for key
+    static std::unique_ptr<Sector> read(const std::string& filename, SectorKey key) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in)
+            return nullptr;
+        Header header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "SECT", 4) != 0 ||
+            header.version < 1 || header.version > 2 || header.x != key.x || header.y != key.y ||
+            header.ships > 1u << 24 || (header.version > 1 && header.residents > 1u << 24)) {
+            std::cerr << "Not a supported sector file: " << filename << std::endl;
+            return nullptr;
+        }
+        std::uint32_t residentCount = header.version > 1 ? header.residents : 0;
+        auto sector = std::make_unique<Sector>();
+        sector->key = key;
+        sector->updatedFrame = header.updatedFrame;
+        readFleet(in, sector->traffic, header.ships, key);
+        sector->residentIds.resize(residentCount);
+        sector->residentFrames.resize(residentCount);
+        in.read(reinterpret_cast<char*>(sector->residentIds.data()), residentCount * sizeof(ShipId));
+        in.read(reinterpret_cast<char*>(sector->residentFrames.data()), residentCount * sizeof(std::uint64_t));
+        readFleet(in, sector->residents, residentCount, key);
+        if (!in) {
+            std::cerr << "Truncated sector file: " << filename << std::endl;
+            return nullptr;
+        }
+        return sector;
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::int32_t x, y;
+        std::uint64_t updatedFrame;
+        std::uint32_t ships;
+        std::uint32_t residents; // Version 2 on
+    };
+
+    // The Fleet's float arrays, in file order
+    template <typename F>
+    static auto floatFields(F& fleet) -> std::vector<decltype(&fleet.x)> {
+        return {&fleet.x,        &fleet.y,        &fleet.velocityX, &fleet.velocityY,
+                &fleet.headingX, &fleet.headingY, &fleet.targetX,   &fleet.targetY};
+    }
+
+    // Every field but the sector, which is the file's
+    static void writeFleet(std::ostream& out, const Fleet& fleet) {
+        for (const std::vector<float>* field : floatFields(fleet))
+            out.write(reinterpret_cast<const char*>(field->data()), field->size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(fleet.hasTarget.data()), fleet.hasTarget.size());
+    }
+
+    static void readFleet(std::istream& in, Fleet& fleet, std::uint32_t count, SectorKey key) {
+        for (std::uint32_t i = 0; i < count; ++i)
+            fleet.add(0.0f, 0.0f, key);
+        for (std::vector<float>* field : floatFields(fleet))
+            in.read(reinterpret_cast<char*>(field->data()), field->size() * sizeof(float));
+        in.read(reinterpret_cast<char*>(fleet.hasTarget.data()), fleet.hasTarget.size());
+    }
+};
+
+// Loads and saves sectors on a background thread, so that the game thread never waits
+// on the disk. Jobs run in the order they were queued, so loading a sector that is
+// still queued for saving reads what was saved.
+class SectorStreamer {
+public:
+    SectorStreamer(const std::string& directory, std::uint64_t seed) : directory(directory), seed(seed) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+            std::cerr << "Failed to create sector directory: " << directory << std::endl;
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    SectorStreamer(const SectorStreamer&) = delete;
+    SectorStreamer& operator=(const SectorStreamer&) = delete;
+
+    // Finishes every queued save first, and drops the queued loads
+    ~SectorStreamer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // The sector turns up in collect(): as saved, or generated if it never was
+    void load(SectorKey key, std::uint64_t frame) {
+        queue(Job{key, frame, nullptr});
+    }
+
+    // Drops a queued load. Returns false if it already started or finished.
+    bool cancelLoad(SectorKey key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = std::find_if(jobs.begin(), jobs.end(), [&](const Job& job) { return !job.sector && job.key == key; });
+        if (found == jobs.end())
+            return false;
+        jobs.erase(found);
+        --pending;
+        return true;
+    }
+
+    void save(std::unique_ptr<Sector> sector) {
+        SectorKey key = sector->key;
+        queue(Job{key, 0, std::move(sector)});
+    }
+
+    // Moves the sectors loaded so far into loaded, without waiting
+    void collect(std::vector<std::unique_ptr<Sector>>& loaded) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& sector : done)
+            loaded.push_back(std::move(sector));
+        done.clear();
+    }
+
+    // Jobs queued or running
+    std::size_t getPendingCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+private:
+    struct Job {
+        SectorKey key;
+        std::uint64_t frame;            // Load only: the frame a generated sector starts at
+        std::unique_ptr<Sector> sector; // Set to save, empty to load
+    };
+
+    std::string filename(SectorKey key) const {
+        return directory + "/sector_" + std::to_string(key.x) + "_" + std::to_string(key.y) + ".bin";
+    }
+
+    void queue(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stop || !jobs.empty(); });
+            if (jobs.empty())
+                return; // Stopping, with nothing left to save
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            bool stopping = stop;
+
+            lock.unlock();
+            std::unique_ptr<Sector> loaded;
+            if (job.sector) {
+                job.sector->write(filename(job.key));
+            } else if (!stopping) {
+                loaded = Sector::read(filename(job.key), job.key);
+                if (!loaded)
+                    loaded = Sector::generate(seed, job.key, job.frame);
+            }
+            lock.lock();
+
+            if (loaded)
+                done.push_back(std::move(loaded));
+            --pending;
+        }
+    }
+
+    std::string directory;
+    std::uint64_t seed;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    std::vector<std::unique_ptr<Sector>> done;
+    std::size_t pending = 0;
+    bool stop = false;
+    std::thread worker; // Last, so it starts after everything it uses
+};
+
+// The sectors around a focus, usually the player's sector, and every ship in them.
+// Sectors within NEAR_RADIUS are updated every frame with the full Fleet update; the
+// rest of those within LOAD_RADIUS every COARSE_INTERVAL frames with the coarse one,
+// catching up on all the frames in between at once. As the focus moves, sectors that
+// come within LOAD_RADIUS are requested from the streamer, and those beyond
+// UNLOAD_RADIUS are handed to it for saving; the gap between the two keeps a ship
+// flying along a sector border from loading and saving the same sectors over and over.
+//
+// The game's own ships are in the game's Fleet, each in a sector and with coordinates
+// from its corner like the traffic. Near the focus the game moves them itself, in
+// more detail than the traffic gets (see FleetLOD). Once one is in a sector beyond
+// NEAR_RADIUS the game hands it over with adoptShip(), and from then on it is moved
+// with its sector: by the coarse update whenever the sector is brought up to date,
+// and, when the sector is saved, parked in it. A parked ship's entry in the game's
+// Fleet is left as it was until the sector is loaded again and the ship's saved
+// kinematics replace it. releaseShip() hands a ship back, brought up to date, once its
+// sector is near the focus again. Each ship keeps the frame it was last brought up
+// to, as sectors do, so one that changes hands between two updates of its sector is
+// never moved twice for the same frames. A ship that flies into a sector that is not
+// loaded waits where it is until the sector loads.
+class Galaxy {
+public:
+    // Sectors are saved to and loaded from files in directory, which is created if
+    // need be. ships is the game's Fleet, that adoptShip() and releaseShip() refer to.
+    Galaxy(std::uint64_t seed, const std::string& directory, Fleet& ships)
+        : seed(seed), ships(ships), streamer(directory, seed) {}
+
+    // Saves every loaded sector
+    ~Galaxy() {
+        for (auto& entry : sectors)
+            streamer.save(std::move(entry.second));
+    }
+
+    SectorKey getFocus() const { return focus; }
+
+    // Moves the focus, and parks the galaxy's ships in the sectors it unloads
+    void setFocus(SectorKey key, std::uint64_t frame) {
+        focus = key;
+        parked.clear();
+        for (auto it = requested.begin(); it != requested.end();) {
+            SectorKey wanted = SectorKey::fromHash(*it);
+            if (wanted.distance(focus) > LOAD_RADIUS && streamer.cancelLoad(wanted))
+                it = requested.erase(it);
+            else
+                ++it;
+        }
+        // From the back, as parking a ship moves the last one into its place
+        for (std::size_t i = adopted.size(); i-- > 0;) {
+            ShipId ship = adopted[i];
+            if (ships.sector[ship].distance(focus) <= UNLOAD_RADIUS)
+                continue;
+            auto found = sectors.find(ships.sector[ship].hash());
+            if (found != sectors.end())
+                park(ship, *found->second);
+        }
+        for (auto it = sectors.begin(); it != sectors.end();) {
+            if (it->second->key.distance(focus) > UNLOAD_RADIUS) {
+                streamer.save(std::move(it->second));
+                it = sectors.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (std::int32_t y = focus.y - LOAD_RADIUS; y <= focus.y + LOAD_RADIUS; ++y) {
+            for (std::int32_t x = focus.x - LOAD_RADIUS; x <= focus.x + LOAD_RADIUS; ++x) {
+                SectorKey wanted{x, y};
+                if (!sectors.count(wanted.hash()) && requested.insert(wanted.hash()).second)
+                    streamer.load(wanted, frame);
+            }
+        }
+    }
+
+    void update(std::uint64_t frame, ThreadPool& pool) {
+        unparked.clear();
+        moved.clear();
+        streamer.collect(loaded);
+        for (auto& sector : loaded) {
+            requested.erase(sector->key.hash());
+            // A sector saved in an earlier run may have been saved at a later frame
+            sector->updatedFrame = std::min(sector->updatedFrame, frame);
+            // If the focus moved on while it loaded, the sector is dropped as it is: it
+            // still matches its file, or generates the same again
+            if (sector->key.distance(focus) <= UNLOAD_RADIUS) {
+                unpark(*sector);
+                sectors[sector->key.hash()] = std::move(sector);
+            }
+        }
+        loaded.clear();
+
+        due.clear();
+        for (auto& entry : sectors) {
+            Sector* sector = entry.second.get();
+            if (sector->key.distance(focus) <= NEAR_RADIUS || frame - sector->updatedFrame >= COARSE_INTERVAL)
+                due.push_back(sector);
+        }
+        // Sectors only touch their own ships, so they can update in any order
+        pool.parallelFor(due.size(), [&](std::size_t i) {
+            Sector& sector = *due[i];
+            std::uint64_t elapsed = frame - sector.updatedFrame;
+            sector.retarget(seed, frame);
+            if (sector.key.distance(focus) <= NEAR_RADIUS) {
+                if (elapsed > 1)
+                    sector.traffic.updateCoarse(0, sector.traffic.size(), static_cast<float>(elapsed - 1));
+                sector.traffic.update();
+            } else {
+                sector.traffic.updateCoarse(0, sector.traffic.size(), static_cast<float>(elapsed));
+            }
+            sector.updatedFrame = frame;
+        });
+
+        // The galaxy's ships, with their sectors that were brought up to date
+        for (ShipId ship : adopted) {
+            const Sector* sector = findSector(ships.sector[ship]);
+            if (sector && sector->updatedFrame == frame && records[ship].updatedFrame < frame) {
+                catchUp(ship, frame);
+                moved.push_back(ship);
+            }
+        }
+    }
+
+    // Takes over moving a game ship that is in a sector beyond NEAR_RADIUS. The ship
+    // must be up to date in the Fleet as of frame, counted as sectors count it.
+    void adoptShip(ShipId ship, std::uint64_t frame) {
+        if (ship >= records.size())
+            records.resize(ship + 1);
+        if (records[ship].custody != CUSTODY_GAME)
+            return;
+        records[ship] = ShipRecord{frame, static_cast<std::uint32_t>(adopted.size()), CUSTODY_GALAXY};
+        adopted.push_back(ship);
+    }
+
+    // Hands a ship back to the game, brought up to date as of frame. Returns false,
+    // and keeps the ship, while it is parked.
+    bool releaseShip(ShipId ship, std::uint64_t frame) {
+        if (ship >= records.size() || records[ship].custody == CUSTODY_GAME)
+            return true;
+        if (records[ship].custody == CUSTODY_PARKED)
+            return false;
+        catchUp(ship, frame);
+        removeAdopted(ship);
+        records[ship].custody = CUSTODY_GAME;
+        return true;
+    }
+
+    // Whether the ship is the galaxy's to move, parked or not
+    bool isAdopted(ShipId ship) const { return ship < records.size() && records[ship].custody != CUSTODY_GAME; }
+
+    bool isParked(ShipId ship) const { return ship < records.size() && records[ship].custody == CUSTODY_PARKED; }
+
+    // Ships parked by the last setFocus(), whose entries in the Fleet are stale until
+    // they come back
+    const std::vector<ShipId>& getParked() const { return parked; }
+
+    // Ships that came back with their sector in the last update()
+    const std::vector<ShipId>& getUnparked() const { return unparked; }
+
+    // The galaxy's ships that moved or came back in the last update()
+    const std::vector<ShipId>& getMoved() const { return moved; }
+
+    // Calls visit(x, y) for every ship in the sectors updated every frame, with
+    // coordinates from the focus sector's corner
+    template <typename Visit>
+    void forEachNearShip(Visit visit) const {
+        for (const auto& entry : sectors) {
+            const Sector& sector = *entry.second;
+            if (sector.key.distance(focus) > NEAR_RADIUS)
+                continue;
+            float offsetX = sector.key.offsetX(focus), offsetY = sector.key.offsetY(focus);
+            for (ShipId ship = 0; ship < sector.traffic.size(); ++ship)
+                visit(offsetX + sector.traffic.x[ship], offsetY + sector.traffic.y[ship]);
+        }
+    }
+
+    // The loaded sector, or nullptr
+    const Sector* findSector(SectorKey key) const {
+        auto found = sectors.find(key.hash());
+        return found == sectors.end() ? nullptr : found->second.get();
+    }
+
+    std::size_t getLoadedCount() const { return sectors.size(); }
+
+    // Sectors requested but not loaded yet
+    std::size_t getRequestedCount() const { return requested.size(); }
+
+    SectorStreamer& getStreamer() { return streamer; }
+
+private:
+    enum Custody : std::uint8_t {
+        CUSTODY_GAME,   // Moved by the game
+        CUSTODY_GALAXY, // Moved with its sector
+        CUSTODY_PARKED, // Saved with its sector
+    };
+
+    struct ShipRecord {
+        std::uint64_t updatedFrame = 0; // Frame the ship was last brought up to, while not the game's
+        std::uint32_t slot = 0;         // Where in adopted, while CUSTODY_GALAXY
+        Custody custody = CUSTODY_GAME;
+    };
+
+    // Moves a ship of the galaxy's with the coarse update, as far as it gets by frame
+    void catchUp(ShipId ship, std::uint64_t frame) {
+        ShipRecord& record = records[ship];
+        if (frame > record.updatedFrame) {
+            ships.updateCoarse(ship, ship + 1, static_cast<float>(frame - record.updatedFrame));
+            ships.rehome(ship);
+            record.updatedFrame = frame;
+        }
+    }
+
+    void park(ShipId ship, Sector& sector) {
+        ShipId resident = sector.residents.add(0.0f, 0.0f);
+        sector.residents.assign(resident, ships, ship);
+        sector.residentIds.push_back(ship);
+        sector.residentFrames.push_back(records[ship].updatedFrame);
+        removeAdopted(ship);
+        records[ship].custody = CUSTODY_PARKED;
+        parked.push_back(ship);
+    }
+
+    // Puts the sector's residents back in the Fleet. Only ships parked there in this
+    // run come back; residents of an earlier run's save are dropped.
+    void unpark(Sector& sector) {
+        for (std::size_t i = 0; i < sector.residentIds.size(); ++i) {
+            ShipId ship = sector.residentIds[i];
+            if (ship >= records.size() || records[ship].custody != CUSTODY_PARKED || ships.sector[ship] != sector.key)
+                continue;
+            ships.assign(ship, sector.residents, static_cast<ShipId>(i));
+            records[ship] = ShipRecord{sector.residentFrames[i], static_cast<std::uint32_t>(adopted.size()),
+                                       CUSTODY_GALAXY};
+            adopted.push_back(ship);
+            unparked.push_back(ship);
+            moved.push_back(ship);
+        }
+        sector.residentIds.clear();
+        sector.residentFrames.clear();
+        sector.residents = Fleet();
+    }
+
+    // Takes a ship out of adopted by moving the last one into its place
+    void removeAdopted(ShipId ship) {
+        ShipId last = adopted.back();
+        adopted[records[ship].slot] = last;
+        records[last].slot = records[ship].slot;
+        adopted.pop_back();
+    }
+
+    std::uint64_t seed;
+    Fleet& ships;
+    SectorKey focus{0, 0};
+    SectorStreamer streamer;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Sector>> sectors; // By SectorKey::hash()
+    std::unordered_set<std::uint64_t> requested;
+    std::vector<std::unique_ptr<Sector>> loaded; // Reused every frame
+    std::vector<Sector*> due;                    // Likewise
+    std::vector<ShipRecord> records;             // By ShipId
+    std::vector<ShipId> adopted;                 // Ships in CUSTODY_GALAXY
+    std::vector<ShipId> parked, unparked, moved;
+};
+
+#endif
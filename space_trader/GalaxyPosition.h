@@ -0,0 +1,115 @@
+#ifndef GALAXYPOSITION_H
+#define GALAXYPOSITION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+const float SECTOR_SIZE = 10000.0f; // Side of a sector, in world units
+
+// Which sector, counted from the sector at the galaxy's origin
+struct SectorKey {
+    std::int32_t x, y;
+
+    bool operator==(const SectorKey& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const SectorKey& other) const { return !(*this == other); }
+
+    std::uint64_t hash() const {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+    }
+
+    static SectorKey fromHash(std::uint64_t hash) {
+        return SectorKey{static_cast<std::int32_t>(hash >> 32), static_cast<std::int32_t>(hash & 0xffffffffu)};
+    }
+
+    // Distance in sectors, counting diagonal steps as one
+    int distance(const SectorKey& other) const { return std::max(std::abs(x - other.x), std::abs(y - other.y)); }
+
+    // Where this sector's corner is from origin's corner. Exact for sectors near each
+    // other; for sectors far apart, only as precise as a float that size.
+    float offsetX(const SectorKey& origin) const {
+        return static_cast<float>(static_cast<std::int64_t>(x) - origin.x) * SECTOR_SIZE;
+    }
+    float offsetY(const SectorKey& origin) const {
+        return static_cast<float>(static_cast<std::int64_t>(y) - origin.y) * SECTOR_SIZE;
+    }
+};
+
+// A point anywhere in the galaxy: the sector it is in, and float coordinates within
+// it. A float alone has about a unit of precision at 10^7 units from the origin; kept
+// within a sector, positions stay precise to a thousandth of a unit however far out
+// the sector is.
+struct GalaxyPosition {
+    SectorKey sector;
+    float x, y; // From the sector's corner, in [0, SECTOR_SIZE) once normalized
+
+    // Moves whole sectors from x and y into the sector key
+    void normalize() {
+        float sx = std::floor(x / SECTOR_SIZE), sy = std::floor(y / SECTOR_SIZE);
+        sector.x += static_cast<std::int32_t>(sx);
+        sector.y += static_cast<std::int32_t>(sy);
+        x -= sx * SECTOR_SIZE;
+        y -= sy * SECTOR_SIZE;
+    }
+
+    // Absolute coordinates, for display and distances across the galaxy
+    double galaxyX() const { return static_cast<double>(sector.x) * SECTOR_SIZE + x; }
+    double galaxyY() const { return static_cast<double>(sector.y) * SECTOR_SIZE + y; }
+};
+
+// Square cells laid over the whole galaxy for indexing things by position, a whole
+// number of them to a sector's side so that they line up with the sector borders.
+// Cells are counted from the galaxy's origin in 64 bits, so every cell of every sector
+// has coordinates of its own, and a point's cell follows from its sector and its
+// coordinates within it.
+class GalaxyCells {
+public:
+    struct Cell {
+        std::int64_t x, y;
+
+        bool operator==(const Cell& other) const { return x == other.x && y == other.y; }
+        bool operator!=(const Cell& other) const { return !(*this == other); }
+    };
+
+    struct CellHash {
+        std::size_t operator()(const Cell& cell) const {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(cell.x) * 0x9e3779b97f4a7c15ull) ^
+                                            static_cast<std::uint64_t>(cell.y));
+        }
+    };
+
+    // Cells about size wide: as near to it as fits a whole number of times in a sector
+    explicit GalaxyCells(float size)
+        : perSector(static_cast<int>(std::max(1L, std::lround(SECTOR_SIZE / size)))),
+          size(SECTOR_SIZE / static_cast<float>(perSector)) {}
+
+    float getSize() const { return size; }
+
+    // The cell, along one axis, of a coordinate from the corner of a sector. The
+    // coordinate may lie outside the sector.
+    std::int64_t cellOf(std::int32_t sector, float coordinate) const {
+        return static_cast<std::int64_t>(sector) * perSector + static_cast<std::int64_t>(std::floor(coordinate / size));
+    }
+
+    Cell cellOf(SectorKey sector, float x, float y) const { return Cell{cellOf(sector.x, x), cellOf(sector.y, y)}; }
+
+    // The sector, along one axis, that a cell is in
+    std::int32_t sectorOf(std::int64_t cell) const {
+        std::int64_t sector = cell / perSector;
+        return static_cast<std::int32_t>(cell % perSector < 0 ? sector - 1 : sector);
+    }
+
+    // Where the corner of the cell's sector is from the corner of another sector, along
+    // one axis
+    float sectorOffset(std::int64_t cell, std::int32_t sector) const {
+        return static_cast<float>(static_cast<std::int64_t>(sectorOf(cell)) - sector) * SECTOR_SIZE;
+    }
+
+private:
+    int perSector;
+    float size;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef MARKET_H
+#define MARKET_H
+
+#include "OrderBook.h"
+#include "TypeRegistry.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+typedef std::uint32_t StationId;
+
+struct Station {
+    std::string name;
+    float x, y; // From the corner of its sector
+    SectorKey sector;
+};
+
+// One entry of a market's order stream: everything that changes its books
+struct MarketOrder {
+    enum Type : std::uint8_t { SUBMIT, CANCEL };
+
+    Type type = SUBMIT;
+    StationId station = 0;
+    TypeId commodity = 0;
+    Side side = BUY;       // Submit only
+    ShipId ship = NO_SHIP; // Likewise
+    std::int32_t price = 0;
+    std::int32_t quantity = 0;
+    OrderId order = NO_ORDER; // Cancel only
+};
+
+// A fill, with where and what was traded
+struct Trade {
+    StationId station = 0;
+    TypeId commodity = 0;
+    Fill fill;
+};
+
+// An order book for every commodity at every station. Trades collect until the game
+// settles them, moving cargo and credits between the ships, and clears them.
+//
+// With journaling on, every submit and cancel is appended to a journal; it is off by
+// default, so a game that never reads the journal does not grow it forever. Matching
+// depends on nothing but the order stream, and order IDs are handed out in sequence
+// per book, so replaying a journal into a market with the same stations reproduces
+// the same order IDs and the same trades in the same order.
+class Market {
+public:
+    StationId addStation(const std::string& name, float x, float y, SectorKey sector = SectorKey{0, 0}) {
+        stations.push_back(Station{name, x, y, sector});
+        books.emplace_back();
+        return static_cast<StationId>(stations.size() - 1);
+    }
+
+    const Station& getStation(StationId station) const { return stations[station]; }
+
+    std::size_t getStationCount() const { return stations.size(); }
+
+    // The station nearest to (x, y) from the corner of sector; there must be at least one
+    StationId findStation(SectorKey sector, float x, float y) const {
+        StationId nearest = 0;
+        float nearestDistance = 0.0f;
+        for (StationId station = 0; station < stations.size(); ++station) {
+            const Station& candidate = stations[station];
+            float dx = candidate.x + candidate.sector.offsetX(sector) - x;
+            float dy = candidate.y + candidate.sector.offsetY(sector) - y;
+            float distance = dx * dx + dy * dy;
+            if (station == 0 || distance < nearestDistance) {
+                nearest = station;
+                nearestDistance = distance;
+            }
+        }
+        return nearest;
+    }
+
+    // Whether the station is one of this market's and the commodity a registered one
+    bool isValid(StationId station, TypeId commodity) const {
+        return station < stations.size() && commodity < commodities().size();
+    }
+
+    // ship is NO_SHIP for the station's own orders. Returns the resting order's ID, or
+    // NO_ORDER if the order filled completely or was rejected (see OrderBook::submit
+    // and isValid()). Rejected orders are not journaled.
+    OrderId submit(StationId station, TypeId commodity, Side side, ShipId ship, std::int32_t price,
+                   std::int32_t quantity) {
+        if (!isValid(station, commodity) || !OrderBook::isValid(price, quantity))
+            return NO_ORDER;
+        MarketOrder order{MarketOrder::SUBMIT, station, commodity, side, ship, price, quantity};
+        if (journaling)
+            journal.push_back(order);
+        return apply(order);
+    }
+
+    // Returns false if the order already filled or was cancelled, or there is no such book
+    bool cancel(StationId station, TypeId commodity, OrderId order) {
+        if (!isValid(station, commodity))
+            return false;
+        MarketOrder entry{MarketOrder::CANCEL, station, commodity};
+        entry.order = order;
+        if (journaling)
+            journal.push_back(entry);
+        return book(station, commodity).cancel(order);
+    }
+
+    // Applies a recorded order stream, recording it again if journaling is on. Orders
+    // for a station or commodity that isValid() rejects, as from a journal written for
+    // another market, are skipped; returns false if there were any.
+    bool replay(const std::vector<MarketOrder>& orders) {
+        bool valid = true;
+        for (const MarketOrder& order : orders) {
+            if (!isValid(order.station, order.commodity)) {
+                valid = false;
+                continue;
+            }
+            if (journaling)
+                journal.push_back(order);
+            apply(order);
+        }
+        return valid;
+    }
+
+    OrderBook& book(StationId station, TypeId commodity) {
+        std::vector<OrderBook>& stationBooks = books[station];
+        if (commodity >= stationBooks.size())
+            stationBooks.resize(commodity + 1);
+        return stationBooks[commodity];
+    }
+
+    // The book, or nullptr if no order for the commodity ever reached the station. Safe
+    // to call from several threads while nothing submits or cancels.
+    const OrderBook* findBook(StationId station, TypeId commodity) const {
+        return station < books.size() && commodity < books[station].size() ? &books[station][commodity] : nullptr;
+    }
+
+    // Trades since clearTrades(), in the order they happened
+    std::vector<Trade>& getTrades() { return trades; }
+    void clearTrades() { trades.clear(); }
+
+    // Whether submits and cancels from now on are journaled
+    void setJournaling(bool enabled) { journaling = enabled; }
+    bool isJournaling() const { return journaling; }
+
+    const std::vector<MarketOrder>& getJournal() const { return journal; }
+    void clearJournal() { journal.clear(); }
+
+    // One line per entry: "S station commodity side ship price quantity" or
+    // "C station commodity order"
+    void writeJournal(std::ostream& out) const {
+        for (const MarketOrder& order : journal) {
+            if (order.type == MarketOrder::SUBMIT)
+                out << "S " << order.station << ' ' << order.commodity << ' ' << (order.side == BUY ? 'B' : 'S') << ' '
+                    << order.ship << ' ' << order.price << ' ' << order.quantity << '\n';
+            else
+                out << "C " << order.station << ' ' << order.commodity << ' ' << order.order << '\n';
+        }
+    }
+
+    // Reads what writeJournal() wrote, leaving out submits that OrderBook would reject.
+    // Returns false at the first malformed entry.
+    static bool readJournal(std::istream& in, std::vector<MarketOrder>& orders) {
+        char type;
+        while (in >> type) {
+            MarketOrder order{type == 'S' ? MarketOrder::SUBMIT : MarketOrder::CANCEL};
+            if (!(in >> order.station >> order.commodity))
+                return false;
+            if (type == 'S') {
+                char side;
+                if (!(in >> side >> order.ship >> order.price >> order.quantity) || (side != 'B' && side != 'S'))
+                    return false;
+                order.side = side == 'B' ? BUY : SELL;
+                if (!OrderBook::isValid(order.price, order.quantity))
+                    continue;
+            } else if (type != 'C' || !(in >> order.order)) {
+                return false;
+            }
+            orders.push_back(order);
+        }
+        return in.eof();
+    }
+
+private:
+    OrderId apply(const MarketOrder& order) {
+        if (order.type == MarketOrder::CANCEL) {
+            book(order.station, order.commodity).cancel(order.order);
+            return NO_ORDER;
+        }
+        fills.clear();
+        OrderId id = book(order.station, order.commodity)
+                         .submit(order.side, order.ship, order.price, order.quantity, fills);
+        for (const Fill& fill : fills)
+            trades.push_back(Trade{order.station, order.commodity, fill});
+        return id;
+    }
+
+    std::vector<Station> stations;
+    std::vector<std::vector<OrderBook>> books; // By station, then commodity
+    std::vector<Fill> fills;                   // Scratch for one submit
+    std::vector<Trade> trades;
+    std::vector<MarketOrder> journal;
+    bool journaling = false;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for any number of producer threads and one consumer thread.
+//
+// Each cell carries a sequence number saying whose turn it is: a producer claims the
+// next write position with a compare-and-swap and publishes the cell by advancing its
+// sequence, and the consumer reads cells in order once their sequence says they are
+// full. Nobody ever waits on a lock, and a full ring makes push() fail instead of
+// blocking. T should be trivially copyable.
+template <typename T>
+class MpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscRing(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Safe from any thread. Returns false if the ring is full.
+    bool push(const T& value) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < position) {
+                return false; // The consumer has not emptied this cell yet
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only. Returns false if the ring is empty.
+    bool pop(T& value) {
+        Cell& cell = cells[head & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+            return false;
+        value = cell.value;
+        cell.sequence.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> tail{0}; // Next write position, shared by producers
+    alignas(64) std::size_t head = 0;             // Next read position, consumer only
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include "Fleet.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+enum Side : std::uint8_t { BUY, SELL };
+
+// Identifies a resting order: its sequence number in the high half, its slot in the
+// book's order pool in the low half
+typedef std::uint64_t OrderId;
+const OrderId NO_ORDER = 0;
+
+// One trade between a buy and a sell order, at the resting order's price
+struct Fill {
+    ShipId buyer;  // NO_SHIP for the station
+    ShipId seller; // Likewise
+    std::int32_t price;
+    std::int32_t quantity;
+};
+
+// Limit orders for one commodity at one station, matched by price-time priority: an
+// incoming order trades against the best opposite price first and, within a price,
+// against the oldest order first. Whatever is left of it then rests in the book.
+//
+// Each side is a vector of price levels sorted so the best price is at the back, and
+// each level is a FIFO list threaded through a pool of orders. Matching at the best
+// price therefore touches only the back of a vector, and a new price level is
+// usually inserted near the back. Cancelling looks up the order's level by price,
+// searching from the best, and unlinks the order in constant time. Nothing is
+// allocated once the pool and level vectors have grown.
+class OrderBook {
+public:
+    static bool isValid(std::int32_t price, std::int32_t quantity) { return price > 0 && quantity > 0; }
+
+    // Matches the order and rests any remainder. Appends the trades to fills and
+    // returns the resting order's ID, or NO_ORDER if it filled completely. An order
+    // without a positive price and quantity is rejected: nothing happens, and it
+    // returns NO_ORDER.
+    OrderId submit(Side side, ShipId ship, std::int32_t price, std::int32_t quantity, std::vector<Fill>& fills) {
+        if (!isValid(price, quantity))
+            return NO_ORDER;
+        std::vector<Level>& opposite = side == BUY ? asks : bids;
+        while (quantity > 0 && !opposite.empty() && crosses(side, price, opposite.back().price)) {
+            Level& level = opposite.back();
+            while (quantity > 0 && level.head != NONE) {
+                Order& resting = orders[level.head];
+                std::int32_t traded = std::min(quantity, resting.quantity);
+                fills.push_back(side == BUY ? Fill{ship, resting.ship, level.price, traded}
+                                            : Fill{resting.ship, ship, level.price, traded});
+                quantity -= traded;
+                resting.quantity -= traded;
+                level.quantity -= traded;
+                if (resting.quantity == 0)
+                    unlink(level, level.head);
+            }
+            if (level.head == NONE)
+                opposite.pop_back();
+        }
+        if (quantity == 0)
+            return NO_ORDER;
+
+        // Rest the remainder at the back of its price level
+        std::vector<Level>& own = side == BUY ? bids : asks;
+        auto better = [side](std::int32_t a, std::int32_t b) { return side == BUY ? a > b : a < b; };
+        // own runs from worst to best, so this is the first level at price or better
+        auto position = std::partition_point(own.begin(), own.end(),
+                                             [&](const Level& level) { return better(price, level.price); });
+        if (position == own.end() || position->price != price)
+            position = own.insert(position, Level{price, NONE, NONE, 0});
+
+        std::uint32_t slot = allocate();
+        Order& order = orders[slot];
+        order = Order{++sequence, ship, side, price, quantity, position->tail, NONE};
+        if (position->tail != NONE)
+            orders[position->tail].next = slot;
+        else
+            position->head = slot;
+        position->tail = slot;
+        position->quantity += quantity;
+        return (order.sequence << 32) | slot;
+    }
+
+    // Removes a resting order. Returns false if it already filled or was cancelled.
+    bool cancel(OrderId id) {
+        std::uint32_t slot = static_cast<std::uint32_t>(id & 0xffffffffu);
+        if (slot >= orders.size() || orders[slot].sequence != id >> 32 || orders[slot].quantity == 0)
+            return false;
+        const Order& order = orders[slot];
+        std::vector<Level>& own = order.side == BUY ? bids : asks;
+        auto level = std::find_if(own.rbegin(), own.rend(), [&](const Level& l) { return l.price == order.price; });
+        level->quantity -= order.quantity;
+        unlink(*level, slot);
+        if (level->head == NONE)
+            own.erase(std::next(level).base());
+        return true;
+    }
+
+    // What is left of a resting order, or 0 if it filled or was cancelled
+    std::int32_t getQuantity(OrderId id) const {
+        std::uint32_t slot = static_cast<std::uint32_t>(id & 0xffffffffu);
+        if (slot >= orders.size() || orders[slot].sequence != id >> 32)
+            return 0;
+        return orders[slot].quantity;
+    }
+
+    bool hasBid() const { return !bids.empty(); }
+    bool hasAsk() const { return !asks.empty(); }
+    std::int32_t getBestBid() const { return bids.back().price; }
+    std::int32_t getBestAsk() const { return asks.back().price; }
+    // Total quantity resting at the best price
+    std::int32_t getBidQuantity() const { return bids.back().quantity; }
+    std::int32_t getAskQuantity() const { return asks.back().quantity; }
+
+    std::size_t getLevelCount() const { return bids.size() + asks.size(); }
+
+private:
+    static constexpr std::uint32_t NONE = 0xffffffffu;
+
+    struct Order {
+        std::uint64_t sequence; // 0 while the slot is free
+        ShipId ship;
+        Side side;
+        std::int32_t price;
+        std::int32_t quantity;
+        std::uint32_t previous, next; // Within the price level
+    };
+
+    struct Level {
+        std::int32_t price;
+        std::uint32_t head, tail; // Oldest and newest order
+        std::int32_t quantity;
+    };
+
+    static bool crosses(Side side, std::int32_t price, std::int32_t opposite) {
+        return side == BUY ? price >= opposite : price <= opposite;
+    }
+
+    std::uint32_t allocate() {
+        if (!freeSlots.empty()) {
+            std::uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+        orders.emplace_back();
+        return static_cast<std::uint32_t>(orders.size() - 1);
+    }
+
+    void unlink(Level& level, std::uint32_t slot) {
+        Order& order = orders[slot];
+        if (order.previous != NONE)
+            orders[order.previous].next = order.next;
+        else
+            level.head = order.next;
+        if (order.next != NONE)
+            orders[order.next].previous = order.previous;
+        else
+            level.tail = order.previous;
+        order.sequence = 0;
+        order.quantity = 0;
+        freeSlots.push_back(slot);
+    }
+
+    std::vector<Level> bids; // Ascending price, best at the back
+    std::vector<Level> asks; // Descending price, best at the back
+    std::vector<Order> orders;
+    std::vector<std::uint32_t> freeSlots;
+    std::uint64_t sequence = 0;
+};
+
+#endif
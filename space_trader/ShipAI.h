@@ -0,0 +1,273 @@
+#ifndef SHIPAI_H
+#define SHIPAI_H
+
+#include "CounterRandom.h"
+#include "Fleet.h"
+#include "Market.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+#include "TypeRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int AI_DECISION_INTERVAL = 8; // Frames between two decisions of one ship
+const std::size_t AI_BATCH = 64;    // Ships decided per job
+const float DOCKING_DISTANCE = 30.0f;
+const float PURSUIT_RANGE = 300.0f;
+const float PURSUIT_LEAD = 10.0f; // Updates ahead of its prey a pirate aims
+const float WANDER_DISTANCE = 50.0f;
+const int CARGO_CAPACITY = 50; // Units of one commodity a trader buys at most
+
+enum AIRole : std::uint8_t {
+    AI_NONE, // Not controlled by the AI, such as the player
+    AI_TRADER,
+    AI_PIRATE,
+};
+
+enum AIAction : std::uint8_t {
+    AI_WANDER,  // Fly to random points nearby
+    AI_PURSUE,  // Chase the prey
+    AI_TO_BUY,  // Fly to the route's source
+    AI_BUY,     // Docked at the source: buy
+    AI_TO_SELL, // Fly to the route's destination
+    AI_SELL,    // Docked at the destination: sell
+};
+
+// Buying a commodity at one station to sell it at another
+struct TradeRoute {
+    StationId from = 0, to = 0;
+    TypeId commodity = 0;
+    std::int32_t buyPrice = 0; // Limit for buying
+    std::int32_t quantity = 0;
+};
+
+struct AIDecision {
+    AIAction action = AI_WANDER;
+    bool retarget = false; // Whether to fly to (targetX, targetY) from now on
+    float targetX = 0.0f, targetY = 0.0f; // From the corner of the ship's sector
+    TradeRoute route;
+    ShipId prey = NO_SHIP;
+};
+
+// What the AI needs to know about a ship besides its kinematics
+struct AIShipView {
+    int credits;
+    int cargo; // Of the commodity asked about
+};
+
+// Decides for every AI ship where to fly and when to trade: traders pick the most
+// profitable trade route per distance flown, pirates chase the nearest other ship in
+// range, and ships with nothing better to do wander.
+//
+// Decisions are time-sliced: a ship decides every AI_DECISION_INTERVAL frames, in the
+// frame its ID selects, and flies on its last target in between. A frame's decisions
+// run in parallel on the thread pool. They only read the Fleet, the Market and the
+// ships' own state as they were at the start of the frame, and draw random numbers
+// from the ship's own CounterRandom stream for that round, so a decision is the same
+// whichever thread makes it. The decisions are then applied on the calling thread in
+// ship order. The simulation therefore runs the same with any number of threads.
+//
+// Ships, stations and targets are in sectors, with coordinates from the sector's
+// corner; the AI compares them across sectors by the offset between the sectors, and
+// sets a ship's target from the corner of the ship's own sector, as the Fleet wants it.
+class ShipAI {
+public:
+    explicit ShipAI(std::uint64_t seed) : seed(seed) {}
+
+    void add(ShipId ship, AIRole role) {
+        if (ship >= roles.size()) {
+            roles.resize(ship + 1, AI_NONE);
+            decisions.resize(ship + 1);
+            enabled.resize(ship + 1, 1);
+        }
+        roles[ship] = role;
+        slices[ship % AI_DECISION_INTERVAL].push_back(ship);
+    }
+
+    AIRole getRole(ShipId ship) const { return ship < roles.size() ? roles[ship] : AI_NONE; }
+
+    // A disabled ship, such as one parked with an unloaded sector, makes no decisions
+    // until it is enabled again
+    void setEnabled(ShipId ship, bool enable) {
+        if (ship < enabled.size())
+            enabled[ship] = enable;
+    }
+
+    const AIDecision& getDecision(ShipId ship) const { return decisions[ship]; }
+
+    // Runs this frame's decisions. grid must hold the Fleet's current positions.
+    // view(ship, commodity) returns an AIShipView, and is called from several threads
+    // at once. act(ship, decision) carries out AI_BUY and AI_SELL on the market, and is
+    // called on this thread in ship order.
+    template <typename View, typename Act>
+    void update(std::uint64_t frame, ThreadPool& pool, Fleet& fleet, const SpatialGrid& grid, const Market& market,
+                View view, Act act) {
+        const std::vector<ShipId>& slice = slices[frame % AI_DECISION_INTERVAL];
+        std::uint64_t round = frame / AI_DECISION_INTERVAL;
+        pool.parallelFor((slice.size() + AI_BATCH - 1) / AI_BATCH, [&](std::size_t batch) {
+            std::size_t end = std::min(slice.size(), (batch + 1) * AI_BATCH);
+            for (std::size_t i = batch * AI_BATCH; i < end; ++i) {
+                ShipId ship = slice[i];
+                if (enabled[ship])
+                    decisions[ship] = decide(ship, fleet, grid, market, view, CounterRandom(seed, ship, round));
+            }
+        });
+
+        for (ShipId ship : slice) {
+            if (!enabled[ship])
+                continue;
+            const AIDecision& decision = decisions[ship];
+            if (decision.retarget)
+                fleet.setTarget(ship, decision.targetX, decision.targetY);
+            if (decision.action == AI_BUY || decision.action == AI_SELL)
+                act(ship, decision);
+        }
+    }
+
+private:
+    // The ship's next decision. Reads, but writes nothing except the ship's decision.
+    template <typename View>
+    AIDecision decide(ShipId ship, const Fleet& fleet, const SpatialGrid& grid, const Market& market, View& view,
+                      CounterRandom random) const {
+        AIDecision next = decisions[ship];
+        next.retarget = false;
+        if (roles[ship] == AI_PIRATE) {
+            ShipId prey = findPrey(ship, fleet, grid);
+            if (prey == NO_SHIP)
+                return wander(ship, next, fleet, random);
+            SectorKey sector = fleet.sector[ship];
+            next.action = AI_PURSUE;
+            next.prey = prey;
+            next.retarget = true;
+            next.targetX = fleet.x[prey] + fleet.sector[prey].offsetX(sector) + fleet.velocityX[prey] * PURSUIT_LEAD;
+            next.targetY = fleet.y[prey] + fleet.sector[prey].offsetY(sector) + fleet.velocityY[prey] * PURSUIT_LEAD;
+            return next;
+        }
+
+        switch (next.action) {
+        case AI_TO_BUY:
+            if (docked(ship, fleet, market.getStation(next.route.from)))
+                next.action = AI_BUY;
+            return next;
+        case AI_BUY:
+            // Sell whatever the ship holds of the commodity, bought or not
+            if (view(ship, next.route.commodity).cargo > 0) {
+                next.action = AI_TO_SELL;
+                flyTo(next, fleet.sector[ship], market.getStation(next.route.to));
+                return next;
+            }
+            break;
+        case AI_TO_SELL:
+            if (docked(ship, fleet, market.getStation(next.route.to)))
+                next.action = AI_SELL;
+            return next;
+        default:
+            break;
+        }
+
+        if (planRoute(ship, fleet, market, view, next.route)) {
+            next.action = AI_TO_BUY;
+            flyTo(next, fleet.sector[ship], market.getStation(next.route.from));
+            return next;
+        }
+        return wander(ship, next, fleet, random);
+    }
+
+    // Picks the route with the most profit per distance flown, between the best ask at
+    // one station and the best bid at another. Returns false if none makes a profit.
+    template <typename View>
+    bool planRoute(ShipId ship, const Fleet& fleet, const Market& market, View& view, TradeRoute& route) const {
+        float x = fleet.x[ship], y = fleet.y[ship];
+        SectorKey sector = fleet.sector[ship];
+        float bestScore = 0.0f;
+        for (TypeId commodity = 0; commodity < commodities().size(); ++commodity) {
+            int credits = view(ship, commodity).credits;
+            for (StationId from = 0; from < market.getStationCount(); ++from) {
+                const OrderBook* source = market.findBook(from, commodity);
+                if (!source || !source->hasAsk())
+                    continue;
+                std::int32_t ask = source->getBestAsk();
+                std::int32_t affordable = std::min({source->getAskQuantity(), credits / ask, CARGO_CAPACITY});
+                if (affordable <= 0)
+                    continue;
+                const Station& fromStation = market.getStation(from);
+                float approach = std::hypot(fromStation.x + fromStation.sector.offsetX(sector) - x,
+                                            fromStation.y + fromStation.sector.offsetY(sector) - y);
+
+                for (StationId to = 0; to < market.getStationCount(); ++to) {
+                    const OrderBook* destination = market.findBook(to, commodity);
+                    if (to == from || !destination || !destination->hasBid() || destination->getBestBid() <= ask)
+                        continue;
+                    std::int32_t quantity = std::min(affordable, destination->getBidQuantity());
+                    const Station& toStation = market.getStation(to);
+                    float distance =
+                            approach + std::hypot(toStation.x + toStation.sector.offsetX(fromStation.sector) - fromStation.x,
+                                                  toStation.y + toStation.sector.offsetY(fromStation.sector) - fromStation.y);
+                    float score = static_cast<float>((destination->getBestBid() - ask) * quantity) / (distance + 1.0f);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        route = TradeRoute{from, to, commodity, ask, quantity};
+                    }
+                }
+            }
+        }
+        return bestScore > 0.0f;
+    }
+
+    // The nearest ship in PURSUIT_RANGE that is not a pirate, or NO_SHIP. Of two as
+    // near, the one with the lower ID, whatever order the grid lists them in.
+    ShipId findPrey(ShipId ship, const Fleet& fleet, const SpatialGrid& grid) const {
+        float x = fleet.x[ship], y = fleet.y[ship];
+        SectorKey sector = fleet.sector[ship];
+        std::vector<ShipId> nearby;
+        grid.queryRadius(sector, x, y, PURSUIT_RANGE, nearby, ship);
+        float nearest = PURSUIT_RANGE * PURSUIT_RANGE;
+        ShipId prey = NO_SHIP;
+        for (ShipId other : nearby) {
+            if (getRole(other) == AI_PIRATE)
+                continue;
+            float dx = fleet.x[other] + fleet.sector[other].offsetX(sector) - x;
+            float dy = fleet.y[other] + fleet.sector[other].offsetY(sector) - y;
+            float distance = dx * dx + dy * dy;
+            if (distance < nearest || (distance == nearest && other < prey)) {
+                nearest = distance;
+                prey = other;
+            }
+        }
+        return prey;
+    }
+
+    AIDecision wander(ShipId ship, AIDecision next, const Fleet& fleet, CounterRandom& random) const {
+        if (next.action == AI_WANDER && fleet.hasTarget[ship])
+            return next;
+        next.action = AI_WANDER;
+        next.retarget = true;
+        next.targetX = fleet.x[ship] + random.uniform(-WANDER_DISTANCE, WANDER_DISTANCE);
+        next.targetY = fleet.y[ship] + random.uniform(-WANDER_DISTANCE, WANDER_DISTANCE);
+        return next;
+    }
+
+    static bool docked(ShipId ship, const Fleet& fleet, const Station& station) {
+        float dx = station.x + station.sector.offsetX(fleet.sector[ship]) - fleet.x[ship];
+        float dy = station.y + station.sector.offsetY(fleet.sector[ship]) - fleet.y[ship];
+        return dx * dx + dy * dy <= DOCKING_DISTANCE * DOCKING_DISTANCE;
+    }
+
+    // Targets the station, from the corner of the ship's sector
+    static void flyTo(AIDecision& decision, SectorKey sector, const Station& station) {
+        decision.retarget = true;
+        decision.targetX = station.x + station.sector.offsetX(sector);
+        decision.targetY = station.y + station.sector.offsetY(sector);
+    }
+
+    std::uint64_t seed;
+    std::vector<AIRole> roles;         // By ShipId
+    std::vector<AIDecision> decisions; // Likewise
+    std::vector<std::uint8_t> enabled; // Likewise
+    std::vector<ShipId> slices[AI_DECISION_INTERVAL]; // AI ships by the frame they decide in
+};
+
+#endif
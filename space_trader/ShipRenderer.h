@@ -0,0 +1,136 @@
+#ifndef SHIPRENDERER_H
+#define SHIPRENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include "Fleet.h"
+#include "TypeRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ship Component System
+struct Component {
+    TypeId type; // From componentTypes()
+    sf::Vector2f position;
+    float rotation;
+    sf::Vector2f size;
+};
+
+inline sf::Color componentColor(TypeId type) {
+    if (type == COMPONENT_HULL)
+        return sf::Color::Green;
+    if (type == COMPONENT_THRUSTER)
+        return sf::Color::Red;
+    return sf::Color::White;
+}
+
+// Draws the components of every ship in the Fleet as rotated rectangles, in one draw
+// call from one persistent vertex array.
+//
+// Each component's corners are computed once, in ship-local space, when the ship's
+// components are set. Per frame only the ship transform is applied: a ship's heading
+// is already a unit vector, so rotating a corner is two multiply-adds per axis with no
+// trig, and the vertex colors never change.
+class ShipRenderer {
+public:
+    ShipRenderer() : vertices(sf::Triangles) {}
+
+    // Replaces a ship's components. Offsets and rotations are relative to the ship,
+    // which faces along +x.
+    void setComponents(ShipId ship, const std::vector<Component>& components) {
+        if (ship >= shapes.size())
+            shapes.resize(ship + 1);
+        std::vector<LocalQuad>& quads = shapes[ship];
+        quads.clear();
+        for (const Component& component : components) {
+            float c = std::cos(component.rotation * PI / 180), s = std::sin(component.rotation * PI / 180);
+            float halfX = component.size.x / 2, halfY = component.size.y / 2;
+            const float corners[4][2] = {{-halfX, -halfY}, {halfX, -halfY}, {halfX, halfY}, {-halfX, halfY}};
+            LocalQuad quad;
+            for (int i = 0; i < 4; ++i) {
+                quad.x[i] = component.position.x + corners[i][0] * c - corners[i][1] * s;
+                quad.y[i] = component.position.y + corners[i][0] * s + corners[i][1] * c;
+            }
+            quad.color = componentColor(component.type);
+            quads.push_back(quad);
+        }
+        dirty = true;
+    }
+
+    std::size_t getQuadCount() const { return cornerX.size() / 4; }
+
+    // Draws the ships at their positions from the corner of the origin sector, usually
+    // the one the camera is in
+    void draw(sf::RenderTarget& target, const Fleet& fleet, SectorKey origin) {
+        if (dirty)
+            rebuild();
+        std::size_t ships = std::min(fleet.size(), shapes.size());
+        const float* px = fleet.x.data();
+        const float* py = fleet.y.data();
+        const float* hx = fleet.headingX.data();
+        const float* hy = fleet.headingY.data();
+        const float* lx = cornerX.data();
+        const float* ly = cornerY.data();
+
+        for (std::size_t ship = 0; ship < ships; ++ship) {
+            float x = px[ship] + fleet.sector[ship].offsetX(origin), y = py[ship] + fleet.sector[ship].offsetY(origin);
+            float c = hx[ship], s = hy[ship];
+            for (std::uint32_t quad = firstQuad[ship]; quad < firstQuad[ship + 1]; ++quad) {
+                sf::Vector2f world[4];
+                for (int i = 0; i < 4; ++i) {
+                    std::size_t corner = quad * 4 + i;
+                    world[i] = sf::Vector2f(x + lx[corner] * c - ly[corner] * s, y + lx[corner] * s + ly[corner] * c);
+                }
+                sf::Vertex* v = &vertices[quad * 6];
+                v[0].position = world[0];
+                v[1].position = world[1];
+                v[2].position = world[2];
+                v[3].position = world[0];
+                v[4].position = world[2];
+                v[5].position = world[3];
+            }
+        }
+        target.draw(vertices);
+    }
+
+private:
+    struct LocalQuad {
+        float x[4];
+        float y[4];
+        sf::Color color;
+    };
+
+    // Flattens every ship's quads into the arrays draw() walks, and sizes and colors the
+    // vertex array once
+    void rebuild() {
+        cornerX.clear();
+        cornerY.clear();
+        firstQuad.assign(1, 0);
+        std::vector<sf::Color> colors;
+        for (const std::vector<LocalQuad>& quads : shapes) {
+            for (const LocalQuad& quad : quads) {
+                cornerX.insert(cornerX.end(), quad.x, quad.x + 4);
+                cornerY.insert(cornerY.end(), quad.y, quad.y + 4);
+                colors.push_back(quad.color);
+            }
+            firstQuad.push_back(static_cast<std::uint32_t>(colors.size()));
+        }
+        vertices.resize(colors.size() * 6);
+        for (std::size_t quad = 0; quad < colors.size(); ++quad)
+            for (int i = 0; i < 6; ++i)
+                vertices[quad * 6 + i].color = colors[quad];
+        dirty = false;
+    }
+
+    std::vector<std::vector<LocalQuad>> shapes; // Per ship
+    bool dirty = false;
+
+    // Flattened ship-local corners, four per quad, and each ship's first quad
+    std::vector<float> cornerX, cornerY;
+    std::vector<std::uint32_t> firstQuad;
+    sf::VertexArray vertices;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include "Fleet.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One query of a batch: around (x, y) from the corner of sector, within radius,
+// leaving out one ship (usually the one asking)
+struct ProximityQuery {
+    SectorKey sector;
+    float x, y;
+    float radius;
+    ShipId except = NO_SHIP;
+};
+
+// Spatial hash over ship positions for proximity queries: docking, trading range,
+// targeting, collision.
+//
+// Ships are binned into square cells kept in a hash map, so only cells that hold ships
+// cost memory and the world needs no bounds. The cells line up with the sector borders
+// (see GalaxyCells), and each cell stores its ships' positions from the corner of its
+// own sector as well as their IDs, so a query reads one contiguous array per cell
+// instead of chasing ships through the Fleet, and compares positions across sectors
+// by adding the offset between the cell's sector and its own. update() is
+// incremental: a ship that stays in its cell only has its position refreshed, through
+// a pointer to its cell, and only the ships that crossed into another cell are moved,
+// by swapping them out of the old cell in constant time. When only some ships moved,
+// as under FleetLOD, the grid can be told just those.
+//
+// Queries only read, so any number of threads can run them at once between updates;
+// the batch versions spread a list of queries over a ThreadPool.
+class SpatialGrid {
+public:
+    // Cells are about cellSize wide, rounded so that a whole number fit in a sector
+    explicit SpatialGrid(float cellSize = 256.0f) : grid(cellSize) {}
+
+    // Brings the grid up to date with the positions of every ship in the Fleet. Ships
+    // are only ever added, so the Fleet never shrinks.
+    void update(const Fleet& fleet) {
+        lastMoves = 0;
+        locations.resize(fleet.size());
+        bounds = CellBounds{0, 0, -1, -1};
+        for (ShipId ship = 0; ship < fleet.size(); ++ship)
+            place(ship, fleet.sector[ship], fleet.x[ship], fleet.y[ship]);
+    }
+
+    // Brings the grid up to date with the positions of the given ships, and of any
+    // added to the Fleet since the last update, for when only those moved. Ships taken
+    // out by remove() are put back. The bounds only grow here, so queries may visit a
+    // few more empty cells until the next full update().
+    void update(const Fleet& fleet, const std::vector<ShipId>& ships) {
+        lastMoves = 0;
+        std::size_t known = locations.size();
+        locations.resize(fleet.size());
+        for (ShipId ship : ships) {
+            if (ship < known)
+                place(ship, fleet.sector[ship], fleet.x[ship], fleet.y[ship]);
+        }
+        for (std::size_t ship = known; ship < fleet.size(); ++ship)
+            place(static_cast<ShipId>(ship), fleet.sector[ship], fleet.x[ship], fleet.y[ship]);
+    }
+
+    // Takes a ship out of the grid, such as one parked with an unloaded sector, until
+    // an update() lists it again
+    void remove(ShipId ship) {
+        if (ship < locations.size() && locations[ship].cell) {
+            removeEntry(ship);
+            locations[ship].cell = nullptr;
+        }
+    }
+
+    // Appends the ships within radius of (x, y) from the corner of sector, cell by cell
+    void queryRadius(SectorKey sector, float x, float y, float radius, std::vector<ShipId>& out,
+                     ShipId except = NO_SHIP) const {
+        std::int64_t x0 = grid.cellOf(sector.x, x - radius), x1 = grid.cellOf(sector.x, x + radius);
+        std::int64_t y0 = grid.cellOf(sector.y, y - radius), y1 = grid.cellOf(sector.y, y + radius);
+        float radiusSquared = radius * radius;
+        for (std::int64_t cy = std::max(y0, bounds.y0); cy <= std::min(y1, bounds.y1); ++cy) {
+            float offsetY = grid.sectorOffset(cy, sector.y) - y;
+            for (std::int64_t cx = std::max(x0, bounds.x0); cx <= std::min(x1, bounds.x1); ++cx) {
+                auto found = cells.find(GalaxyCells::Cell{cx, cy});
+                if (found == cells.end())
+                    continue;
+                float offsetX = grid.sectorOffset(cx, sector.x) - x;
+                for (const Entry& entry : found->second) {
+                    float dx = entry.x + offsetX, dy = entry.y + offsetY;
+                    if (dx * dx + dy * dy <= radiusSquared && entry.id != except)
+                        out.push_back(entry.id);
+                }
+            }
+        }
+    }
+
+    // Replaces out with the k ships nearest to (x, y) from the corner of sector, within
+    // maxDistance, nearest first. Searches rings of cells outward from (x, y) and stops
+    // once no unsearched cell can hold a nearer ship.
+    void queryNearest(SectorKey sector, float x, float y, std::size_t k, std::vector<ShipId>& out,
+                      ShipId except = NO_SHIP, float maxDistance = std::numeric_limits<float>::max()) const {
+        out.clear();
+        if (k == 0 || bounds.x0 > bounds.x1)
+            return;
+        // Max-heap on (distance squared, ID), so the worst candidate is on top and ties
+        // break the same way every time
+        std::vector<std::pair<float, ShipId>> best;
+        best.reserve(k + 1);
+        float limit = maxDistance < std::numeric_limits<float>::max() ? maxDistance * maxDistance
+                                                                      : std::numeric_limits<float>::max();
+        std::int64_t qx = grid.cellOf(sector.x, x), qy = grid.cellOf(sector.y, y);
+        std::int64_t lastRing = std::max({qx - bounds.x0, bounds.x1 - qx, qy - bounds.y0, bounds.y1 - qy});
+        for (std::int64_t ring = 0; ring <= lastRing; ++ring) {
+            // Everything in this ring and beyond is at least this far away
+            float reach = static_cast<float>(ring - 1) * grid.getSize();
+            if (ring > 0 && reach * reach > limit)
+                break;
+            if (best.size() == k && ring > 0 && reach * reach >= best.front().first)
+                break;
+            for (std::int64_t cy = qy - ring; cy <= qy + ring; ++cy) {
+                // Only the ring's border: all of its top and bottom rows, the two ends
+                // of the rows between
+                std::int64_t step = cy == qy - ring || cy == qy + ring ? 1 : std::max<std::int64_t>(1, 2 * ring);
+                float offsetY = grid.sectorOffset(cy, sector.y) - y;
+                for (std::int64_t cx = qx - ring; cx <= qx + ring; cx += step) {
+                    auto found = cells.find(GalaxyCells::Cell{cx, cy});
+                    if (found == cells.end())
+                        continue;
+                    float offsetX = grid.sectorOffset(cx, sector.x) - x;
+                    for (const Entry& entry : found->second) {
+                        float dx = entry.x + offsetX, dy = entry.y + offsetY;
+                        std::pair<float, ShipId> candidate(dx * dx + dy * dy, entry.id);
+                        if (candidate.first > limit || entry.id == except)
+                            continue;
+                        if (best.size() < k) {
+                            best.push_back(candidate);
+                            std::push_heap(best.begin(), best.end());
+                        } else if (candidate < best.front()) {
+                            std::pop_heap(best.begin(), best.end());
+                            best.back() = candidate;
+                            std::push_heap(best.begin(), best.end());
+                        }
+                    }
+                }
+            }
+        }
+        std::sort_heap(best.begin(), best.end());
+        for (const auto& candidate : best)
+            out.push_back(candidate.second);
+    }
+
+    // One queryRadius() per query, into the matching vector of results
+    void queryRadius(const std::vector<ProximityQuery>& queries, ThreadPool& pool,
+                     std::vector<std::vector<ShipId>>& results) const {
+        results.resize(queries.size());
+        forEachBatch(queries.size(), pool, [&](std::size_t i) {
+            const ProximityQuery& query = queries[i];
+            results[i].clear();
+            queryRadius(query.sector, query.x, query.y, query.radius, results[i], query.except);
+        });
+    }
+
+    // One queryNearest() per query, with the query's radius as the maximum distance
+    void queryNearest(const std::vector<ProximityQuery>& queries, std::size_t k, ThreadPool& pool,
+                      std::vector<std::vector<ShipId>>& results) const {
+        results.resize(queries.size());
+        forEachBatch(queries.size(), pool, [&](std::size_t i) {
+            const ProximityQuery& query = queries[i];
+            queryNearest(query.sector, query.x, query.y, k, results[i], query.except, query.radius);
+        });
+    }
+
+    std::size_t getCellCount() const { return cells.size(); }
+
+    // Ships that changed cells in the last update()
+    std::size_t getLastMoves() const { return lastMoves; }
+
+private:
+    static constexpr std::size_t BATCH = 256; // Queries per job
+
+    struct Entry {
+        float x, y; // From the corner of the cell's sector
+        ShipId id;
+    };
+
+    struct Location {
+        std::vector<Entry>* cell = nullptr; // Map nodes never move, so this stays valid; null while not in the grid
+        GalaxyCells::Cell key{0, 0};
+        std::uint32_t slot = 0;
+    };
+
+    // Cells that held a ship at the last update, inclusive; empty while x0 > x1
+    struct CellBounds {
+        std::int64_t x0, y0, x1, y1;
+
+        void add(const GalaxyCells::Cell& cell) {
+            if (x0 > x1) {
+                *this = CellBounds{cell.x, cell.y, cell.x, cell.y};
+                return;
+            }
+            x0 = std::min(x0, cell.x);
+            y0 = std::min(y0, cell.y);
+            x1 = std::max(x1, cell.x);
+            y1 = std::max(y1, cell.y);
+        }
+    };
+
+    // Files a ship at (x, y) from the corner of sector: refreshes its entry if it
+    // stayed in its cell, or moves it to its new one
+    void place(ShipId ship, SectorKey sector, float x, float y) {
+        GalaxyCells::Cell key = grid.cellOf(sector, x, y);
+        bounds.add(key);
+        // From the corner of the cell's sector, which is the ship's own unless the
+        // ship has flown out of it
+        x -= grid.sectorOffset(key.x, sector.x);
+        y -= grid.sectorOffset(key.y, sector.y);
+        Location& location = locations[ship];
+        if (location.cell && location.key == key) {
+            Entry& entry = (*location.cell)[location.slot];
+            entry.x = x;
+            entry.y = y;
+            return;
+        }
+        if (location.cell) {
+            removeEntry(ship);
+            ++lastMoves;
+        }
+        std::vector<Entry>& cell = cells[key];
+        location = Location{&cell, key, static_cast<std::uint32_t>(cell.size())};
+        cell.push_back(Entry{x, y, ship});
+    }
+
+    // Takes a ship out of its cell by moving the cell's last entry into its place
+    void removeEntry(ShipId ship) {
+        const Location& location = locations[ship];
+        std::vector<Entry>& cell = *location.cell;
+        Entry moved = cell.back();
+        cell[location.slot] = moved;
+        cell.pop_back();
+        if (moved.id != ship)
+            locations[moved.id].slot = location.slot;
+        if (cell.empty())
+            cells.erase(location.key);
+    }
+
+    template <typename Body>
+    static void forEachBatch(std::size_t count, ThreadPool& pool, Body body) {
+        pool.parallelFor((count + BATCH - 1) / BATCH, [&](std::size_t batch) {
+            std::size_t end = std::min(count, (batch + 1) * BATCH);
+            for (std::size_t i = batch * BATCH; i < end; ++i)
+                body(i);
+        });
+    }
+
+    GalaxyCells grid;
+    std::unordered_map<GalaxyCells::Cell, std::vector<Entry>, GalaxyCells::CellHash> cells;
+    std::vector<Location> locations; // By ShipId
+    CellBounds bounds{0, 0, -1, -1};
+    std::size_t lastMoves = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run parallel loops: batches of AI decisions and of
+// proximity queries, and the sectors due an update. Items are handed out one at a time
+// from a shared counter, so uneven work (a batch of traders weighing routes next to one
+// of idle wanderers, a crowded sector next to an empty one) still keeps every thread
+// busy. The calling thread works too, so a pool of one thread has no workers and runs
+// loops inline.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        for (unsigned i = 1; i < threadCount; ++i)
+            m_workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+    // Calls body(i) for every i in [0, count) and returns once all calls have finished.
+    // Not reentrant: body must not call parallelFor on the same pool.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body) {
+        if (m_workers.empty() || count < 2) {
+            for (std::size_t i = 0; i < count; ++i)
+                body(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_body = &body;
+            m_count = count;
+            m_next = 0;
+            m_active = m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        runItems(body, count);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_active == 0; });
+        m_body = nullptr;
+    }
+
+private:
+    void runItems(const std::function<void(std::size_t)>& body, std::size_t count) {
+        for (std::size_t i = m_next.fetch_add(1); i < count; i = m_next.fetch_add(1))
+            body(i);
+    }
+
+    void workerLoop() {
+        std::uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop)
+                return;
+            seenGeneration = m_generation;
+            const std::function<void(std::size_t)>* body = m_body;
+            std::size_t count = m_count;
+
+            lock.unlock();
+            runItems(*body, count);
+            lock.lock();
+
+            if (--m_active == 0)
+                m_done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_stop = false;
+
+    // Current loop, guarded by m_mutex except for the item counter
+    const std::function<void(std::size_t)>* m_body = nullptr;
+    std::size_t m_count = 0;
+    std::atomic<std::size_t> m_next{0};
+    std::size_t m_active = 0;
+    std::uint64_t m_generation = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TYPEREGISTRY_H
+#define TYPEREGISTRY_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::uint16_t TypeId;
+
+// Interns type names to small dense IDs, in order of first registration. Names are
+// looked up only where they come from outside (setup, UI, loading); everything that
+// runs per frame or per trade works with the IDs, so it neither compares nor copies
+// strings and can index plain arrays by type.
+class TypeRegistry {
+public:
+    TypeRegistry(std::initializer_list<const char*> names) {
+        for (const char* name : names)
+            intern(name);
+    }
+
+    // The name's ID, registering it if it is new
+    TypeId intern(const std::string& name) {
+        auto found = ids.find(name);
+        if (found != ids.end())
+            return found->second;
+        TypeId id = static_cast<TypeId>(names.size());
+        names.push_back(name);
+        ids.emplace(name, id);
+        return id;
+    }
+
+    const std::string& getName(TypeId id) const { return names[id]; }
+
+    std::size_t size() const { return names.size(); }
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, TypeId> ids;
+};
+
+// Component types, with the IDs of the built-in ones in registration order
+const TypeId COMPONENT_HULL = 0;
+const TypeId COMPONENT_THRUSTER = 1;
+
+inline TypeRegistry& componentTypes() {
+    static TypeRegistry registry{"HULL", "THRUSTER"};
+    return registry;
+}
+
+// Commodities carried as cargo, likewise
+const TypeId COMMODITY_FUEL = 0;
+const TypeId COMMODITY_FOOD = 1;
+const TypeId COMMODITY_METAL = 2;
+
+inline TypeRegistry& commodities() {
+    static TypeRegistry registry{"Fuel", "Food", "Metal"};
+    return registry;
+}
+
+#endif
@@ -0,0 +1,144 @@
+// space_trader_aibench: cost of ShipAI's decisions for a large fleet, and a check that
+// the simulation comes out the same with any number of threads.
+//
+// Usage: space_trader_aibench [ships] [frames] [threads]
+//
+// Traders fly routes between sixteen stations that each sell some commodities cheap
+// and buy the others dear, and one ship in ten is a pirate chasing them. The whole
+// simulation, AI, Fleet and grid update and trade settlement, runs once on one
+// thread and once on the given number of threads, and the two end states are compared.
+
+#include "ShipAI.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const float WORLD_SIZE = 20000.0f;
+const int STATIONS = 16;
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Result {
+    double aiMs;       // ShipAI::update, summed over all frames
+    double frameMs;    // Everything, likewise
+    std::uint64_t hash; // Of every ship's position, credits and cargo at the end
+    std::size_t trades;
+};
+
+std::uint64_t hashFloats(std::uint64_t hash, const std::vector<float>& values) {
+    for (float value : values) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    }
+    return hash;
+}
+
+Result simulate(std::size_t shipCount, int frames, unsigned threads) {
+    ThreadPool pool(threads);
+    Market market;
+    CounterRandom world(7, 0);
+    for (int i = 0; i < STATIONS; ++i) {
+        StationId station = market.addStation("Station", world.uniform(0.0f, WORLD_SIZE), world.uniform(0.0f, WORLD_SIZE));
+        for (TypeId commodity = 0; commodity < commodities().size(); ++commodity) {
+            if (world.below(2) == 0)
+                market.submit(station, commodity, SELL, NO_SHIP, 20 + world.below(20), 10000000);
+            else
+                market.submit(station, commodity, BUY, NO_SHIP, 50 + world.below(20), 10000000);
+        }
+    }
+
+    Fleet fleet;
+    ShipAI ai(1);
+    std::size_t commodityCount = commodities().size();
+    std::vector<int> credits(shipCount, 1000);
+    std::vector<int> cargo(shipCount * commodityCount, 0);
+    for (std::size_t i = 0; i < shipCount; ++i) {
+        CounterRandom random(2, i);
+        ShipId ship = fleet.add(random.uniform(0.0f, WORLD_SIZE), random.uniform(0.0f, WORLD_SIZE));
+        ai.add(ship, random.below(10) == 0 ? AI_PIRATE : AI_TRADER);
+    }
+
+    auto view = [&](ShipId ship, TypeId commodity) {
+        return AIShipView{credits[ship], cargo[ship * commodityCount + commodity]};
+    };
+    // Trades at once or not at all, as the game's ships do. Sold cargo leaves the hold
+    // with the order.
+    auto act = [&](ShipId ship, const AIDecision& decision) {
+        const TradeRoute& route = decision.route;
+        int& held = cargo[ship * commodityCount + route.commodity];
+        if (decision.action == AI_BUY) {
+            std::int32_t quantity = std::min(route.quantity, credits[ship] / route.buyPrice);
+            if (quantity > 0) {
+                OrderId rest = market.submit(route.from, route.commodity, BUY, ship, route.buyPrice, quantity);
+                if (rest != NO_ORDER)
+                    market.cancel(route.from, route.commodity, rest);
+            }
+        } else {
+            OrderBook& book = market.book(route.to, route.commodity);
+            if (held > 0 && book.hasBid()) {
+                OrderId rest = market.submit(route.to, route.commodity, SELL, ship, book.getBestBid(), held);
+                held = rest != NO_ORDER ? book.getQuantity(rest) : 0;
+                if (rest != NO_ORDER)
+                    market.cancel(route.to, route.commodity, rest);
+            }
+        }
+    };
+
+    SpatialGrid grid;
+    grid.update(fleet);
+    Result result{0.0, 0.0, 14695981039346656037ull, 0};
+    auto frameStart = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = Clock::now();
+        ai.update(static_cast<std::uint64_t>(frame), pool, fleet, grid, market, view, act);
+        result.aiMs += msSince(start);
+        fleet.update();
+        grid.update(fleet);
+        for (const Trade& trade : market.getTrades()) {
+            int value = trade.fill.price * trade.fill.quantity;
+            if (trade.fill.buyer != NO_SHIP) {
+                credits[trade.fill.buyer] -= value;
+                cargo[trade.fill.buyer * commodityCount + trade.commodity] += trade.fill.quantity;
+            }
+            if (trade.fill.seller != NO_SHIP)
+                credits[trade.fill.seller] += value;
+        }
+        result.trades += market.getTrades().size();
+        market.clearTrades();
+    }
+    result.frameMs = msSince(frameStart);
+
+    result.hash = hashFloats(hashFloats(result.hash, fleet.x), fleet.y);
+    for (int value : credits)
+        result.hash = (result.hash ^ static_cast<std::uint32_t>(value)) * 1099511628211ull;
+    for (int value : cargo)
+        result.hash = (result.hash ^ static_cast<std::uint32_t>(value)) * 1099511628211ull;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t shipCount = argc > 1 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[1]))) : 5000;
+    int frames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 600;
+    unsigned threads = argc > 3 ? static_cast<unsigned>(std::max(1, std::atoi(argv[3])))
+                                : std::max(4u, std::thread::hardware_concurrency());
+
+    Result single = simulate(shipCount, frames, 1);
+    Result parallel = simulate(shipCount, frames, threads);
+    for (const Result* result : {&single, &parallel}) {
+        std::cout << (result == &single ? 1u : threads) << " thread(s): " << result->aiMs / frames
+                  << " ms AI per frame, " << result->frameMs / frames << " ms per frame, " << result->trades
+                  << " trades" << std::endl;
+    }
+    bool identical = single.hash == parallel.hash && single.trades == parallel.trades;
+    std::cout << shipCount << " ships, " << frames << " frames: " << (identical ? "identical" : "DIFFERENT")
+              << std::endl;
+    return identical ? 0 : 1;
+}
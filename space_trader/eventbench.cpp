@@ -0,0 +1,133 @@
+// space_trader_eventbench: cost of delivering regional events, such as trade offers
+// to the ships in range, through the cell-indexed subscriptions of EventBus against
+// broadcasting every event to every subscriber and letting each one filter.
+//
+// Usage: space_trader_eventbench [subscribers] [events per frame] [frames]
+//
+// Subscribers sit at random points of a 20000 x 20000 world, two sectors square, and
+// want events within 300 units. Each frame they all drift a little, as ships do, and one in a hundred
+// unsubscribes and subscribes again somewhere else.
+
+#include "EventBus.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+const float WORLD_SIZE = 20000.0f;
+const float RANGE = 300.0f;
+const SectorKey ORIGIN{0, 0}; // Every position is from the corner of the origin sector
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Counts the events it accepts. With filter set it gets every event and checks the
+// range itself, as a broadcast subscriber would have to.
+struct CountingSubscriber : EventSubscriber {
+    float x = 0.0f, y = 0.0f;
+    bool filter = false;
+    std::size_t received = 0;
+
+    void onEvents(const Event* events, std::size_t count) override {
+        if (!filter) {
+            received += count;
+            return;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            float dx = events[i].x - x, dy = events[i].y - y;
+            if (dx * dx + dy * dy <= RANGE * RANGE)
+                ++received;
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::size_t subscriberCount = argc > 1 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[1]))) : 100000;
+    int eventsPerFrame = argc > 2 ? std::max(1, std::atoi(argv[2])) : 100;
+    int frames = argc > 3 ? std::max(1, std::atoi(argv[3])) : 100;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> coordinate(0.0f, WORLD_SIZE);
+    std::uniform_real_distribution<float> drift(-2.0f, 2.0f);
+
+    EventBus broadcast, regional;
+    std::vector<std::unique_ptr<CountingSubscriber>> broadcastSubscribers, regionalSubscribers;
+    std::vector<SubscriptionId> regionalIds;
+    for (std::size_t i = 0; i < subscriberCount; ++i) {
+        float x = coordinate(generator), y = coordinate(generator);
+        broadcastSubscribers.push_back(std::make_unique<CountingSubscriber>());
+        broadcastSubscribers.back()->x = x;
+        broadcastSubscribers.back()->y = y;
+        broadcastSubscribers.back()->filter = true;
+        broadcast.subscribe(TOPIC_TRADE_OFFER, broadcastSubscribers.back().get());
+
+        regionalSubscribers.push_back(std::make_unique<CountingSubscriber>());
+        regionalIds.push_back(regional.subscribe(TOPIC_TRADE_OFFER, regionalSubscribers.back().get(), ORIGIN, x, y, RANGE));
+    }
+
+    double broadcastMs = 0.0, regionalMs = 0.0, moveMs = 0.0, churnMs = 0.0;
+    std::size_t broadcastCalls = 0, regionalCalls = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        std::vector<Event> events;
+        for (int i = 0; i < eventsPerFrame; ++i)
+            events.push_back(Event{TOPIC_TRADE_OFFER, NO_SHIP, COMMODITY_FUEL, 10, 50, coordinate(generator),
+                                   coordinate(generator)});
+
+        auto start = Clock::now();
+        for (const Event& event : events)
+            broadcast.publish(event);
+        broadcast.dispatch();
+        broadcastMs += msSince(start);
+        broadcastCalls += broadcast.getLastCallbacks();
+
+        start = Clock::now();
+        for (const Event& event : events)
+            regional.publish(event);
+        regional.dispatch();
+        regionalMs += msSince(start);
+        regionalCalls += regional.getLastCallbacks();
+
+        // Everyone drifts; the broadcast subscribers just remember where they are
+        for (auto& subscriber : broadcastSubscribers) {
+            subscriber->x += drift(generator);
+            subscriber->y += drift(generator);
+        }
+        start = Clock::now();
+        for (std::size_t i = 0; i < subscriberCount; ++i)
+            regional.moveSubscription(regionalIds[i], ORIGIN, broadcastSubscribers[i]->x, broadcastSubscribers[i]->y);
+        moveMs += msSince(start);
+
+        start = Clock::now();
+        for (std::size_t i = frame % 100; i < subscriberCount; i += 100) {
+            CountingSubscriber& subscriber = *broadcastSubscribers[i];
+            subscriber.x = coordinate(generator);
+            subscriber.y = coordinate(generator);
+            regional.unsubscribe(regionalIds[i]);
+            regionalIds[i] = regional.subscribe(TOPIC_TRADE_OFFER, regionalSubscribers[i].get(), ORIGIN,
+                                                subscriber.x, subscriber.y, RANGE);
+        }
+        churnMs += msSince(start);
+    }
+
+    std::size_t broadcastReceived = 0, regionalReceived = 0;
+    for (std::size_t i = 0; i < subscriberCount; ++i) {
+        broadcastReceived += broadcastSubscribers[i]->received;
+        regionalReceived += regionalSubscribers[i]->received;
+    }
+
+    std::cout << subscriberCount << " subscribers, " << eventsPerFrame << " events per frame, " << frames << " frames\n";
+    std::cout << "Broadcast: " << broadcastMs / frames << " ms per frame, " << broadcastCalls / frames
+              << " subscriber calls per frame, " << broadcastReceived << " events in range\n";
+    std::cout << "Regional:  " << regionalMs / frames << " ms per frame, " << regionalCalls / frames
+              << " subscriber calls per frame, " << regionalReceived << " events in range\n";
+    std::cout << "Moving every subscription: " << moveMs / frames << " ms per frame; resubscribing 1%: "
+              << churnMs / frames << " ms per frame" << std::endl;
+    if (broadcastReceived != regionalReceived)
+        std::cerr << "Deliveries differ!" << std::endl;
+    return broadcastReceived == regionalReceived ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// space_trader_fleetbench: ships updated per second by the Fleet kernel, against the
+// per-object update with angles and trig that Ship used to run.
+//
+// Usage: space_trader_fleetbench [ships] [updates]
+//
+// Ships wander between random targets; whenever one arrives it gets a new target, as
+// AIShip does, so most ships are steering at any time.
+//
+// Most of the kernel's lead comes from it being vectorized, so the numbers only mean
+// something in an optimized build with the options CMakeLists.txt gives the target.
+
+#include "Fleet.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// The update Ship ran per object, kept as the baseline
+struct ObjectShip {
+    float x, y;
+    float rotation = 0.0f;
+    float velocityX = 0.0f, velocityY = 0.0f;
+    bool hasTarget = false;
+    float targetX = 0.0f, targetY = 0.0f;
+
+    void update() {
+        if (hasTarget) {
+            float angleToTarget = std::atan2(targetY - y, targetX - x) * 180 / PI;
+            float angleDifference = angleToTarget - rotation;
+            if (angleDifference > 180) angleDifference -= 360;
+            if (angleDifference < -180) angleDifference += 360;
+            rotation += angleDifference * 0.1f;
+
+            float thrust = MAX_THRUST * 0.1f;
+            velocityX += std::cos(rotation * PI / 180) * thrust;
+            velocityY += std::sin(rotation * PI / 180) * thrust;
+
+            if (std::hypot(targetX - x, targetY - y) < 10) {
+                hasTarget = false;
+                velocityX = 0;
+                velocityY = 0;
+            }
+        }
+        x += velocityX;
+        y += velocityY;
+        velocityX *= FRICTION;
+        velocityY *= FRICTION;
+    }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t ships = argc > 1 ? static_cast<std::size_t>(std::max(1, std::atoi(argv[1]))) : 100000;
+    int updates = argc > 2 ? std::max(1, std::atoi(argv[2])) : 200;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> coordinate(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> offset(-500.0f, 500.0f);
+
+    Fleet fleet;
+    std::vector<ObjectShip> objects;
+    for (std::size_t i = 0; i < ships; ++i) {
+        float x = coordinate(generator), y = coordinate(generator);
+        fleet.add(x, y);
+        objects.push_back(ObjectShip{x, y});
+    }
+
+    // Same retargeting rule for both, outside the timed update
+    auto retarget = [&](float x, float y, float& tx, float& ty) {
+        tx = x + offset(generator);
+        ty = y + offset(generator);
+    };
+
+    double fleetSeconds = 0.0, objectSeconds = 0.0;
+    for (int update = 0; update < updates; ++update) {
+        for (std::size_t i = 0; i < ships; ++i) {
+            if (!fleet.hasTarget[i]) {
+                float tx, ty;
+                retarget(fleet.x[i], fleet.y[i], tx, ty);
+                fleet.setTarget(static_cast<ShipId>(i), tx, ty);
+            }
+            if (!objects[i].hasTarget) {
+                retarget(objects[i].x, objects[i].y, objects[i].targetX, objects[i].targetY);
+                objects[i].hasTarget = true;
+            }
+        }
+
+        auto start = Clock::now();
+        fleet.update();
+        fleetSeconds += secondsSince(start);
+
+        start = Clock::now();
+        for (ObjectShip& ship : objects)
+            ship.update();
+        objectSeconds += secondsSince(start);
+    }
+
+    double total = static_cast<double>(ships) * updates;
+    std::cout << ships << " ships, " << updates << " updates\n";
+    std::cout << "Fleet kernel:      " << total / fleetSeconds / 1e6 << " M ship updates/s\n";
+    std::cout << "Per-object update: " << total / objectSeconds / 1e6 << " M ship updates/s\n";
+    std::cout << "Speedup: " << objectSeconds / fleetSeconds << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,169 @@
+// space_trader_galaxybench: frame times while the player flies across the galaxy and
+// sectors stream in and out on the background thread, and a check that sectors, and
+// the game's ships parked in them, come back from disk as they were saved.
+//
+// Usage: space_trader_galaxybench [frames] [speed] [frame ms]
+//
+// The player flies diagonally at speed units per frame (default 400, a sector every 25
+// frames) from the origin, then back, with the Galaxy following it. Frames are paced
+// to frame ms (default 4), as the game's are to the display, which is what gives the
+// streamer time to work. A few game ships wait in the origin sector, handed to the
+// Galaxy once the player is past the near sectors; they are parked when the origin
+// sector is saved, and should come back exactly as they were when the player returns.
+// Sector files go to a directory under the system's temporary directory, removed
+// afterwards.
+
+#include "CounterRandom.h"
+#include "Galaxy.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool sameTraffic(const Fleet& a, const Fleet& b) {
+    return a.x == b.x && a.y == b.y && a.velocityX == b.velocityX && a.velocityY == b.velocityY &&
+           a.headingX == b.headingX && a.headingY == b.headingY && a.targetX == b.targetX &&
+           a.targetY == b.targetY && a.hasTarget == b.hasTarget && a.sector == b.sector;
+}
+
+// Whether a ship in a is the same as one in b
+bool sameShip(const Fleet& a, ShipId ship, const Fleet& b, ShipId other) {
+    return a.x[ship] == b.x[other] && a.y[ship] == b.y[other] && a.velocityX[ship] == b.velocityX[other] &&
+           a.velocityY[ship] == b.velocityY[other] && a.headingX[ship] == b.headingX[other] &&
+           a.headingY[ship] == b.headingY[other] && a.targetX[ship] == b.targetX[other] &&
+           a.targetY[ship] == b.targetY[other] && a.hasTarget[ship] == b.hasTarget[other] &&
+           a.sector[ship] == b.sector[other];
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? std::max(2, std::atoi(argv[1])) : 1000;
+    float speed = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 400.0f;
+    double frameMs = argc > 3 ? std::atof(argv[3]) : 4.0;
+    std::string directory = (std::filesystem::temp_directory_path() / "space_trader_galaxybench").string();
+    std::filesystem::remove_all(directory);
+
+    // Precision far out: the gap between neighbouring floats there, against within a sector
+    float far = 1e9f;
+    std::cout << "Float step at 1e9 units: " << std::nextafter(far, std::numeric_limits<float>::max()) - far
+              << ", within a sector: "
+              << std::nextafter(SECTOR_SIZE, std::numeric_limits<float>::max()) - SECTOR_SIZE << std::endl;
+
+    bool ok = true;
+    {
+        ThreadPool pool;
+        const SectorKey origin{0, 0};
+        Fleet ships;
+        Galaxy galaxy(1, directory, ships);
+        GalaxyPosition player{origin, SECTOR_SIZE / 2, SECTOR_SIZE / 2};
+        galaxy.setFocus(player.sector, 0);
+
+        // Waiting ships, which the coarse update leaves where they are, with kinematics
+        // of their own to come back
+        const ShipId GAME_SHIPS = 16;
+        CounterRandom random(1, 0);
+        for (ShipId ship = 0; ship < GAME_SHIPS; ++ship) {
+            ships.add(random.uniform(0.0f, SECTOR_SIZE), random.uniform(0.0f, SECTOR_SIZE), origin);
+            ships.velocityX[ship] = random.uniform(-CRUISE_SPEED, CRUISE_SPEED);
+            ships.velocityY[ship] = random.uniform(-CRUISE_SPEED, CRUISE_SPEED);
+        }
+        Fleet parked(ships); // Each game ship as it was parked, by ShipId
+        bool adopted = false;
+        std::size_t parkedCount = 0, backCount = 0, backSame = 0;
+
+        double totalMs = 0.0, worstMs = 0.0;
+        int sectorChanges = 0;
+        std::size_t mostRequested = 0;
+        int framesMissingSectors = 0; // Frames with a near sector not loaded yet
+        auto frameStart = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            float step = frame < frames / 2 ? speed : -speed;
+            player.x += step;
+            player.y += step * 0.5f;
+            auto start = Clock::now();
+            SectorKey before = player.sector;
+            player.normalize();
+            if (player.sector != before) {
+                galaxy.setFocus(player.sector, frame);
+                ++sectorChanges;
+                for (ShipId ship : galaxy.getParked()) {
+                    parked.assign(ship, ships, ship);
+                    // Stale until it comes back, as the game leaves it
+                    ships.x[ship] = ships.y[ship] = -1.0f;
+                    ++parkedCount;
+                }
+            }
+            if (!adopted && player.sector.distance(origin) > NEAR_RADIUS) {
+                for (ShipId ship = 0; ship < GAME_SHIPS; ++ship)
+                    galaxy.adoptShip(ship, frame);
+                adopted = true;
+            }
+            galaxy.update(frame, pool);
+            for (ShipId ship : galaxy.getUnparked()) {
+                ++backCount;
+                backSame += sameShip(ships, ship, parked, ship);
+            }
+            double ms = msSince(start);
+            totalMs += ms;
+            worstMs = std::max(worstMs, ms);
+            mostRequested = std::max(mostRequested, galaxy.getRequestedCount());
+
+            bool missing = false;
+            for (int y = -NEAR_RADIUS; y <= NEAR_RADIUS; ++y)
+                for (int x = -NEAR_RADIUS; x <= NEAR_RADIUS; ++x)
+                    missing = missing || !galaxy.findSector(SectorKey{player.sector.x + x, player.sector.y + y});
+            framesMissingSectors += missing;
+
+            frameStart += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(frameMs));
+            std::this_thread::sleep_until(frameStart);
+        }
+        std::cout << frames << " frames, " << sectorChanges << " sector changes, ending at sector ("
+                  << player.sector.x << ", " << player.sector.y << "), galaxy position (" << player.galaxyX() << ", "
+                  << player.galaxyY() << ")" << std::endl;
+        std::cout << "Game thread: " << totalMs / frames << " ms per frame, worst " << worstMs << " ms; "
+                  << galaxy.getLoadedCount() << " sectors loaded, at most " << mostRequested
+                  << " waiting on the streamer" << std::endl;
+        std::cout << framesMissingSectors << " frames with a near sector still loading" << std::endl;
+
+        // Game ships still parked come back once the streamer has caught up
+        for (int wait = 0; wait < 1000 && backCount < parkedCount; ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            galaxy.update(static_cast<std::uint64_t>(frames), pool);
+            for (ShipId ship : galaxy.getUnparked()) {
+                ++backCount;
+                backSame += sameShip(ships, ship, parked, ship);
+            }
+        }
+        bool shipsBack = backCount == parkedCount && backSame == backCount;
+        std::cout << "Game ships: " << parkedCount << " parked, " << backCount << " back, " << backSame
+                  << " of them as they were parked" << std::endl;
+        ok = ok && shipsBack;
+
+        // Round trip of a loaded sector through its file
+        const Sector* sector = galaxy.findSector(player.sector);
+        if (sector) {
+            std::string filename = directory + "/roundtrip.bin";
+            sector->write(filename);
+            std::unique_ptr<Sector> read = Sector::read(filename, sector->key);
+            bool same = read && read->updatedFrame == sector->updatedFrame && sameTraffic(read->traffic, sector->traffic);
+            std::cout << "Sector file round trip: " << (same ? "identical" : "DIFFERENT") << std::endl;
+            ok = ok && same;
+        }
+    }
+
+    std::size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+        files += entry.path().extension() == ".bin";
+    std::cout << files << " sector files saved" << std::endl;
+    std::filesystem::remove_all(directory);
+    return ok ? 0 : 1;
+}
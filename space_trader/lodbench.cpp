@@ -0,0 +1,149 @@
+// space_trader_lodbench: cost of simulating a fleet with FleetLOD, against the full
+// Fleet update for every ship, at several fleet sizes.
+//
+// Usage: space_trader_lodbench [ships...]
+//
+// Ships wander between random targets in a world sized for about one ship per 100 x
+// 100 units, whatever their number, and get a new target in the frame the AI would
+// decide for them. The focus circles the middle of the world, as a player would fly.
+// Each size runs once with every ship updated every frame and once with FleetLOD,
+// and reports the time a frame spends moving ships and bringing the SpatialGrid up to
+// date (all of it without FleetLOD, only the ships that moved with it), in total and
+// each, how many ships were in each tier, and how
+// often a ship in view of the focus was not at full detail (which should be never),
+// once every ship has been assessed. With FleetLOD, the ships in sectors beyond
+// NEAR_RADIUS of the focus are moved by a Galaxy following it, whose update is counted
+// with moving ships, its own traffic included. Its sector files go to a directory
+// under the system's temporary directory, removed afterwards.
+
+#include "CounterRandom.h"
+#include "FleetLOD.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+const int FRAMES = 400;
+const int WARMUP = LOD_ASSESS_INTERVAL; // Frames before every ship has been assessed, left out of the results
+const float VIEW_RADIUS = 500.0f;       // Half the diagonal of the 800 x 600 window
+const float ROAM_DISTANCE = 2000.0f;    // Farthest a new target is from a ship
+const float FOCUS_SPEED = 50.0f;        // Distance the focus flies per frame
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Result {
+    double moveMs;      // Fleet::update() or FleetLOD::assess() and update(), per frame
+    double gridMs;      // SpatialGrid::update(), of every ship or only those that moved, per frame
+    double tiers[5];    // Ships per LODTier, averaged over the frames
+    std::size_t unseen; // Ships in view but not at full detail, summed over the frames
+};
+
+Result simulate(std::size_t shipCount, bool useLOD, ThreadPool& pool) {
+    float worldSize = 100.0f * std::sqrt(static_cast<float>(shipCount));
+    CounterRandom random(1, shipCount);
+    Fleet fleet;
+    FleetLOD lod;
+    for (std::size_t i = 0; i < shipCount; ++i) {
+        GalaxyPosition position{{0, 0}, random.uniform(0.0f, worldSize), random.uniform(0.0f, worldSize)};
+        position.normalize();
+        lod.add(fleet.add(position.x, position.y, position.sector));
+    }
+
+    std::string directory = (std::filesystem::temp_directory_path() / "space_trader_lodbench").string();
+    std::filesystem::remove_all(directory);
+    Result result{0.0, 0.0, {0.0, 0.0, 0.0, 0.0, 0.0}, 0};
+    {
+        Galaxy galaxy(1, directory, fleet);
+        SpatialGrid grid;
+        grid.update(fleet);
+        float orbit = worldSize / 4.0f;
+        for (int frame = 0; frame < WARMUP + FRAMES; ++frame) {
+            if (frame == WARMUP)
+                result = Result{0.0, 0.0, {0.0, 0.0, 0.0, 0.0, 0.0}, 0};
+            float angle = frame * FOCUS_SPEED / orbit;
+            GalaxyPosition focus{{0, 0}, worldSize / 2.0f + orbit * std::cos(angle),
+                                 worldSize / 2.0f + orbit * std::sin(angle)};
+            focus.normalize();
+            if (useLOD && (frame == 0 || focus.sector != galaxy.getFocus())) {
+                galaxy.setFocus(focus.sector, static_cast<std::uint64_t>(frame));
+                for (ShipId ship : galaxy.getParked())
+                    grid.remove(ship);
+            }
+
+            auto start = Clock::now();
+            if (useLOD)
+                lod.assess(static_cast<std::uint64_t>(frame), fleet, grid, galaxy, focus);
+            result.moveMs += msSince(start);
+
+            // The AI's share of this frame, but for ships parked with their sector
+            for (std::size_t ship = frame % AI_DECISION_INTERVAL; ship < shipCount; ship += AI_DECISION_INTERVAL) {
+                if (!fleet.hasTarget[ship] && !galaxy.isParked(static_cast<ShipId>(ship)))
+                    fleet.setTarget(static_cast<ShipId>(ship),
+                                    fleet.x[ship] + random.uniform(-ROAM_DISTANCE, ROAM_DISTANCE),
+                                    fleet.y[ship] + random.uniform(-ROAM_DISTANCE, ROAM_DISTANCE));
+            }
+
+            start = Clock::now();
+            if (useLOD) {
+                lod.update(static_cast<std::uint64_t>(frame), fleet);
+                galaxy.update(static_cast<std::uint64_t>(frame) + 1, pool);
+            } else {
+                fleet.update();
+            }
+            result.moveMs += msSince(start);
+
+            start = Clock::now();
+            if (useLOD) {
+                grid.update(fleet, lod.getMoved());
+                grid.update(fleet, galaxy.getMoved());
+            } else {
+                grid.update(fleet);
+            }
+            result.gridMs += msSince(start);
+
+            std::vector<ShipId> inView;
+            grid.queryRadius(focus.sector, focus.x, focus.y, VIEW_RADIUS, inView);
+            for (ShipId ship : inView)
+                result.unseen += useLOD && lod.getTier(ship) != LOD_FULL;
+            for (LODTier tier : {LOD_FULL, LOD_REDUCED, LOD_ROUTE, LOD_SECTOR})
+                result.tiers[tier] += useLOD ? lod.getCount(tier) : (tier == LOD_FULL ? shipCount : 0);
+        }
+    }
+    std::filesystem::remove_all(directory);
+    result.moveMs /= FRAMES;
+    result.gridMs /= FRAMES;
+    for (double& count : result.tiers)
+        count /= FRAMES;
+    return result;
+}
+
+void run(std::size_t shipCount, ThreadPool& pool) {
+    Result everyShip = simulate(shipCount, false, pool);
+    Result withLOD = simulate(shipCount, true, pool);
+    std::cout << shipCount << " ships" << std::endl;
+    std::cout << "  every ship: " << everyShip.moveMs + everyShip.gridMs << " ms/frame (moving ships "
+              << everyShip.moveMs << " ms, grid " << everyShip.gridMs << " ms)" << std::endl;
+    std::cout << "  FleetLOD:   " << withLOD.moveMs + withLOD.gridMs << " ms/frame (moving ships " << withLOD.moveMs
+              << " ms, grid " << withLOD.gridMs << " ms), "
+              << withLOD.tiers[LOD_FULL] << " full, " << withLOD.tiers[LOD_REDUCED] << " reduced, "
+              << withLOD.tiers[LOD_ROUTE] << " on routes, " << withLOD.tiers[LOD_SECTOR] << " with their sectors; "
+              << withLOD.unseen << " ship-frames in view not at full detail"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    ThreadPool pool;
+    if (argc < 2) {
+        for (std::size_t ships : {10000, 100000, 1000000})
+            run(ships, pool);
+    }
+    for (int i = 1; i < argc; ++i)
+        run(static_cast<std::size_t>(std::max(1, std::atoi(argv[i]))), pool);
+    return 0;
+}
@@ -1,4 +1,15 @@
 #include <SFML/Graphics.hpp>
+#include "EventBus.h"
+#include "CounterRandom.h"
+#include "Fleet.h"
+#include "FleetLOD.h"
+#include "Galaxy.h"
+#include "Market.h"
+#include "ShipAI.h"
+#include "ShipRenderer.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+#include "TypeRegistry.h"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -6,237 +17,334 @@
 #include <memory>
 #include <cmath>
 #include <random>
+#include <algorithm>
+#include <cstdlib>
 
-// Constants
-const float PI = 3.14159f;
-const float MAX_THRUST = 100.0f;
-const float FRICTION = 0.98f;
+// Distance within which ships hear trade offers
+const float TRADE_RANGE = 300.0f;
 
-// Observer Pattern
-class Observer {
-public:
-    virtual void onNotify(const std::string& message) = 0;
-};
-
-class NotificationCenter {
-    std::vector<Observer*> observers;
-public:
-    void addObserver(Observer* observer) {
-        observers.push_back(observer);
-    }
-
-    void notify(const std::string& message) {
-        for (auto observer : observers) {
-            observer->onNotify(message);
-        }
-    }
-};
-
-// Cargo and Trade System
-struct CargoItem {
-    std::string name;
-    int quantity;
-};
+// Seeds of the ships' random streams: what each ship is built from, and its decisions
+const std::uint64_t SHIP_SEED = 1;
+const std::uint64_t AI_SEED = 2;
+const std::uint64_t GALAXY_SEED = 3;
 
-// Ship Component System
-struct Component {
-    std::string type;
-    sf::Vector2f position;
-    float rotation;
-    sf::Vector2f size;
-};
-
-class Ship : public Observer {
+// A ship's movement lives in the Fleet, which updates every ship in one batch, and
+// its components are drawn with every other ship's by the ShipRenderer. Like every
+// position in the game, its position is from the corner of the sector it is in.
+class Ship : public EventSubscriber {
 public:
-    sf::Vector2f position;
-    float rotation;
-    float velocityX = 0.0f, velocityY = 0.0f;
-    float thrust = 0.0f;
-    bool hasTarget = false;
-    sf::Vector2f targetPosition;
-    std::vector<CargoItem> cargo;
-    NotificationCenter* notificationCenter;
+    Fleet& fleet;
+    ShipRenderer& renderer;
+    ShipId id;
+    std::vector<int> cargo; // Quantity per commodity ID, see commodities()
+    int credits = 1000;
+    EventBus* eventBus;
+    SubscriptionId offers;    // Trade offers within TRADE_RANGE
+    Event lastOffer;          // Latest trade offer heard of
+    bool hasOffer = false;
     std::vector<Component> components;
 
-    Ship(float x, float y, NotificationCenter* nc) : position(x, y), rotation(0), notificationCenter(nc) {
+    Ship(Fleet& fleet, ShipRenderer& renderer, GalaxyPosition position, EventBus* bus)
+        : fleet(fleet), renderer(renderer), id(fleet.add(position.x, position.y, position.sector)), eventBus(bus) {
         // Add some cargo to start
-        cargo.push_back({"Fuel", 100});
-        cargo.push_back({"Food", 50});
-        cargo.push_back({"Metal", 30});
-        notificationCenter->addObserver(this);
+        cargo.assign(commodities().size(), 0);
+        cargo[COMMODITY_FUEL] = 100;
+        cargo[COMMODITY_FOOD] = 50;
+        cargo[COMMODITY_METAL] = 30;
+        offers = eventBus->subscribe(TOPIC_TRADE_OFFER, this, position.sector, position.x, position.y, TRADE_RANGE);
 
         // Add ship components (e.g., hull and thrusters)
-        components.push_back({"HULL", {0, 0}, 0, {40, 20}});
-        components.push_back({"THRUSTER", {-20, -10}, 180, {10, 5}});
-        components.push_back({"THRUSTER", {20, -10}, 180, {10, 5}});
+        components.push_back({COMPONENT_HULL, {0, 0}, 0, {40, 20}});
+        components.push_back({COMPONENT_THRUSTER, {-20, -10}, 180, {10, 5}});
+        components.push_back({COMPONENT_THRUSTER, {20, -10}, 180, {10, 5}});
+        renderer.setComponents(id, components);
     }
 
-    void addCargo(const std::string& name, int quantity) {
-        for (auto& item : cargo) {
-            if (item.name == name) {
-                item.quantity += quantity;
-                return;
-            }
-        }
-        cargo.push_back({name, quantity});
-    }
+    ~Ship() { eventBus->unsubscribe(offers); }
 
-    void setTarget(float x, float y) {
-        targetPosition = sf::Vector2f(x, y);
-        hasTarget = true;
+    void addCargo(TypeId commodity, int quantity) {
+        if (commodity >= cargo.size())
+            cargo.resize(commodities().size(), 0);
+        cargo[commodity] += quantity;
+
+        Event event{TOPIC_CARGO_CHANGED, id, commodity, quantity};
+        event.x = fleet.x[id];
+        event.y = fleet.y[id];
+        event.sector = fleet.sector[id];
+        eventBus->publish(event);
     }
 
-    void addComponent(const std::string& type, sf::Vector2f position, float rotation, sf::Vector2f size) {
+    int getCargo(TypeId commodity) const { return commodity < cargo.size() ? cargo[commodity] : 0; }
+
+    GalaxyPosition getPosition() const { return GalaxyPosition{fleet.sector[id], fleet.x[id], fleet.y[id]}; }
+
+    bool hasTarget() const { return fleet.hasTarget[id]; }
+
+    // (x, y) from the corner of the ship's sector
+    void setTarget(float x, float y) { fleet.setTarget(id, x, y); }
+
+    // Keeps the trade offer range centered on the ship after it moved
+    void updateSubscription() { eventBus->moveSubscription(offers, fleet.sector[id], fleet.x[id], fleet.y[id]); }
+
+    void addComponent(TypeId type, sf::Vector2f position, float rotation, sf::Vector2f size) {
         components.push_back({type, position, rotation, size});
+        renderer.setComponents(id, components);
     }
 
-    void removeComponent(const std::string& type) {
+    void removeComponent(TypeId type) {
         components.erase(std::remove_if(components.begin(), components.end(), [&](const Component& comp) {
             return comp.type == type;
         }), components.end());
+        renderer.setComponents(id, components);
     }
 
-    void onNotify(const std::string& message) override {
-        std::cout << "Ship received message: " << message << std::endl;
+    void onEvents(const Event* events, std::size_t count) override {
+        lastOffer = events[count - 1];
+        hasOffer = true;
     }
 
-    void update() {
-        // Update ship physics and handle movement towards target
-        if (hasTarget) {
-            float angleToTarget = atan2(targetPosition.y - position.y, targetPosition.x - position.x) * 180 / PI;
-            float angleDifference = angleToTarget - rotation;
-
-            if (angleDifference > 180) angleDifference -= 360;
-            if (angleDifference < -180) angleDifference += 360;
-
-            rotation += angleDifference * 0.1f; // Smooth rotation towards target
-
-            thrust = MAX_THRUST * 0.1f;
-            velocityX += cos(rotation * PI / 180) * thrust;
-            velocityY += sin(rotation * PI / 180) * thrust;
+    // Buys up to quantity, as much as the ship can pay for, at price or better. What
+    // does not fill at once is cancelled.
+    void buyNow(Market& market, StationId station, TypeId commodity, std::int32_t price, std::int32_t quantity) {
+        if (price <= 0)
+            return;
+        quantity = std::min(quantity, credits / price);
+        if (quantity <= 0)
+            return;
+        OrderId rest = market.submit(station, commodity, BUY, id, price, quantity);
+        if (rest != NO_ORDER)
+            market.cancel(station, commodity, rest);
+    }
 
-            if (std::hypot(targetPosition.x - position.x, targetPosition.y - position.y) < 10) {
-                hasTarget = false;
-                thrust = 0;
-                velocityX = 0;
-                velocityY = 0;
-            }
+    // Sells up to quantity at price or better. The units leave the hold as the order is
+    // placed, so they cannot be sold twice, and what does not fill at once comes back.
+    void sellNow(Market& market, StationId station, TypeId commodity, std::int32_t price, std::int32_t quantity) {
+        quantity = std::min(quantity, getCargo(commodity));
+        if (quantity <= 0)
+            return;
+        addCargo(commodity, -quantity);
+        OrderId rest = market.submit(station, commodity, SELL, id, price, quantity);
+        if (rest != NO_ORDER) {
+            addCargo(commodity, market.book(station, commodity).getQuantity(rest));
+            market.cancel(station, commodity, rest);
         }
+    }
 
-        // Apply velocity with inertia and friction
-        position.x += velocityX;
-        position.y += velocityY;
-        velocityX *= FRICTION;
-        velocityY *= FRICTION;
+    // One unit at the station's best ask or bid, if there is one
+    void buyAtMarket(Market& market, StationId station, TypeId commodity) {
+        OrderBook& book = market.book(station, commodity);
+        if (book.hasAsk())
+            buyNow(market, station, commodity, book.getBestAsk(), 1);
     }
 
-    void draw(sf::RenderWindow& window) {
-        for (const auto& component : components) {
-            sf::RectangleShape shape(component.size);
-            shape.setOrigin(component.size.x / 2, component.size.y / 2);
-            shape.setPosition(position + component.position);
-            shape.setRotation(rotation + component.rotation);
-
-            if (component.type == "HULL")
-                shape.setFillColor(sf::Color::Green);
-            else if (component.type == "THRUSTER")
-                shape.setFillColor(sf::Color::Red);
-
-            window.draw(shape);
-        }
+    void sellAtMarket(Market& market, StationId station, TypeId commodity) {
+        OrderBook& book = market.book(station, commodity);
+        if (book.hasBid())
+            sellNow(market, station, commodity, book.getBestBid(), 1);
     }
 
     // Method to handle player controls
     void handleInput() {
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) {
-            thrust = MAX_THRUST * 0.1f;
-            velocityX += cos(rotation * PI / 180) * thrust;
-            velocityY += sin(rotation * PI / 180) * thrust;
-            std::cout << "W is pressed" << std::endl;
+            fleet.thrust(id, MAX_THRUST * 0.1f);
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) {
-            rotation -= 2.0f;
+            fleet.turn(id, -2.0f);
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) {
-            rotation += 2.0f;
+            fleet.turn(id, 2.0f);
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) {
-            thrust = -MAX_THRUST * 0.05f;
-            velocityX += cos(rotation * PI / 180) * thrust;
-            velocityY += sin(rotation * PI / 180) * thrust;
+            fleet.thrust(id, -MAX_THRUST * 0.05f);
         }
     }
 };
 
-// AI Ship for procedural generation
+// AI Ship for procedural generation. Its decisions are made by ShipAI.
 class AIShip : public Ship {
 public:
-    AIShip(float x, float y, NotificationCenter* nc) : Ship(x, y, nc) {
-        // Add some procedural components
-        std::default_random_engine generator;
-        std::uniform_real_distribution<float> distX(-50.0, 50.0);
-        std::uniform_real_distribution<float> distY(-50.0, 50.0);
-        std::uniform_int_distribution<int> componentType(0, 2);
-
+    AIShip(Fleet& fleet, ShipRenderer& renderer, GalaxyPosition position, EventBus* bus)
+        : Ship(fleet, renderer, position, bus) {
+        // Add some procedural components, from the ship's own random stream so that
+        // every ship gets different ones
+        CounterRandom random(SHIP_SEED, id);
         for (int i = 0; i < 3; ++i) {
-            std::string type = componentType(generator) == 0 ? "HULL" : "THRUSTER";
-            addComponent(type, {distX(generator), distY(generator)}, 0, {20, 10});
+            TypeId type = random.below(3) == 0 ? COMPONENT_HULL : COMPONENT_THRUSTER;
+            float x = random.uniform(-50.0f, 50.0f), y = random.uniform(-50.0f, 50.0f);
+            addComponent(type, {x, y}, 0, {20, 10});
         }
     }
 
-    void updateAI() {
-        // Basic AI movement logic (randomly wander for now)
-        if (!hasTarget) {
-            setTarget(position.x + (std::rand() % 100 - 50), position.y + (std::rand() % 100 - 50));
-        }
-        update();
-    }
+    // One ship in ten is a pirate
+    AIRole getRole() const { return CounterRandom(SHIP_SEED, id, 1).below(10) == 0 ? AI_PIRATE : AI_TRADER; }
 };
 
 // UI for displaying cargo and trade menu
-class TradeMenu : public Observer {
+class TradeMenu : public EventSubscriber {
     Ship& ship;
     sf::Font font;
     sf::Text text;
+    std::string offerInfo;
+    SectorKey sector{0, 0};
+    bool changed = true; // Cargo, offer or sector changed since the text was built
 public:
-    TradeMenu(Ship& ship) : ship(ship) {
+    TradeMenu(Ship& ship, EventBus& eventBus) : ship(ship) {
         if (!font.loadFromFile("arial.ttf")) { // Ensure you have this font file
             std::cerr << "Failed to load font!" << std::endl;
         }
         text.setFont(font);
         text.setCharacterSize(14);
         text.setFillColor(sf::Color::White);
+        eventBus.subscribe(TOPIC_TRADE_OFFER, this);
+        eventBus.subscribe(TOPIC_CARGO_CHANGED, this);
+    }
+
+    void setSector(SectorKey key) {
+        changed = changed || key != sector;
+        sector = key;
     }
 
     void draw(sf::RenderWindow& window) {
-        std::string cargoInfo = "Cargo:\n";
-        for (const auto& item : ship.cargo) {
-            cargoInfo += item.name + ": " + std::to_string(item.quantity) + "\n";
+        // Only rebuild the text when something changed
+        if (changed) {
+            std::string cargoInfo = "Sector: (" + std::to_string(sector.x) + ", " + std::to_string(sector.y) +
+                                    ")\nCredits: " + std::to_string(ship.credits) + "\nCargo:\n";
+            for (TypeId commodity = 0; commodity < ship.cargo.size(); ++commodity) {
+                cargoInfo += commodities().getName(commodity) + ": " + std::to_string(ship.cargo[commodity]) + "\n";
+            }
+            text.setString(cargoInfo + offerInfo + "\nB: buy 1 Fuel, N: sell 1 Fuel");
+            changed = false;
         }
-        text.setString(cargoInfo);
         text.setPosition(10, 10);
         window.draw(text);
     }
 
-    void onNotify(const std::string& message) override {
-        std::cout << "Trade Menu received message: " << message << std::endl;
+    void onEvents(const Event* events, std::size_t count) override {
+        for (std::size_t i = 0; i < count; ++i) {
+            const Event& event = events[i];
+            if (event.topic == TOPIC_TRADE_OFFER) {
+                offerInfo = "\nNew trade offer: Buy " + std::to_string(event.quantity) + " units of " +
+                            commodities().getName(event.commodity) + " for " + std::to_string(event.price) +
+                            " credits!";
+                changed = true;
+            } else if (event.ship == ship.id) {
+                changed = true;
+            }
+        }
     }
 };
 
+// Moves cargo and credits for the market's trades. Sellers' cargo already left their
+// hold when they placed the order, and stations have unlimited stock and credits.
+void settleTrades(Market& market, const std::vector<Ship*>& shipsById) {
+    for (const Trade& trade : market.getTrades()) {
+        int value = trade.fill.price * trade.fill.quantity;
+        if (trade.fill.buyer != NO_SHIP) {
+            shipsById[trade.fill.buyer]->credits -= value;
+            shipsById[trade.fill.buyer]->addCargo(trade.commodity, trade.fill.quantity);
+        }
+        if (trade.fill.seller != NO_SHIP)
+            shipsById[trade.fill.seller]->credits += value;
+    }
+    market.clearTrades();
+}
+
 // Main function
-int main() {
+// Usage: space_trader [--ships N] [--save-dir DIR]
+// --ships sets the number of AI ships, scattered over the window.
+// --save-dir sets where the galaxy's sectors are saved and loaded from, and defaults
+// to "sectors" in the working directory. A run picks up the sectors an earlier run
+// saved there.
+int main(int argc, char* argv[]) {
+    int aiShipCount = 1;
+    std::string saveDirectory = "sectors";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ships" && i + 1 < argc) {
+            aiShipCount = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--save-dir" && i + 1 < argc) {
+            saveDirectory = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--ships N] [--save-dir DIR]" << std::endl;
+            return -1;
+        }
+    }
+
     sf::RenderWindow window(sf::VideoMode(800, 600), "Ship Trade & Logistics Demo");
-    NotificationCenter notificationCenter;
+    EventBus eventBus;
+    Fleet fleet;
+    ShipRenderer shipRenderer;
+    Market market;
+    const SectorKey home{0, 0}; // Where the game starts, with its stations and ships
+    StationId station = market.addStation("Station", 400.0f, 300.0f, home);
+    StationId refinery = market.addStation("Refinery", 100.0f, 100.0f, home);
+    StationId colony = market.addStation("Colony", 700.0f, 500.0f, home);
+    ThreadPool pool;
+    ShipAI ai(AI_SEED);
+    SpatialGrid grid;
+    FleetLOD lod;
+
+    // The galaxy follows the player's sector. The game's ships that the FleetLOD finds
+    // beyond the near sectors move with their sector's traffic, and are saved to
+    // saveDirectory with it.
+    Galaxy galaxy(GALAXY_SEED, saveDirectory, fleet);
+    galaxy.setFocus(home, 0);
+    sf::View camera(sf::FloatRect(0.0f, 0.0f, 800.0f, 600.0f));
+    sf::VertexArray traffic(sf::Triangles);
 
     // Ship and Trade Menu setup
-    Ship playerShip(400, 300, &notificationCenter);
-    TradeMenu tradeMenu(playerShip);
-    AIShip aiShip(200, 150, &notificationCenter);
+    Ship playerShip(fleet, shipRenderer, GalaxyPosition{home, 400.0f, 300.0f}, &eventBus);
+    TradeMenu tradeMenu(playerShip, eventBus);
+    std::vector<std::unique_ptr<AIShip>> aiShips;
+    std::mt19937 spawnGenerator(1);
+    std::uniform_real_distribution<float> spawnX(0.0f, 800.0f), spawnY(0.0f, 600.0f);
+    for (int i = 0; i < aiShipCount; ++i) {
+        float x = i == 0 ? 200.0f : spawnX(spawnGenerator), y = i == 0 ? 150.0f : spawnY(spawnGenerator);
+        aiShips.push_back(std::make_unique<AIShip>(fleet, shipRenderer, GalaxyPosition{home, x, y}, &eventBus));
+    }
 
-    notificationCenter.addObserver(&tradeMenu);
+    std::vector<Ship*> shipsById(fleet.size());
+    shipsById[playerShip.id] = &playerShip;
+    lod.add(playerShip.id);
+    for (auto& aiShip : aiShips) {
+        shipsById[aiShip->id] = aiShip.get();
+        ai.add(aiShip->id, aiShip->getRole());
+        lod.add(aiShip->id);
+    }
 
-    // Simulated trade message
-    notificationCenter.notify("New trade offer: Buy 10 units of Fuel for 50 credits!");
+    // The station in the middle of the screen sells some Fuel and buys it back for
+    // less. Its offer reaches the ships in range and the trade menu with the first
+    // frame's events.
+    const Station& central = market.getStation(station);
+    market.submit(station, COMMODITY_FUEL, SELL, NO_SHIP, 50, 10);
+    market.submit(station, COMMODITY_FUEL, BUY, NO_SHIP, 40, 100);
+    Event offer{TOPIC_TRADE_OFFER, NO_SHIP, COMMODITY_FUEL, 10, 50, central.x, central.y, central.sector};
+    eventBus.publish(offer);
+
+    // The refinery sells Fuel cheap that the colony pays well for, and the colony sells
+    // Metal that the refinery needs: trade routes for the AI
+    market.submit(refinery, COMMODITY_FUEL, SELL, NO_SHIP, 30, 100000);
+    market.submit(refinery, COMMODITY_METAL, BUY, NO_SHIP, 45, 100000);
+    market.submit(colony, COMMODITY_FUEL, BUY, NO_SHIP, 60, 100000);
+    market.submit(colony, COMMODITY_METAL, SELL, NO_SHIP, 25, 100000);
+
+    // What the AI may know about a ship, and how it trades
+    auto viewShip = [&](ShipId ship, TypeId commodity) {
+        return AIShipView{shipsById[ship]->credits, shipsById[ship]->getCargo(commodity)};
+    };
+    auto actShip = [&](ShipId ship, const AIDecision& decision) {
+        const TradeRoute& route = decision.route;
+        Ship& trader = *shipsById[ship];
+        if (decision.action == AI_BUY) {
+            trader.buyNow(market, route.from, route.commodity, route.buyPrice, route.quantity);
+        } else {
+            OrderBook& book = market.book(route.to, route.commodity);
+            if (book.hasBid())
+                trader.sellNow(market, route.to, route.commodity, book.getBestBid(), trader.getCargo(route.commodity));
+        }
+    };
+    std::uint64_t frame = 0;
+    grid.update(fleet);
 
     while (window.isOpen()) {
         sf::Event event;
@@ -244,21 +352,67 @@ int main() {
             if (event.type == sf::Event::Closed)
                 window.close();
 
-            // Set target on mouse click for player ship
+            // Set target on mouse click for player ship. The camera shows the focus
+            // sector's coordinates, and the focus is the player's sector.
             if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
-                float mouseX = event.mouseButton.x;
-                float mouseY = event.mouseButton.y;
-                playerShip.setTarget(mouseX, mouseY);
+                sf::Vector2f mouse = window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y}, camera);
+                playerShip.setTarget(mouse.x, mouse.y);
             }
+
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::B)
+                playerShip.buyAtMarket(market, station, COMMODITY_FUEL);
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::N)
+                playerShip.sellAtMarket(market, station, COMMODITY_FUEL);
         }
 
+        // Decisions per ship, then movement for the whole fleet in batches, in as much
+        // detail as each ship's distance from the player calls for
         playerShip.handleInput();
-        playerShip.update();
-        aiShip.updateAI();
+        lod.assess(frame, fleet, grid, galaxy, playerShip.getPosition());
+        ai.update(frame, pool, fleet, grid, market, viewShip, actShip);
+        lod.update(frame++, fleet);
+
+        // The galaxy follows the player into another sector, and parks the ships it
+        // moves in the sectors that leaves behind
+        if (fleet.sector[playerShip.id] != galaxy.getFocus()) {
+            galaxy.setFocus(fleet.sector[playerShip.id], frame);
+            tradeMenu.setSector(galaxy.getFocus());
+            for (ShipId ship : galaxy.getParked()) {
+                grid.remove(ship);
+                ai.setEnabled(ship, false);
+            }
+        }
+        galaxy.update(frame, pool);
+        for (ShipId ship : galaxy.getUnparked())
+            ai.setEnabled(ship, true);
+
+        // Only the ships that moved need their place in the grid and their trade offer
+        // range brought up to date
+        for (const std::vector<ShipId>* moved : {&lod.getMoved(), &galaxy.getMoved()}) {
+            grid.update(fleet, *moved);
+            for (ShipId ship : *moved)
+                shipsById[ship]->updateSubscription();
+        }
+        settleTrades(market, shipsById);
+
+        // Everything published this frame reaches its subscribers in one batch per topic
+        eventBus.dispatch();
 
         window.clear();
-        playerShip.draw(window);
-        aiShip.draw(window);
+        camera.setCenter(fleet.x[playerShip.id], fleet.y[playerShip.id]);
+        window.setView(camera);
+        traffic.clear();
+        galaxy.forEachNearShip([&](float x, float y) {
+            sf::Vertex corners[4] = {{{x - 1.5f, y - 1.5f}, sf::Color(128, 128, 128)},
+                                     {{x + 1.5f, y - 1.5f}, sf::Color(128, 128, 128)},
+                                     {{x + 1.5f, y + 1.5f}, sf::Color(128, 128, 128)},
+                                     {{x - 1.5f, y + 1.5f}, sf::Color(128, 128, 128)}};
+            for (int corner : {0, 1, 2, 0, 2, 3})
+                traffic.append(corners[corner]);
+        });
+        window.draw(traffic);
+        shipRenderer.draw(window, fleet, galaxy.getFocus());
+        window.setView(window.getDefaultView());
         tradeMenu.draw(window);
         window.display();
     }
@@ -0,0 +1,137 @@
+// space_trader_marketbench: orders per second through the Market's order books, and
+// a check that replaying the recorded order stream reproduces every trade.
+//
+// Usage: space_trader_marketbench [orders] [journal file]
+//
+// A thousand ships send limit orders for three commodities to ten stations, at prices
+// scattered around each book's mid price, and cancel one order in five. The journal
+// goes through its text form, written to the journal file if one is given, before it
+// is replayed into a fresh market.
+
+#include "Market.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+const int STATIONS = 10;
+const int SHIPS = 1000;
+const std::int32_t MID_PRICE = 100;
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void addStations(Market& market) {
+    for (int i = 0; i < STATIONS; ++i)
+        market.addStation("Station " + std::to_string(i), i * 1000.0f, 0.0f);
+}
+
+// Order-sensitive hash of the trades, to compare two runs
+std::uint64_t checksum(const std::vector<Trade>& trades) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const Trade& trade : trades) {
+        const std::uint64_t fields[] = {trade.station, trade.commodity, trade.fill.buyer, trade.fill.seller,
+                                        static_cast<std::uint32_t>(trade.fill.price),
+                                        static_cast<std::uint32_t>(trade.fill.quantity)};
+        for (std::uint64_t field : fields)
+            hash = (hash ^ field) * 1099511628211ull;
+    }
+    return hash;
+}
+
+int main(int argc, char* argv[]) {
+    int orderCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1000000;
+    const char* journalPath = argc > 2 ? argv[2] : nullptr;
+
+    // Generated up front so only the market is timed. A cancel names a random earlier
+    // submit, whose order ID is only known once it has been submitted.
+    struct Generated {
+        bool cancel;
+        int submit; // Index of the submit to cancel
+        MarketOrder order;
+    };
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<int> station(0, STATIONS - 1), commodity(0, 2), ship(0, SHIPS - 1), side(0, 1);
+    std::normal_distribution<float> spread(0.0f, 5.0f);
+    std::uniform_int_distribution<int> quantity(1, 20), percent(0, 99);
+    std::vector<Generated> stream;
+    int submits = 0;
+    for (int i = 0; i < orderCount; ++i) {
+        if (submits > 0 && percent(generator) < 20) {
+            int recent = std::max(0, submits - 1000);
+            stream.push_back(Generated{true, std::uniform_int_distribution<int>(recent, submits - 1)(generator), {}});
+            continue;
+        }
+        Side orderSide = side(generator) == 0 ? BUY : SELL;
+        // Buyers bid a little under the mid and sellers ask a little over, so about
+        // half the orders cross and the books stay a few dozen levels deep
+        std::int32_t price = MID_PRICE + (orderSide == BUY ? -2 : 2) + static_cast<std::int32_t>(spread(generator));
+        stream.push_back(Generated{false, 0,
+                                   MarketOrder{MarketOrder::SUBMIT, static_cast<StationId>(station(generator)),
+                                               static_cast<TypeId>(commodity(generator)), orderSide,
+                                               static_cast<ShipId>(ship(generator)), std::max(1, price),
+                                               quantity(generator)}});
+        ++submits;
+    }
+
+    Market market;
+    market.setJournaling(true);
+    addStations(market);
+    std::vector<OrderId> ids;
+    ids.reserve(submits);
+    std::vector<MarketOrder> submitted;
+    submitted.reserve(submits);
+    int cancelled = 0;
+    auto start = Clock::now();
+    for (const Generated& entry : stream) {
+        if (entry.cancel) {
+            const MarketOrder& order = submitted[entry.submit];
+            cancelled += market.cancel(order.station, order.commodity, ids[entry.submit]);
+        } else {
+            const MarketOrder& order = entry.order;
+            ids.push_back(market.submit(order.station, order.commodity, order.side, order.ship, order.price,
+                                        order.quantity));
+            submitted.push_back(order);
+        }
+    }
+    double ms = msSince(start);
+    std::size_t tradeCount = market.getTrades().size();
+    std::uint64_t recorded = checksum(market.getTrades());
+    std::cout << orderCount << " orders (" << submits << " submits, " << cancelled << " cancelled), " << tradeCount
+              << " trades in " << ms << " ms: " << orderCount / ms * 1000.0 << " orders/s" << std::endl;
+
+    // Round-trip the journal through its text form, then replay it
+    std::stringstream text;
+    market.writeJournal(text);
+    if (journalPath) {
+        std::ofstream file(journalPath);
+        if (!file) {
+            std::cerr << "Failed to write " << journalPath << std::endl;
+            return -1;
+        }
+        file << text.str();
+    }
+    std::vector<MarketOrder> journal;
+    if (!Market::readJournal(text, journal)) {
+        std::cerr << "Failed to read the journal back" << std::endl;
+        return -1;
+    }
+
+    Market replayed;
+    replayed.setJournaling(true);
+    addStations(replayed);
+    start = Clock::now();
+    bool applied = replayed.replay(journal);
+    ms = msSince(start);
+    bool identical = applied && replayed.getTrades().size() == tradeCount && checksum(replayed.getTrades()) == recorded;
+    std::cout << "Replay of " << journal.size() << " journal entries: " << replayed.getTrades().size()
+              << " trades in " << ms << " ms, " << (identical ? "identical" : "DIFFERENT") << std::endl;
+    return identical ? 0 : 1;
+}
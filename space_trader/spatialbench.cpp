@@ -0,0 +1,112 @@
+// space_trader_spatialbench: cost of keeping SpatialGrid up to date as a fleet moves,
+// and of radius and k-nearest queries against it, at several fleet sizes.
+//
+// Usage: space_trader_spatialbench [ships...]
+//
+// Ships wander between random targets in a world sized for about one ship per 100 x
+// 100 units, whatever their number. Each size runs a few frames of Fleet update and
+// grid update, against rebuilding the grid from scratch, then batches of radius
+// queries (300 units, the trade range) and 8-nearest queries from random ships,
+// against scanning every ship.
+
+#include "CounterRandom.h"
+#include "SpatialGrid.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+const int FRAMES = 10;
+const std::size_t QUERIES = 10000;
+const std::size_t BRUTE_FORCE_QUERIES = 100;
+const float QUERY_RADIUS = 300.0f;
+const std::size_t NEIGHBOURS = 8;
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void run(std::size_t shipCount, ThreadPool& pool) {
+    float worldSize = 100.0f * std::sqrt(static_cast<float>(shipCount));
+    CounterRandom random(1, shipCount);
+    Fleet fleet;
+    for (std::size_t i = 0; i < shipCount; ++i)
+        fleet.add(random.uniform(0.0f, worldSize), random.uniform(0.0f, worldSize));
+
+    SpatialGrid grid;
+    auto start = Clock::now();
+    grid.update(fleet);
+    double buildMs = msSince(start);
+
+    double updateMs = 0.0, rebuildMs = 0.0;
+    std::size_t moves = 0;
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        for (ShipId ship = 0; ship < fleet.size(); ++ship) {
+            if (!fleet.hasTarget[ship])
+                fleet.setTarget(ship, fleet.x[ship] + random.uniform(-500.0f, 500.0f),
+                                fleet.y[ship] + random.uniform(-500.0f, 500.0f));
+        }
+        fleet.update();
+        start = Clock::now();
+        grid.update(fleet);
+        updateMs += msSince(start);
+        moves += grid.getLastMoves();
+
+        start = Clock::now();
+        SpatialGrid rebuilt;
+        rebuilt.update(fleet);
+        rebuildMs += msSince(start);
+    }
+
+    std::vector<ProximityQuery> queries;
+    for (std::size_t i = 0; i < QUERIES; ++i) {
+        ShipId ship = random.below(static_cast<std::uint32_t>(shipCount));
+        queries.push_back(ProximityQuery{fleet.sector[ship], fleet.x[ship], fleet.y[ship], QUERY_RADIUS, ship});
+    }
+    std::vector<std::vector<ShipId>> results;
+    start = Clock::now();
+    grid.queryRadius(queries, pool, results);
+    double radiusMs = msSince(start);
+    std::size_t found = 0;
+    for (const std::vector<ShipId>& result : results)
+        found += result.size();
+
+    start = Clock::now();
+    grid.queryNearest(queries, NEIGHBOURS, pool, results);
+    double nearestMs = msSince(start);
+
+    // What every radius query would cost without the grid
+    std::size_t bruteFound = 0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < BRUTE_FORCE_QUERIES; ++i) {
+        const ProximityQuery& query = queries[i];
+        for (ShipId ship = 0; ship < fleet.size(); ++ship) {
+            float dx = fleet.x[ship] - query.x, dy = fleet.y[ship] - query.y;
+            bruteFound += dx * dx + dy * dy <= QUERY_RADIUS * QUERY_RADIUS && ship != query.except;
+        }
+    }
+    double bruteMs = msSince(start) * QUERIES / BRUTE_FORCE_QUERIES;
+
+    std::cout << shipCount << " ships, " << grid.getCellCount() << " cells" << std::endl;
+    std::cout << "  build " << buildMs << " ms, incremental update " << updateMs / FRAMES << " ms/frame ("
+              << moves / FRAMES << " cell changes), rebuild " << rebuildMs / FRAMES << " ms/frame" << std::endl;
+    std::cout << "  " << QUERIES << " radius queries: " << radiusMs << " ms (" << found / QUERIES
+              << " ships each), scanning every ship: " << bruteMs << " ms (" << bruteFound / BRUTE_FORCE_QUERIES
+              << " each)" << std::endl;
+    std::cout << "  " << QUERIES << " " << NEIGHBOURS << "-nearest queries: " << nearestMs << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    ThreadPool pool;
+    std::cout << pool.getThreadCount() << " thread(s)" << std::endl;
+    if (argc < 2) {
+        for (std::size_t ships : {10000, 100000, 1000000})
+            run(ships, pool);
+    }
+    for (int i = 1; i < argc; ++i)
+        run(static_cast<std::size_t>(std::max(1, std::atoi(argv[i]))), pool);
+    return 0;
+}